@@ -0,0 +1,96 @@
+#ifndef AFINA_KEY_HASH_H
+#define AFINA_KEY_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace Afina {
+
+/**
+ * # Hash of the key
+ * The single 64 bit hash every layer uses: parser computes it while it reads the key, storage picks the stripe by
+ * it, probes filters and hash index with it, so that key is hashed once per request. Key is consumed by 8 byte
+ * words, little endian, each word is mixed by the murmur3 finalizer, so that all bits of the result depend on
+ * every byte of the key.
+ *
+ * Layers use different bits of it, so that they don't correlate: bits 0-31 pick buckets of filters and hash
+ * indexes, bits 32-47 pick the stripe, and the top bits are filter fingerprints and sampling thresholds.
+ */
+class KeyHasher {
+public:
+    KeyHasher() { Reset(); }
+
+    inline void Reset() {
+        _h = kSeed;
+        _word = 0;
+        _size = 0;
+    }
+
+    // Adds the next byte of the key
+    inline void Update(char c) {
+        _word |= uint64_t(uint8_t(c)) << (8 * (_size % 8));
+        if (++_size % 8 == 0) {
+            _h = Step(_h, _word);
+            _word = 0;
+        }
+    }
+
+    // Hash of the bytes added so far
+    inline uint64_t Digest() const { return Finish(_h, _word, _size); }
+
+    /**
+     * Hash of the whole key, the same as Update of all its bytes gives
+     */
+    static inline uint64_t Hash(const char *data, std::size_t size) {
+        uint64_t h = kSeed;
+        std::size_t left = size;
+        for (; left >= sizeof(uint64_t); data += sizeof(uint64_t), left -= sizeof(uint64_t)) {
+            h = Step(h, Load(data, sizeof(uint64_t)));
+        }
+        return Finish(h, Load(data, left), size);
+    }
+
+private:
+    static const uint64_t kSeed = 0x9e3779b97f4a7c15ULL;
+
+    static inline uint64_t Mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static inline uint64_t Step(uint64_t h, uint64_t word) { return (h ^ Mix(word)) * kSeed; }
+
+    // Size goes last, so that keys that differ only by trailing zero bytes differ
+    static inline uint64_t Finish(uint64_t h, uint64_t tail, std::size_t size) {
+        return Mix(h ^ tail ^ (uint64_t(size) * 0xc2b2ae3d27d4eb4fULL));
+    }
+
+    // Up to 8 bytes as little endian word
+    static inline uint64_t Load(const char *data, std::size_t size) {
+        uint64_t word = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        for (std::size_t i = 0; i < size; i++) {
+            word |= uint64_t(uint8_t(data[i])) << (8 * i);
+        }
+#else
+        std::memcpy(&word, data, size);
+#endif
+        return word;
+    }
+
+    uint64_t _h;
+    uint64_t _word;
+    std::size_t _size;
+};
+
+// See KeyHasher
+inline uint64_t HashKey(const char *data, std::size_t size) { return KeyHasher::Hash(data, size); }
+
+} // namespace Afina
+
+#endif // AFINA_KEY_HASH_H
@@ -1,7 +1,13 @@
 #ifndef AFINA_STORAGE_H
 #define AFINA_STORAGE_H
 
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <afina/Value.h>
 
 namespace Afina {
 
@@ -84,6 +90,284 @@ public:
      * @param value output parameter to copy value to
      */
     virtual bool Get(const std::string &key, std::string &value) = 0;
+
+    /**
+     * Same as Put, PutIfAbsent and Set, but value is a sink argument: caller that doesn't need it anymore moves
+     * it in, and storage could adopt its buffer instead of copying the bytes. Default implementations copy
+     *
+     * @param key to be associated with value
+     * @param value to be assigned for the key
+     */
+    virtual bool Put(const std::string &key, std::string &&value) { return Put(key, value); }
+    virtual bool PutIfAbsent(const std::string &key, std::string &&value) { return PutIfAbsent(key, value); }
+    virtual bool Set(const std::string &key, std::string &&value) { return Set(key, value); }
+
+    /**
+     * Same as Put, but value comes as chain of chunks. Storage supporting chunked values keeps large
+     * ones without gluing chunks together, default implementation falls back to Put
+     *
+     * Value is a sink argument: caller that doesn't need it anymore moves it in, and storage moves its chunks
+     * into the item, so neither bytes nor chunk array are copied
+     *
+     * @param key to be associated with value
+     * @param value to be assigned for the key
+     */
+    virtual bool PutValue(const std::string &key, Value value) { return Put(key, value.str()); }
+
+    /**
+     * Same as Get, but value is returned as chain of chunks. Storage supporting chunked values shares
+     * chunks of the large one instead of copying bytes, default implementation falls back to Get
+     *
+     * @param key to retrive value for
+     * @param value output parameter to put value to
+     */
+    virtual bool GetValue(const std::string &key, Value &value) {
+        std::string data;
+        if (!Get(key, data)) {
+            return false;
+        }
+        value = Value(data);
+        return true;
+    }
+
+    /**
+     * Appends memcached response item for the key, "VALUE <key> 0 <bytes>\r\n<data>\r\n", to the given
+     * output. Storage could keep items in that form, so that hit costs a single copy with no formatting,
+     * default implementation formats the result of GetValue
+     *
+     * In case if given key not found method returns false and doesn't perform any changes on the output
+     *
+     * @param key to retrive value for
+     * @param out output parameter to append item to
+     */
+    virtual bool GetItem(const std::string &key, Value &out) {
+        Value value;
+        if (!GetValue(key, value)) {
+            return false;
+        }
+        AppendItem(key, value, out);
+        return true;
+    }
+
+    /**
+     * What Compute does with the item once mutation returns
+     */
+    enum class Action {
+        // Leave item as it was, or absent
+        kKeep,
+        // Store value mutation left in its argument, whether key was present or not
+        kStore,
+        // Remove the item
+        kDelete
+    };
+
+    /**
+     * Current value of the item as mutation sees it. Bytes are copied out only if mutation reads them, so that
+     * the one replacing value regardless of what it was doesn't pay for the copy
+     */
+    class Current {
+    public:
+        // Puts current value into the given one, leaves it as it is if key is absent
+        virtual void Read(Value &value) const = 0;
+
+    protected:
+        ~Current() {}
+    };
+
+    /**
+     * Current value read by the given function, i.e. the one storage builds from the item it found
+     */
+    template <typename F> class CurrentBy final : public Current {
+    public:
+        explicit CurrentBy(F read) : _read(read) {}
+        void Read(Value &value) const override { _read(value); }
+
+    private:
+        F _read;
+    };
+
+    template <typename F> static CurrentBy<F> MakeCurrent(F read) { return CurrentBy<F>(read); }
+
+    /**
+     * Mutation of the single item: gets true if key is present and its current value, puts the value to be
+     * stored into the last argument, that is empty on call, and tells what to do with the item. Mutation changing
+     * the current value reads it into the last argument first
+     */
+    using Mutation = std::function<Action(bool found, const Current &current, Value &value)>;
+
+    /**
+     * Read-modify-write of the single item: looks key up once, passes current value to the mutation and then
+     * stores or removes the item as mutation decided, so that conditional updates like replace or append need
+     * neither the second lookup nor a race window between them. Storage guarding items with locks runs the
+     * mutation under the lock, so it must be short and must not call the storage. Default implementation is
+     * built of GetValue, PutValue and Delete, so it isn't atomic
+     *
+     * Method returns true if item was stored or removed, false if mutation kept it or store failed, i.e. new
+     * value doesn't fit
+     *
+     * @param key of the item
+     * @param mutation to be applied to the item
+     */
+    virtual bool Compute(const std::string &key, const Mutation &mutation) {
+        Value stored;
+        bool found = GetValue(key, stored);
+        Value value;
+        switch (mutation(found, MakeCurrent([&stored](Value &out) { out = stored; }), value)) {
+        case Action::kStore:
+            return PutValue(key, std::move(value));
+        case Action::kDelete:
+            return found && Delete(key);
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * Adds data to the end of the existing value. If requested key doesn't present in storage method returns
+     * false and doesn't change anything. Storage keeping values in segments appends in place, so that cost is
+     * proportional to the size of data, not of the value. Default implementation is built of Compute
+     *
+     * @param key of the item
+     * @param data to be appended
+     */
+    virtual bool Append(const std::string &key, Value data) {
+        return Compute(key, [&data](bool found, const Current &current, Value &value) -> Action {
+            if (!found) {
+                return Action::kKeep;
+            }
+            current.Read(value);
+            value.Append(data);
+            return Action::kStore;
+        });
+    }
+
+    /**
+     * Same as Append, but data is added before the existing value
+     *
+     * @param key of the item
+     * @param data to be prepended
+     */
+    virtual bool Prepend(const std::string &key, Value data) {
+        return Compute(key, [&data](bool found, const Current &current, Value &value) -> Action {
+            if (!found) {
+                return Action::kKeep;
+            }
+            current.Read(value);
+            data.Append(value);
+            value = std::move(data);
+            return Action::kStore;
+        });
+    }
+
+    /**
+     * Same as methods above for the key whose hash caller knows already, i.e. parser computed it while it was
+     * reading the key. Hash must be the one HashKey gives for the key, see afina/KeyHash.h. Storage that hashes
+     * keys picks stripes, probes filters and indexes with the given hash instead of hashing the key again,
+     * default implementations pass it on to the hashed Put and Get, or ignore it
+     *
+     * @param key of the item
+     * @param hash of the key
+     */
+    virtual bool Put(const std::string &key, uint64_t hash, const std::string &value) { return Put(key, value); }
+    virtual bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) {
+        return PutIfAbsent(key, value);
+    }
+    virtual bool Set(const std::string &key, uint64_t hash, const std::string &value) { return Set(key, value); }
+    virtual bool Delete(const std::string &key, uint64_t hash) { return Delete(key); }
+    virtual bool Get(const std::string &key, uint64_t hash, std::string &value) { return Get(key, value); }
+    virtual bool GetValue(const std::string &key, uint64_t hash, Value &value) {
+        std::string data;
+        if (!Get(key, hash, data)) {
+            return false;
+        }
+        value = Value(data);
+        return true;
+    }
+    virtual bool PutValue(const std::string &key, uint64_t hash, Value value) { return Put(key, hash, value.str()); }
+    virtual bool GetItem(const std::string &key, uint64_t hash, Value &out) {
+        Value value;
+        if (!GetValue(key, hash, value)) {
+            return false;
+        }
+        AppendItem(key, value, out);
+        return true;
+    }
+    virtual bool Compute(const std::string &key, uint64_t hash, const Mutation &mutation) {
+        return Compute(key, mutation);
+    }
+    virtual bool Append(const std::string &key, uint64_t hash, Value data) { return Append(key, std::move(data)); }
+    virtual bool Prepend(const std::string &key, uint64_t hash, Value data) {
+        return Prepend(key, std::move(data));
+    }
+    virtual bool PutTagged(const std::string &key, uint64_t hash, const std::string &value, const std::string &tag) {
+        return PutTagged(key, value, tag);
+    }
+
+    /**
+     * Removes all associations whose keys start with the given prefix. Method returns false if storage
+     * doesn't support bulk invalidation, that is the default
+     *
+     * @param prefix of keys to be removed, empty one matches every key
+     * @param deleted output parameter to put number of removed keys to
+     */
+    virtual bool DeletePrefix(const std::string &prefix, std::size_t &deleted) { return false; }
+
+    /**
+     * Same as Put, but item is marked with the tag, so that it could be removed by InvalidateTag
+     * along with all other items carrying the same tag. Put of the same key drops the tag. Method
+     * returns false if storage doesn't support tags, that is the default
+     *
+     * @param key to be associated with value
+     * @param value to be assigned for the key
+     * @param tag to mark item with
+     */
+    virtual bool PutTagged(const std::string &key, const std::string &value, const std::string &tag) {
+        return false;
+    }
+
+    /**
+     * Removes all items stored with the given tag so far. Method returns false if storage doesn't
+     * support tags, that is the default
+     *
+     * @param tag to be invalidated
+     */
+    virtual bool InvalidateTag(const std::string &tag) { return false; }
+
+    /**
+     * Removes all items once the given number of seconds passes, 0 means right now. Storage could do that in O(1)
+     * by treating items stored before the flush as absent and reclaiming them lazily. Method returns false if
+     * storage doesn't support flush, that is the default
+     *
+     * @param delay in seconds before items are removed
+     */
+    virtual bool FlushAll(uint32_t delay) { return false; }
+
+    /**
+     * Sets memory limit to the given fraction of the one storage was created with, items above the new limit are
+     * evicted before method returns. Called by the memory governor as the host runs short of memory or gets it
+     * back. Method returns false if storage limit is fixed, that is the default, or if scale is out of range
+     *
+     * @param scale fraction of the initial limit, in (0, 1]
+     */
+    virtual bool SetLimitScale(double scale) { return false; }
+
+    /**
+     * Reports storage statistics as name/value pairs, in the same terms memcached "stats" command
+     * uses. Empty group means general statistics, storage could support more detailed groups, i.e.
+     * "stripes". Unknown group gives no statistics at all
+     *
+     * @param group of statistics requested
+     * @param stats output parameter to append statistics to
+     */
+    virtual void Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) {}
+
+protected:
+    // Appends memcached response item for the key and its value to the given output, see GetItem
+    static void AppendItem(const std::string &key, const Value &value, Value &out) {
+        out.Append("VALUE " + key + " 0 " + std::to_string(value.size()) + "\r\n");
+        out.Append(value);
+        out.Append("\r\n", 2);
+    }
 };
 
 } // namespace Afina
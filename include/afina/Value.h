@@ -0,0 +1,213 @@
+#ifndef AFINA_VALUE_H
+#define AFINA_VALUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Afina {
+
+/**
+ * # Byte string split into chunks
+ * Large values never live in a single contiguous buffer: bytes are kept in chunks of at most kChunkSize, and
+ * copy of the value shares chunks instead of bytes. That way storage could hand out its value to the network
+ * layer for the scatter-gather write without any memcpy, while being free to replace or evict the item.
+ *
+ * Chunks are immutable once shared. Value could only append into the last chunk if nobody else refers to it.
+ *
+ * Value is cheap to move: moved from value is left empty, so that the network layer could hand received bytes
+ * over to the command and the storage without copying chunks or even the array of them.
+ */
+class Value {
+public:
+    // Values longer than that are split
+    static const std::size_t kChunkSize = 64 * 1024;
+
+    // Prepend never grows the first chunk past that, moving its bytes isn't free
+    static const std::size_t kMergeSize = 4 * 1024;
+
+    // Number of short chunks value could have before it is worth compaction
+    static const std::size_t kMaxLooseChunks = 16;
+
+    Value() : _size(0), _reserved(0) {}
+    explicit Value(const std::string &data) : _size(0), _reserved(0) { Append(data.data(), data.size()); }
+
+    // Buffer of the string becomes the chunk, unless it is too large for a single one
+    explicit Value(std::string &&data) : _size(0), _reserved(0) {
+        if (data.size() > kChunkSize) {
+            Append(data.data(), data.size());
+        } else if (!data.empty()) {
+            _size = data.size();
+            _chunks.emplace_back(std::make_shared<std::string>(std::move(data)));
+        }
+    }
+
+    Value(const Value &other) = default;
+    Value &operator=(const Value &other) = default;
+
+    Value(Value &&other) noexcept : _chunks(std::move(other._chunks)), _size(other._size), _reserved(0) {
+        other._chunks.clear();
+        other._size = 0;
+        other._reserved = 0;
+    }
+
+    Value &operator=(Value &&other) noexcept {
+        if (this != &other) {
+            _chunks = std::move(other._chunks);
+            _size = other._size;
+            _reserved = 0;
+            other._chunks.clear();
+            other._size = 0;
+            other._reserved = 0;
+        }
+        return *this;
+    }
+
+    // Total number of bytes
+    inline std::size_t size() const { return _size; }
+    inline bool empty() const { return _size == 0; }
+
+    // Number of chunks and chunk access
+    inline std::size_t chunks() const { return _chunks.size(); }
+    inline const std::string &chunk(std::size_t i) const { return *_chunks[i]; }
+
+    /**
+     * Expects that many bytes to be appended piece by piece, so that chunks are allocated at their final
+     * size right away and never grow by reallocation and copy
+     */
+    inline void Reserve(std::size_t size) { _reserved = size; }
+
+    /**
+     * Copies bytes at the end of value
+     */
+    void Append(const char *data, std::size_t size) {
+        while (size > 0) {
+            if (_chunks.empty() || !Owned(_chunks.back()) || _chunks.back()->size() == kChunkSize) {
+                std::size_t expected = size > _reserved ? size : _reserved;
+                _chunks.emplace_back(new std::string());
+                _chunks.back()->reserve(expected < kChunkSize ? expected : kChunkSize);
+            }
+
+            std::string &tail = *_chunks.back();
+            std::size_t room = kChunkSize - tail.size();
+            std::size_t n = size < room ? size : room;
+            tail.append(data, n);
+            _size += n;
+            _reserved = _reserved > n ? _reserved - n : 0;
+            data += n;
+            size -= n;
+        }
+    }
+
+    inline void Append(const std::string &data) { Append(data.data(), data.size()); }
+
+    /**
+     * Shares all chunks of other value at the end of this one
+     */
+    void Append(const Value &other) {
+        _chunks.insert(_chunks.end(), other._chunks.begin(), other._chunks.end());
+        _size += other._size;
+    }
+
+    /**
+     * Copies bytes at the beginning of value. Short piece goes into the first chunk if nobody else refers to it
+     * and it is short as well, so that series of small prepends doesn't turn into series of tiny chunks
+     */
+    void Prepend(const char *data, std::size_t size) {
+        if (!_chunks.empty() && Owned(_chunks.front()) && _chunks.front()->size() + size <= kMergeSize) {
+            _chunks.front()->insert(0, data, size);
+            _size += size;
+            return;
+        }
+
+        std::vector<std::shared_ptr<std::string>> head;
+        for (std::size_t offset = 0; offset < size; offset += kChunkSize) {
+            std::size_t n = size - offset < kChunkSize ? size - offset : kChunkSize;
+            head.emplace_back(std::make_shared<std::string>(data + offset, n));
+        }
+        _chunks.insert(_chunks.begin(), head.begin(), head.end());
+        _size += size;
+    }
+
+    /**
+     * Copies bytes into as few chunks as possible. Appends and prepends past the shared chunks leave short ones
+     * behind, owner calls that once they pile up
+     */
+    void Compact() {
+        Value packed;
+        packed.Reserve(_size);
+        for (auto &chunk : _chunks) {
+            packed.Append(chunk->data(), chunk->size());
+        }
+        *this = std::move(packed);
+    }
+
+    // True if there are much more chunks than bytes need
+    inline bool fragmented() const { return _chunks.size() > 2 * (_size / kChunkSize) + kMaxLooseChunks; }
+
+    /**
+     * Drops bytes after the given size
+     */
+    void Truncate(std::size_t size) {
+        while (_size > size) {
+            std::string &tail = *_chunks.back();
+            std::size_t drop = std::min(_size - size, tail.size());
+            if (drop == tail.size()) {
+                _chunks.pop_back();
+            } else if (Owned(_chunks.back())) {
+                tail.resize(tail.size() - drop);
+            } else {
+                _chunks.back().reset(new std::string(tail, 0, tail.size() - drop));
+            }
+            _size -= drop;
+        }
+    }
+
+    /**
+     * Copies all bytes into the contiguous string
+     */
+    void CopyTo(std::string &out) const {
+        out.clear();
+        out.reserve(_size);
+        for (auto &chunk : _chunks) {
+            out.append(*chunk);
+        }
+    }
+
+    inline std::string str() const {
+        std::string out;
+        CopyTo(out);
+        return out;
+    }
+
+    void clear() {
+        _chunks.clear();
+        _size = 0;
+        _reserved = 0;
+    }
+
+private:
+    // True if nobody else refers to the chunk, so it could be changed in place. use_count is a relaxed load, fence
+    // orders the change after reads other owners did before they dropped their references, i.e. writev of the item
+    static inline bool Owned(const std::shared_ptr<std::string> &chunk) {
+        if (chunk.use_count() != 1) {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+    std::vector<std::shared_ptr<std::string>> _chunks;
+    std::size_t _size;
+
+    // Bytes expected to be appended yet, see Reserve
+    std::size_t _reserved;
+};
+
+} // namespace Afina
+
+#endif // AFINA_VALUE_H
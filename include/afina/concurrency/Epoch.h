@@ -0,0 +1,132 @@
+#ifndef AFINA_CONCURRENCY_EPOCH_H
+#define AFINA_CONCURRENCY_EPOCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "ThreadLocal.h"
+
+namespace Afina {
+namespace Concurrency {
+
+/**
+ * # Epoch based memory reclamation
+ * Allows readers to traverse shared structures without locks while writers unlink and replace parts of them.
+ *
+ * Reader wraps each access into EpochManager::Guard, the only shared memory write it does is announce of
+ * the current epoch into its own cache line. Writer unlinks object so that no new reader could reach it and
+ * then passes it into Retire. Object gets deleted once all readers that were active at the moment of
+ * retirement leave their critical sections, i.e after global epoch advanced twice.
+ */
+class EpochManager {
+private:
+    // State of the single thread
+    struct Record {
+        // Epoch announced by the thread, 0 if thread is outside of critical section
+        std::atomic<uint64_t> epoch{0};
+
+        // Number of nested guards, accessed by the owner thread only
+        uint32_t nesting = 0;
+    };
+
+    // Object waiting for the grace period to pass
+    struct Retired {
+        void *ptr;
+        void (*deleter)(void *);
+        uint64_t epoch;
+    };
+
+public:
+    /**
+     * # Reader critical section
+     * Objects reachable at the moment of guard creation are not freed until it is destroyed
+     */
+    class Guard {
+    public:
+        explicit Guard(EpochManager &manager) : _manager(manager), _record(manager.Enter()) {}
+        ~Guard() { _manager.Exit(_record); }
+
+    private:
+        Guard(const Guard &);            // = delete;
+        Guard &operator=(const Guard &); // = delete;
+
+        EpochManager &_manager;
+        Record &_record;
+    };
+
+    EpochManager() : _global(1) {}
+
+    /**
+     * Frees all retired objects, no reader must be running at that moment
+     */
+    ~EpochManager();
+
+    /**
+     * Schedules object for deletion. Object must be unreachable for the new readers already
+     */
+    template <typename T> void Retire(T *ptr) {
+        Retire(const_cast<void *>(static_cast<const void *>(ptr)), [](void *p) { delete static_cast<T *>(p); });
+    }
+
+    /**
+     * Schedules object for deletion by the given function
+     */
+    void Retire(void *ptr, void (*deleter)(void *));
+
+    /**
+     * Tries to advance global epoch and frees objects whose grace period passed. Called by Retire once
+     * enough garbage collected, but could be called explicitly as well
+     */
+    void Collect();
+
+    /**
+     * Blocks until every guard that existed at the moment of the call is destroyed. Must not be called
+     * under guard of the same manager
+     */
+    void Synchronize();
+
+    /**
+     * Number of objects waiting for deletion
+     */
+    std::size_t Pending();
+
+private:
+    EpochManager(const EpochManager &);            // = delete;
+    EpochManager &operator=(const EpochManager &); // = delete;
+
+    // Moves global epoch forward if every active reader has observed the current one
+    bool TryAdvance();
+
+    inline Record &Enter() {
+        Record &record = _records.get();
+        if (record.nesting++ == 0) {
+            record.epoch.store(_global.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            // Announce must be visible before any read of the shared data, pairs with fence in Collect
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        return record;
+    }
+
+    inline void Exit(Record &record) {
+        if (--record.nesting == 0) {
+            record.epoch.store(0, std::memory_order_release);
+        }
+    }
+
+    // Current epoch, never wraps
+    std::atomic<uint64_t> _global;
+
+    // Announces of all threads
+    ThreadLocal<Record> _records;
+
+    // Retired objects ordered by epoch
+    std::mutex _mtx;
+    std::vector<Retired> _limbo;
+};
+
+} // namespace Concurrency
+} // namespace Afina
+
+#endif // AFINA_CONCURRENCY_EPOCH_H
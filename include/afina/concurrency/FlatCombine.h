@@ -1,10 +1,131 @@
 #ifndef AFINA_CONCURRENCY_FLAT_COMBINE_H
 #define AFINA_CONCURRENCY_FLAT_COMBINE_H
 
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "ThreadLocal.h"
+
 namespace Afina {
 namespace Concurrency {
 
-template <typename Op> class FlatCombine {};
+/**
+ * # Flat combining
+ * Instead of fighting for the lock every thread publishes its operation into own slot. Thread that manages to
+ * take the lock becomes combiner: it scans all slots and applies every published operation, so that shared
+ * structure stays hot in its cache while others just spin on their own slot waiting for the result.
+ *
+ * Operation is applied by the function given in constructor, it is always called under combiner lock
+ */
+template <typename Op> class FlatCombine {
+private:
+    // Publication record of the single thread
+    struct Slot {
+        // Operation waiting to be applied, reset to nullptr by combiner once it is done
+        std::atomic<Op *> pending{nullptr};
+
+        // Error thrown while operation was applied
+        std::exception_ptr error;
+
+        // Publication list, slot is linked into it once and never removed
+        Slot *next = nullptr;
+        bool registered = false;
+    };
+
+    // Combiner does at most that many passes over the list while it finds new operations
+    static const int kCombinePasses = 3;
+
+    // Waiter spins that many times before yielding
+    static const int kSpins = 128;
+
+public:
+    explicit FlatCombine(std::function<void(Op &)> apply) : _apply(apply), _head(nullptr) {}
+    ~FlatCombine() {}
+
+    /**
+     * Applies operation either by the calling thread or by the current combiner. Once method returns
+     * operation is complete, exception thrown while applying it is rethrown here
+     */
+    void Execute(Op &op) {
+        Slot &slot = LocalSlot();
+        slot.pending.store(&op, std::memory_order_release);
+
+        for (;;) {
+            if (_mtx.try_lock()) {
+                Combine();
+                _mtx.unlock();
+            }
+
+            for (int i = 0; i < kSpins && slot.pending.load(std::memory_order_acquire) != nullptr; i++) {
+            }
+
+            if (slot.pending.load(std::memory_order_acquire) == nullptr) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+
+        if (slot.error) {
+            std::exception_ptr error = slot.error;
+            slot.error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    FlatCombine(const FlatCombine &);            // = delete;
+    FlatCombine &operator=(const FlatCombine &); // = delete;
+
+    Slot &LocalSlot() {
+        Slot &slot = _slots.get();
+        if (!slot.registered) {
+            // Slot of the dead thread is already linked
+            Slot *head = _head.load(std::memory_order_relaxed);
+            do {
+                slot.next = head;
+            } while (!_head.compare_exchange_weak(head, &slot, std::memory_order_release, std::memory_order_relaxed));
+            slot.registered = true;
+        }
+        return slot;
+    }
+
+    // Applies published operations, must be called under _mtx
+    void Combine() {
+        for (int pass = 0; pass < kCombinePasses; pass++) {
+            bool found = false;
+            for (Slot *slot = _head.load(std::memory_order_acquire); slot != nullptr; slot = slot->next) {
+                Op *op = slot->pending.load(std::memory_order_acquire);
+                if (op == nullptr) {
+                    continue;
+                }
+
+                found = true;
+                try {
+                    _apply(*op);
+                } catch (...) {
+                    slot->error = std::current_exception();
+                }
+                slot->pending.store(nullptr, std::memory_order_release);
+            }
+
+            if (!found) {
+                break;
+            }
+        }
+    }
+
+    std::function<void(Op &)> _apply;
+
+    // Combiner lock
+    std::mutex _mtx;
+
+    // Publication list
+    std::atomic<Slot *> _head;
+    ThreadLocal<Slot> _slots;
+};
 
 } // namespace Concurrency
 } // namespace Afina
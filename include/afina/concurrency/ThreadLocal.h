@@ -1,10 +1,161 @@
 #ifndef AFINA_CONCURRENCY_THREAD_LOCAL_H
 #define AFINA_CONCURRENCY_THREAD_LOCAL_H
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 namespace Afina {
 namespace Concurrency {
 
-template <typename T> class ThreadLocal {};
+/**
+ * # Per object thread local value
+ * Unlike thread_local keyword it could be a class member: each thread gets its own instance of T for each
+ * ThreadLocal object, and owner of the object could visit instances of all threads.
+ *
+ * Instances are owned by ThreadLocal object and survive their threads: once thread exits its instance is
+ * handed over to the next thread asking for it, values are kept as is. So T must be ready to be reused and
+ * to be read by for_each concurrently with the owner thread.
+ */
+template <typename T> class ThreadLocal {
+private:
+    // Keep instances of different threads on different cache lines
+    static const std::size_t kCacheLine = 64;
+
+    struct Slot {
+        char _pad_before[kCacheLine];
+        T value;
+        std::atomic<bool> owned;
+        char _pad_after[kCacheLine];
+    };
+
+    struct Shared {
+        std::mutex mtx;
+        std::vector<std::unique_ptr<Slot>> slots;
+    };
+
+    // Instances known to the current thread. Slots are released once thread exits
+    struct Entry {
+        uint64_t id;
+        std::weak_ptr<Shared> owner;
+        Slot *slot;
+    };
+
+    // Instance the current thread used last, so that repeated calls on the same object skip the lookup. Trivial,
+    // so that access costs no initialization check. Ids are never reused, so entry of the dead object never matches
+    struct Last {
+        uint64_t id;
+        Slot *slot;
+    };
+
+    struct Cache {
+        ~Cache() {
+            for (auto &entry : entries) {
+                auto owner = entry.owner.lock();
+                if (owner) {
+                    entry.slot->owned.store(false, std::memory_order_release);
+                }
+            }
+        }
+
+        std::vector<Entry> entries;
+    };
+
+public:
+    ThreadLocal() : _id(next_id()), _shared(new Shared) {}
+    ~ThreadLocal() {}
+
+    /**
+     * Returns instance of the calling thread, creates it on the first call
+     */
+    inline T &get() {
+        Last &last = last_used();
+        if (last.id == _id) {
+            return last.slot->value;
+        }
+        return Lookup(last);
+    }
+
+    /**
+     * Calls f for instance of each thread that ever called get(), including threads that are dead already
+     */
+    template <typename F> void for_each(F f) {
+        std::lock_guard<std::mutex> lk(_shared->mtx);
+        for (auto &slot : _shared->slots) {
+            f(slot->value);
+        }
+    }
+
+private:
+    ThreadLocal(const ThreadLocal &);            // = delete;
+    ThreadLocal &operator=(const ThreadLocal &); // = delete;
+
+    static uint64_t next_id() {
+        static std::atomic<uint64_t> id(0);
+        return ++id;
+    }
+
+    static Cache &local_cache() {
+        static thread_local Cache cache;
+        return cache;
+    }
+
+    static Last &last_used() {
+        static thread_local Last last = {0, nullptr};
+        return last;
+    }
+
+    // Instance of the calling thread from the list of all it knows
+    T &Lookup(Last &last) {
+        Cache &cache = local_cache();
+        for (auto &entry : cache.entries) {
+            if (entry.id == _id) {
+                last = Last{_id, entry.slot};
+                return entry.slot->value;
+            }
+        }
+        T &value = Acquire(cache);
+        last = Last{_id, cache.entries.back().slot};
+        return value;
+    }
+
+    // Slow path: adopt instance left by some dead thread or create a new one
+    T &Acquire(Cache &cache) {
+        Slot *slot = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(_shared->mtx);
+            for (auto &s : _shared->slots) {
+                bool expected = false;
+                if (s->owned.compare_exchange_strong(expected, true)) {
+                    slot = s.get();
+                    break;
+                }
+            }
+
+            if (slot == nullptr) {
+                _shared->slots.emplace_back(new Slot());
+                slot = _shared->slots.back().get();
+                slot->owned.store(true);
+            }
+        }
+
+        // Forget objects that died already
+        std::vector<Entry> alive;
+        for (auto &entry : cache.entries) {
+            if (!entry.owner.expired()) {
+                alive.push_back(entry);
+            }
+        }
+        alive.push_back(Entry{_id, _shared, slot});
+        cache.entries.swap(alive);
+        return slot->value;
+    }
+
+    const uint64_t _id;
+    std::shared_ptr<Shared> _shared;
+};
 
 } // namespace Concurrency
 } // namespace Afina
@@ -20,7 +20,8 @@ namespace Execute {
  */
 class Add : public InsertCommand {
 public:
-    Add(const std::string &key, uint32_t flags, int32_t expire) : InsertCommand(key, flags, expire) {}
+    Add(const std::string &key, uint32_t flags, int32_t expire, uint64_t hash = 0)
+        : InsertCommand(key, flags, expire, hash) {}
     ~Add() {}
 
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
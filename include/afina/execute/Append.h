@@ -12,7 +12,7 @@ namespace Execute {
 /**
  * # Append data for the key
  * Append new data to the end of value for the given key. If key wasn't found
- * then command does nothing
+ * then command does nothing. Storage appends in place, existing value isn't copied
  *
  * Command must write result to the output, which could be:
  * - "STORED", to indicate success.
@@ -21,10 +21,14 @@ namespace Execute {
  */
 class Append : public InsertCommand {
 public:
-    Append(const std::string &key, uint32_t flags, int32_t expire) : InsertCommand(key, flags, expire) {}
+    Append(const std::string &key, uint32_t flags, int32_t expire, uint64_t hash = 0)
+        : InsertCommand(key, flags, expire, hash) {}
     ~Append() {}
 
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+    // Data is moved into the storage
+    void ExecuteChunked(Storage &storage, Value args, Value &out) override;
 };
 
 } // namespace Execute
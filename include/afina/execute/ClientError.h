@@ -0,0 +1,35 @@
+#ifndef AFINA_EXECUTE_CLIENT_ERROR_H
+#define AFINA_EXECUTE_CLIENT_ERROR_H
+
+#include <string>
+
+#include "Command.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Reject well formed but invalid command
+ * Parser builds it for commands that are read completely, body included, but whose arguments make no sense,
+ * i.e. tag on the command that doesn't store it. Storage isn't touched, and the connection stays usable, unlike
+ * for the malformed command, after which parser can't tell where the next one starts.
+ *
+ * Command writes "CLIENT_ERROR <message>" to the output
+ */
+class ClientError : public Command {
+public:
+    explicit ClientError(const std::string &message) : _message(message) {}
+    ~ClientError() {}
+
+    inline const std::string &message() const { return _message; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    const std::string _message;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_CLIENT_ERROR_H
@@ -6,6 +6,7 @@
 namespace Afina {
 
 class Storage;
+class Value;
 
 namespace Execute {
 
@@ -19,6 +20,13 @@ public:
     virtual ~Command() {}
 
     virtual void Execute(Storage &storage, const std::string &args, std::string &out) = 0;
+
+    /**
+     * Same as Execute, but argument and result are chunked, so that large values pass between network and
+     * storage without copies. Argument is a sink, network layer moves received value in and command moves it
+     * further into the storage. By default argument is flattened and Execute is called
+     */
+    virtual void ExecuteChunked(Storage &storage, Value args, Value &out);
 };
 
 } // namespace Execute
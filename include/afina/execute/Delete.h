@@ -1,6 +1,11 @@
 #ifndef AFINA_EXECUTE_DELETE_H
 #define AFINA_EXECUTE_DELETE_H
 
+#include <cstdint>
+#include <string>
+
+#include <afina/KeyHash.h>
+
 #include "Command.h"
 
 namespace Afina {
@@ -17,10 +22,19 @@ namespace Execute {
  */
 class Delete : public Command {
 public:
-    Delete();
-    ~Delete();
+    // Hash of the key is computed if caller passes none, see afina/KeyHash.h
+    explicit Delete(const std::string &key, uint64_t hash = 0)
+        : _key(key), _hash(hash != 0 ? hash : HashKey(key.data(), key.size())) {}
+    ~Delete() {}
+
+    inline const std::string &key() const { return _key; }
+    inline uint64_t hash() const { return _hash; }
 
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    std::string _key;
+    uint64_t _hash;
 };
 
 } // namespace Execute
@@ -0,0 +1,38 @@
+#ifndef AFINA_EXECUTE_FLUSH_ALL_H
+#define AFINA_EXECUTE_FLUSH_ALL_H
+
+#include <cstdint>
+#include <string>
+
+#include "Command.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Remove all items
+ * Invalidates every item stored so far, right now or once the given number of seconds passes. Storage doesn't
+ * look for items, they are treated as absent from then on and reclaimed lazily, so the command returns
+ * immediately regardless of the number of items.
+ *
+ * Command must write result to the output, which could be:
+ * - "OK" to indicate success
+ * - "SERVER_ERROR <message>" if storage doesn't support flush
+ */
+class FlushAll : public Command {
+public:
+    explicit FlushAll(uint32_t delay) : _delay(delay) {}
+    ~FlushAll() {}
+
+    inline uint32_t delay() const { return _delay; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    const uint32_t _delay;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_FLUSH_ALL_H
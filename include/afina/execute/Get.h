@@ -1,6 +1,7 @@
 #ifndef AFINA_EXECUTE_GET_H
 #define AFINA_EXECUTE_GET_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -34,15 +35,24 @@ namespace Execute {
  */
 class Get : public Command {
 public:
-    Get(const std::vector<std::string> &keys) : _keys(keys) {}
+    /**
+     * Hashes of keys are the ones parser computed while it was reading them, see afina/KeyHash.h, they are
+     * computed here if caller passes none
+     */
+    Get(const std::vector<std::string> &keys, const std::vector<uint64_t> &hashes = {});
     ~Get() {}
 
     inline const std::vector<std::string> &keys() const { return _keys; }
+    inline const std::vector<uint64_t> &hashes() const { return _hashes; }
 
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
 
+    // Value chunks are shared with storage, nothing is copied
+    void ExecuteChunked(Storage &storage, Value args, Value &out) override;
+
 private:
     std::vector<std::string> _keys;
+    std::vector<uint64_t> _hashes;
 };
 
 } // namespace Execute
@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <string>
 
+#include <afina/KeyHash.h>
+
 #include "Command.h"
 
 namespace Afina {
@@ -11,21 +13,25 @@ namespace Execute {
 
 /**
  * # Basic class for all insert commands
- *
+ * Hash of the key is the one parser computed while it was reading the key, see afina/KeyHash.h, or computed
+ * here if caller passes none
  */
 class InsertCommand : public Command {
 public:
-    InsertCommand(const std::string &key, uint32_t flags, int32_t expire) : _key(key), _flags(flags), _expire(expire) {}
+    InsertCommand(const std::string &key, uint32_t flags, int32_t expire, uint64_t hash = 0)
+        : _key(key), _flags(flags), _expire(expire), _hash(hash != 0 ? hash : HashKey(key.data(), key.size())) {}
     ~InsertCommand() {}
 
     inline const std::string &key() const { return _key; }
     inline const uint32_t flags() const { return _flags; }
     inline const int32_t expire() const { return _expire; }
+    inline uint64_t hash() const { return _hash; }
 
 protected:
     const std::string _key;
     const uint32_t _flags;
     const int32_t _expire;
+    const uint64_t _hash;
 };
 
 } // namespace Execute
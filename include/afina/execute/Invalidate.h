@@ -0,0 +1,35 @@
+#ifndef AFINA_EXECUTE_INVALIDATE_H
+#define AFINA_EXECUTE_INVALIDATE_H
+
+#include <string>
+#include <vector>
+
+#include "Command.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Remove all keys starting with any of the given prefixes
+ * Command must write result to the output, which could be:
+ * - "DELETED <n>" where n is the number of keys removed
+ * - "SERVER_ERROR <message>" if storage doesn't support bulk invalidation
+ * - "CLIENT_ERROR <message>" if any prefix is empty, nothing is removed then
+ */
+class Invalidate : public Command {
+public:
+    explicit Invalidate(const std::vector<std::string> &prefixes) : _prefixes(prefixes) {}
+    ~Invalidate() {}
+
+    inline const std::vector<std::string> &prefixes() const { return _prefixes; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    std::vector<std::string> _prefixes;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_INVALIDATE_H
@@ -0,0 +1,36 @@
+#ifndef AFINA_EXECUTE_INVALIDATE_TAG_H
+#define AFINA_EXECUTE_INVALIDATE_TAG_H
+
+#include <string>
+
+#include "Command.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Remove all items stored with the given tag
+ * Items are tagged by "set <key> <flags> <exptime> <bytes> tag:<name>". Storage doesn't look for them, they are
+ * dropped lazily as soon as accessed, so the cost doesn't depend on the number of items.
+ *
+ * Command must write result to the output, which could be:
+ * - "OK" to indicate success
+ * - "SERVER_ERROR <message>" if storage doesn't support tags
+ */
+class InvalidateTag : public Command {
+public:
+    explicit InvalidateTag(const std::string &tag) : _tag(tag) {}
+    ~InvalidateTag() {}
+
+    inline const std::string &tag() const { return _tag; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    std::string _tag;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_INVALIDATE_TAG_H
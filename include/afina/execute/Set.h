@@ -18,13 +18,25 @@ namespace Execute {
  * - "STORED", to indicate success.
  * - "NOT_STORED" to indicate the data was not stored, but not because of an
  * error. This normally means that the condition for the command wasn't met.
+ *
+ * Item could be marked with tag, see InvalidateTag.h
  */
 class Set : public InsertCommand {
 public:
-    Set(const std::string &key, uint32_t flags, int32_t expire) : InsertCommand(key, flags, expire) {}
+    Set(const std::string &key, uint32_t flags, int32_t expire, const std::string &tag = "", uint64_t hash = 0)
+        : InsertCommand(key, flags, expire, hash), _tag(tag) {}
     ~Set() {}
 
+    // Empty if item has no tag
+    inline const std::string &tag() const { return _tag; }
+
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+    // Value is moved into the storage, nothing is copied
+    void ExecuteChunked(Storage &storage, Value args, Value &out) override;
+
+private:
+    const std::string _tag;
 };
 
 } // namespace Execute
@@ -8,11 +8,23 @@
 namespace Afina {
 namespace Execute {
 
+/**
+ * # Storage statistics
+ * Reports statistics of the given group in memcached format: "STAT <name> <value>" line for each one, followed
+ * by "END". Empty group gives general statistics
+ */
 class Stats : public Command {
 public:
     Stats() {}
+    explicit Stats(const std::string &group) : _group(group) {}
     ~Stats() {}
+
+    const std::string &group() const { return _group; }
+
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    std::string _group;
 };
 
 } // namespace Execute
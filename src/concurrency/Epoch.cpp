@@ -0,0 +1,93 @@
+#include <afina/concurrency/Epoch.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace Afina {
+namespace Concurrency {
+
+namespace {
+
+// Retire tries to collect garbage once that many objects are waiting
+const std::size_t kCollectThreshold = 64;
+
+} // namespace
+
+// See Epoch.h
+EpochManager::~EpochManager() {
+    for (auto &retired : _limbo) {
+        retired.deleter(retired.ptr);
+    }
+}
+
+// See Epoch.h
+void EpochManager::Retire(void *ptr, void (*deleter)(void *)) {
+    std::size_t pending;
+    {
+        std::lock_guard<std::mutex> lk(_mtx);
+        _limbo.push_back(Retired{ptr, deleter, _global.load()});
+        pending = _limbo.size();
+    }
+
+    if (pending >= kCollectThreshold) {
+        Collect();
+    }
+}
+
+// See Epoch.h
+void EpochManager::Collect() {
+    TryAdvance();
+
+    // Readers that could see objects retired in epoch E are gone once global epoch reaches E + 2
+    const uint64_t safe = _global.load();
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> lk(_mtx);
+        auto it = std::find_if(_limbo.begin(), _limbo.end(),
+                               [safe](const Retired &retired) { return retired.epoch + 2 > safe; });
+        ready.assign(_limbo.begin(), it);
+        _limbo.erase(_limbo.begin(), it);
+    }
+
+    for (auto &retired : ready) {
+        retired.deleter(retired.ptr);
+    }
+}
+
+// See Epoch.h
+void EpochManager::Synchronize() {
+    // Guard created before the call announced at most the current epoch, it has to be gone
+    // before epoch could advance twice
+    const uint64_t target = _global.load() + 2;
+    while (_global.load() < target) {
+        if (!TryAdvance()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// See Epoch.h
+std::size_t EpochManager::Pending() {
+    std::lock_guard<std::mutex> lk(_mtx);
+    return _limbo.size();
+}
+
+bool EpochManager::TryAdvance() {
+    // Pairs with fence in Enter: either reader announce is visible here, or reader
+    // sees that object is unlinked already
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // Epoch could advance only if every active reader has observed the current one
+    uint64_t current = _global.load();
+    bool quiescent = true;
+    _records.for_each([&quiescent, current](Record &record) {
+        uint64_t epoch = record.epoch.load(std::memory_order_acquire);
+        if (epoch != 0 && epoch != current) {
+            quiescent = false;
+        }
+    });
+    return quiescent && _global.compare_exchange_strong(current, current + 1);
+}
+
+} // namespace Concurrency
+} // namespace Afina
@@ -10,7 +10,16 @@ namespace Execute {
 // hold data for this key".
 void Add::Execute(Storage &storage, const std::string &args, std::string &out) {
     std::cout << "Add(" << _key << ")" << args << std::endl;
-    out = storage.PutIfAbsent(_key, args) ? "STORED" : "NOT_STORED";
+
+    // Current value is never read, so that it isn't copied
+    auto add = [&args](bool found, const Storage::Current &, Value &value) -> Storage::Action {
+        if (found) {
+            return Storage::Action::kKeep;
+        }
+        value = Value(args);
+        return Storage::Action::kStore;
+    };
+    out = storage.Compute(_key, _hash, add) ? "STORED" : "NOT_STORED";
 }
 
 } // namespace Execute
@@ -0,0 +1,13 @@
+#include <afina/Storage.h>
+#include <afina/execute/ClientError.h>
+
+namespace Afina {
+namespace Execute {
+
+// See ClientError.h
+void ClientError::Execute(Storage &storage, const std::string &args, std::string &out) {
+    out = "CLIENT_ERROR " + _message;
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -1 +1,15 @@
+#include <afina/Storage.h>
 #include <afina/execute/Command.h>
+
+namespace Afina {
+namespace Execute {
+
+// See Command.h
+void Command::ExecuteChunked(Storage &storage, Value args, Value &out) {
+    std::string result;
+    Execute(storage, args.str(), result);
+    out = Value(std::move(result));
+}
+
+} // namespace Execute
+} // namespace Afina
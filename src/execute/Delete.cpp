@@ -0,0 +1,16 @@
+#include <afina/Storage.h>
+#include <afina/execute/Delete.h>
+
+#include <iostream>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "delete" means "remove the item with this key".
+void Delete::Execute(Storage &storage, const std::string &args, std::string &out) {
+    std::cout << "Delete(" << _key << ")" << std::endl;
+    out = storage.Delete(_key, _hash) ? "DELETED" : "NOT_FOUND";
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,13 @@
+#include <afina/Storage.h>
+#include <afina/execute/FlushAll.h>
+
+namespace Afina {
+namespace Execute {
+
+// See FlushAll.h
+void FlushAll::Execute(Storage &storage, const std::string &args, std::string &out) {
+    out = storage.FlushAll(_delay) ? "OK" : "SERVER_ERROR flush is not supported";
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -1,3 +1,4 @@
+#include <afina/KeyHash.h>
 #include <afina/Storage.h>
 #include <afina/execute/Get.h>
 
@@ -21,23 +22,37 @@ to indicate the end of response.
 
 */
 
+// See Get.h
+Get::Get(const std::vector<std::string> &keys, const std::vector<uint64_t> &hashes) : _keys(keys), _hashes(hashes) {
+    if (_hashes.size() != _keys.size()) {
+        _hashes.clear();
+        for (auto &key : _keys) {
+            _hashes.push_back(HashKey(key.data(), key.size()));
+        }
+    }
+}
+
 void Get::Execute(Storage &storage, const std::string &args, std::string &out) {
     std::stringstream keyStream;
     copy(_keys.begin(), _keys.end(), std::ostream_iterator<std::string>(keyStream, " "));
     std::cout << "Get(" << keyStream.str() << ")" << std::endl;
 
-    std::stringstream outStream;
-
-    std::string value;
-    for (auto &key : _keys) {
-        if (!storage.Get(key, value))
-            continue;
-        outStream << "VALUE " << key << " 0 " << value.size() << "\r\n";
-        outStream << value << "\r\n";
+    Value items;
+    for (std::size_t i = 0; i < _keys.size(); i++) {
+        storage.GetItem(_keys[i], _hashes[i], items);
     }
-    outStream << "END"; // networking layer should add the last \r\n
+    items.CopyTo(out);
+    out.append("END"); // networking layer should add the last \r\n
+}
 
-    out = outStream.str();
+// See Get.h
+void Get::ExecuteChunked(Storage &storage, Value args, Value &out) {
+    // Storage lays out items, small ones are usually kept in that form already
+    out.clear();
+    for (std::size_t i = 0; i < _keys.size(); i++) {
+        storage.GetItem(_keys[i], _hashes[i], out);
+    }
+    out.Append("END", 3); // networking layer should add the last \r\n
 }
 
 } // namespace Execute
@@ -0,0 +1,33 @@
+#include <afina/Storage.h>
+#include <afina/execute/Invalidate.h>
+
+#include <iostream>
+
+namespace Afina {
+namespace Execute {
+
+// See Invalidate.h
+void Invalidate::Execute(Storage &storage, const std::string &args, std::string &out) {
+    // Empty prefix matches every key, flush_all is there for that
+    for (auto &prefix : _prefixes) {
+        if (prefix.empty()) {
+            out = "CLIENT_ERROR empty prefix";
+            return;
+        }
+    }
+
+    std::size_t total = 0;
+    for (auto &prefix : _prefixes) {
+        std::cout << "Invalidate(" << prefix << ")" << std::endl;
+        std::size_t deleted = 0;
+        if (!storage.DeletePrefix(prefix, deleted)) {
+            out = "SERVER_ERROR prefix invalidation is not supported";
+            return;
+        }
+        total += deleted;
+    }
+    out = "DELETED " + std::to_string(total);
+}
+
+} // namespace Execute
+} // namespace Afina
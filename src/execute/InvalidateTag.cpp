@@ -0,0 +1,16 @@
+#include <afina/Storage.h>
+#include <afina/execute/InvalidateTag.h>
+
+#include <iostream>
+
+namespace Afina {
+namespace Execute {
+
+// See InvalidateTag.h
+void InvalidateTag::Execute(Storage &storage, const std::string &args, std::string &out) {
+    std::cout << "InvalidateTag(" << _tag << ")" << std::endl;
+    out = storage.InvalidateTag(_tag) ? "OK" : "SERVER_ERROR tags are not supported";
+}
+
+} // namespace Execute
+} // namespace Afina
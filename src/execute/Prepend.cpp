@@ -0,0 +1,21 @@
+#include <afina/Storage.h>
+#include <afina/execute/Prepend.h>
+
+#include <iostream>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "prepend" means "add this data to an existing key before existing data".
+void Prepend::Execute(Storage &storage, const std::string &args, std::string &out) {
+    std::cout << "Prepend(" << _key << ")" << args << std::endl;
+    out.assign(storage.Prepend(_key, _hash, Value(args)) ? "STORED" : "NOT_STORED");
+}
+
+// See Prepend.h
+void Prepend::ExecuteChunked(Storage &storage, Value args, Value &out) {
+    out = Value(storage.Prepend(_key, _hash, std::move(args)) ? "STORED" : "NOT_STORED");
+}
+
+} // namespace Execute
+} // namespace Afina
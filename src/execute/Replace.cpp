@@ -11,13 +11,16 @@ namespace Execute {
 
 void Replace::Execute(Storage &storage, const std::string &args, std::string &out) {
     std::cout << "Replace(" << _key << "): " << args << std::endl;
-    std::string value;
-    if (storage.Get(_key, value)) {
-        storage.Set(_key, args);
-        out = "STORED";
-    } else {
-        out = "NOT_STORED";
-    }
+
+    // Current value is never read, so that it isn't copied
+    auto replace = [&args](bool found, const Storage::Current &, Value &value) -> Storage::Action {
+        if (!found) {
+            return Storage::Action::kKeep;
+        }
+        value = Value(args);
+        return Storage::Action::kStore;
+    };
+    out = storage.Compute(_key, _hash, replace) ? "STORED" : "NOT_STORED";
 }
 
 } // namespace Execute
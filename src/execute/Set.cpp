@@ -9,9 +9,24 @@ namespace Execute {
 // memcached protocol: "set" means "store this data".
 void Set::Execute(Storage &storage, const std::string &args, std::string &out) {
     std::cout << "Set(" << _key << "): " << args << std::endl;
-    storage.Put(_key, args);
+    if (!_tag.empty()) {
+        out = storage.PutTagged(_key, _hash, args, _tag) ? "STORED" : "NOT_STORED";
+        return;
+    }
+    storage.PutValue(_key, _hash, Value(args));
     out = "STORED";
 }
 
+// See Set.h
+void Set::ExecuteChunked(Storage &storage, Value args, Value &out) {
+    if (!_tag.empty()) {
+        // Tagged items are stored in one piece
+        Command::ExecuteChunked(storage, std::move(args), out);
+        return;
+    }
+    storage.PutValue(_key, _hash, std::move(args));
+    out = Value("STORED");
+}
+
 } // namespace Execute
 } // namespace Afina
@@ -1,6 +1,11 @@
+#include <cctype>
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include <atomic>
 #include <semaphore.h>
@@ -21,6 +26,12 @@
 #include "network/st_coroutine/ServerImpl.h"
 #include "network/st_nonblocking/ServerImpl.h"
 
+#include "storage/EpochLRU.h"
+#include "storage/FixedWidthLRU.h"
+#include "storage/FlatCombinedLRU.h"
+#include "storage/LogStructuredLRU.h"
+#include "storage/MemoryGovernor.h"
+#include "storage/Namespaces.h"
 #include "storage/SimpleLRU.h"
 #include "storage/ThreadSafeSimpleLRU.h"
 #include "storage/StripedLockLRU.h"
@@ -52,14 +63,51 @@ public:
             storage_type = options["storage"].as<std::string>();
         }
 
-        if (storage_type == "st_lru") {
-            storage = std::make_shared<Afina::Backend::SimpleLRU>();
-        } else if (storage_type == "mt_lru") {
-            storage = std::make_shared<Afina::Backend::ThreadSafeSimplLRU>();
-        } else if (storage_type == "mt_slru") {
-            storage = std::make_shared<Afina::Backend::StripedLockLRU>();
-        } else {
-            throw std::runtime_error("Unknown storage type");
+        Afina::Backend::Config storage_config;
+        storage_config.arena.enabled = options.count("arena") > 0;
+        storage_config.arena.prefault = options.count("prefault") > 0;
+        storage_config.arena.mlock = options.count("mlock") > 0;
+        storage_config.write_behind = options.count("write-behind") > 0;
+        storage_config.filter = options.count("filter") > 0;
+        if (options.count("dedup") > 0) {
+            storage_config.dedup_threshold = options["dedup"].as<std::size_t>();
+        }
+        if (options.count("mrc") > 0) {
+            storage_config.mrc_sample_rate = options["mrc"].as<double>();
+        }
+        if (options.count("hot-keys") > 0) {
+            storage_config.hot_keys = options["hot-keys"].as<std::size_t>();
+        }
+        if (options.count("max-stripes") > 0) {
+            storage_config.max_stripes = options["max-stripes"].as<std::size_t>();
+        }
+        if (options.count("background-eviction") > 0) {
+            storage_config.low_watermark = 0.8;
+            storage_config.high_watermark = 0.9;
+        }
+
+        storage = MakeStorage(storage_type, 1024, storage_config, options);
+
+        // Each namespace gets storage of its own, keys matching none of them stay in the one built above
+        if (options.count("namespace") > 0) {
+            auto namespaces = std::make_shared<Afina::Backend::Namespaces>(storage);
+            for (auto &spec : options["namespace"].as<std::vector<std::string>>()) {
+                std::string name, prefix, type = storage_type;
+                std::size_t budget;
+                ParseNamespace(spec, name, prefix, budget, type);
+                namespaces->Add(name, prefix, MakeStorage(type, budget, storage_config, options));
+            }
+            storage = namespaces;
+        }
+
+        // Limit follows memory pressure of the cgroup, storage must be able to change it
+        if (options.count("cgroup") > 0) {
+            if (!storage->SetLimitScale(1)) {
+                throw std::runtime_error("Storage limit is fixed, memory governor is not supported");
+            }
+            Afina::Backend::GovernorConfig governor_config;
+            governor_config.cgroup = options["cgroup"].as<std::string>();
+            governor.reset(new Afina::Backend::MemoryGovernor(storage, governor_config));
         }
 
         // Step 2: Configure network
@@ -91,6 +139,9 @@ public:
 
         log->warn("Start storage");
         storage->Start();
+        if (governor) {
+            governor->Start();
+        }
 
         // TODO: configure network service
         const uint16_t port = 8080;
@@ -105,15 +156,117 @@ public:
         server->Stop();
         server->Join();
 
+        if (governor) {
+            governor->Stop();
+        }
         storage->Stop();
         logService->Stop();
     }
 
 private:
+    // Storage of the given type and memory limit
+    static std::shared_ptr<Afina::Storage> MakeStorage(const std::string &storage_type, std::size_t max_size,
+                                                       const Afina::Backend::Config &storage_config,
+                                                       const cxxopts::Options &options) {
+        // Storage types are instantiations of the LRU template, policies are chosen here once and for all
+        const Afina::Backend::ArenaConfig &arena = storage_config.arena;
+        if (storage_type == "st_lru" || storage_type == "mt_lru") {
+            if (options.count("art-index") > 0) {
+                return MakeLRU<Afina::Backend::ArtIndex>(storage_type, max_size, storage_config, options);
+            } else if (options.count("hash-index") > 0) {
+                return MakeLRU<Afina::Backend::HashIndex>(storage_type, max_size, storage_config, options);
+            }
+            return MakeLRU<Afina::Backend::OrderedIndex>(storage_type, max_size, storage_config, options);
+        } else if (storage_type == "mt_slru") {
+            return std::make_shared<Afina::Backend::StripedLockLRU>(max_size, 4, storage_config);
+        } else if (storage_type == "mt_epoch") {
+            return std::make_shared<Afina::Backend::EpochLRU>(max_size);
+        } else if (storage_type == "mt_log") {
+            return std::make_shared<Afina::Backend::LogStructuredLRU>(max_size);
+        } else if (storage_type == "mt_fixed8") {
+            return std::make_shared<Afina::Backend::FixedWidthLRU<8>>(max_size);
+        } else if (storage_type == "mt_fixed16") {
+            return std::make_shared<Afina::Backend::FixedWidthLRU<16>>(max_size);
+        } else if (storage_type == "mt_fc") {
+            return std::make_shared<Afina::Backend::FlatCombinedLRU>(max_size, arena);
+        }
+        throw std::runtime_error("Unknown storage type");
+    }
+
+    // Namespace is given as <name>,<prefix>,<bytes>[,<storage type>], type is left as it is if there is none
+    static void ParseNamespace(const std::string &spec, std::string &name, std::string &prefix, std::size_t &budget,
+                               std::string &storage_type) {
+        std::vector<std::string> fields;
+        std::size_t start = 0;
+        for (std::size_t comma; (comma = spec.find(',', start)) != std::string::npos; start = comma + 1) {
+            fields.push_back(spec.substr(start, comma - start));
+        }
+        fields.push_back(spec.substr(start));
+
+        char *end = nullptr;
+        if (fields.size() == 3 || fields.size() == 4) {
+            budget = std::strtoull(fields[2].c_str(), &end, 10);
+        }
+        if (end == nullptr || !std::isdigit(fields[2][0]) || *end != '\0' || fields[0].empty() || fields[1].empty()) {
+            throw std::runtime_error("Invalid namespace: " + spec);
+        }
+        name = fields[0];
+        prefix = fields[1];
+        if (fields.size() == 4) {
+            storage_type = fields[3];
+        }
+    }
+
+    // LRU indexed by the given policy, operations are counted unless counters are turned off
+    template <typename Index>
+    static std::shared_ptr<Afina::Storage> MakeLRU(const std::string &storage_type, std::size_t max_size,
+                                                   const Afina::Backend::Config &config,
+                                                   const cxxopts::Options &options) {
+        using Afina::Backend::BasicLRU;
+        const bool counters = options.count("no-counters") == 0;
+        const bool spin_lock = options.count("spin-lock") > 0;
+        if (storage_type == "st_lru" && counters) {
+            return MakeSingleThreaded<BasicLRU<Index, Afina::Backend::Counters>>(max_size, config);
+        } else if (storage_type == "st_lru") {
+            return MakeSingleThreaded<BasicLRU<Index, Afina::Backend::NullCounters>>(max_size, config);
+        } else if (counters) {
+            return MakeThreadSafe<BasicLRU<Index, Afina::Backend::Counters>>(spin_lock, max_size, config);
+        }
+        return MakeThreadSafe<BasicLRU<Index, Afina::Backend::NullCounters>>(spin_lock, max_size, config);
+    }
+
+    // Cache used as is, without any synchronization
+    template <typename Cache>
+    static std::shared_ptr<Afina::Storage> MakeSingleThreaded(std::size_t max_size,
+                                                              const Afina::Backend::Config &config) {
+        auto cache = std::make_shared<Cache>(max_size, config.arena);
+        if (config.dedup_threshold > 0) {
+            cache->EnableDedup(config.dedup_threshold);
+        }
+        if (config.mrc_sample_rate > 0) {
+            cache->EnableMissRatioCurve(config.mrc_sample_rate);
+        }
+        if (config.hot_keys > 0) {
+            cache->SetHeavyHitters(std::make_shared<Afina::Backend::HeavyHitters>(config.hot_keys));
+        }
+        return cache;
+    }
+
+    // Thread safe LRU on top of the given cache type
+    template <typename Cache>
+    static std::shared_ptr<Afina::Storage> MakeThreadSafe(bool spin_lock, std::size_t max_size,
+                                                          const Afina::Backend::Config &config) {
+        if (spin_lock) {
+            return std::make_shared<Afina::Backend::ThreadSafeLRU<Afina::Backend::SpinLock, Cache>>(max_size, config);
+        }
+        return std::make_shared<Afina::Backend::ThreadSafeLRU<std::mutex, Cache>>(max_size, config);
+    }
+
     std::shared_ptr<Logging::Config> logConfig;
     std::shared_ptr<Logging::Service> logService;
 
     std::shared_ptr<Afina::Storage> storage;
+    std::unique_ptr<Afina::Backend::MemoryGovernor> governor;
     std::shared_ptr<Network::Server> server;
 };
 
@@ -135,6 +288,30 @@ int main(int argc, char **argv) {
         // and simplify validation below
         options.add_options()("s,storage", "Type of storage service to use", cxxopts::value<std::string>());
         options.add_options()("n,network", "Type of network service to use", cxxopts::value<std::string>());
+        options.add_options()("arena", "Allocate storage items from huge page backed arena");
+        options.add_options()("prefault", "Prefault storage arena on start");
+        options.add_options()("mlock", "Lock storage arena in memory on start");
+        options.add_options()("write-behind", "Queue puts and apply them in batches (mt_lru, mt_slru)");
+        options.add_options()("background-eviction",
+                              "Keep storage below 80% of limit by background eviction (mt_lru, mt_slru)");
+        options.add_options()("filter", "Answer lookups of absent keys by lock free cuckoo filter (mt_lru, mt_slru)");
+        options.add_options()("dedup", "Store values of at least that many bytes once (st_lru, mt_lru, mt_slru)",
+                              cxxopts::value<std::size_t>());
+        options.add_options()("mrc", "Estimate miss ratio curve by that fraction of keys (st_lru, mt_lru, mt_slru)",
+                              cxxopts::value<double>());
+        options.add_options()("hot-keys", "Track that many most accessed keys (st_lru, mt_lru, mt_slru)",
+                              cxxopts::value<std::size_t>());
+        options.add_options()("max-stripes", "Split locks under contention up to that many (mt_slru)",
+                              cxxopts::value<std::size_t>());
+        options.add_options()("cgroup", "Shrink storage under memory pressure of that cgroup v2 (mt_lru, mt_slru)",
+                              cxxopts::value<std::string>());
+        options.add_options()("namespace", "Keep keys starting with prefix in storage of their own, as "
+                                            "<name>,<prefix>,<bytes>[,<storage>], could be repeated",
+                              cxxopts::value<std::vector<std::string>>());
+        options.add_options()("hash-index", "Index storage items by hash table instead of tree (st_lru, mt_lru)");
+        options.add_options()("art-index", "Index storage items by adaptive radix tree instead of tree (st_lru, mt_lru)");
+        options.add_options()("spin-lock", "Guard storage by spin lock instead of mutex (mt_lru)");
+        options.add_options()("no-counters", "Don't count operations, stats reports sizes only (st_lru, mt_lru)");
         options.add_options()("h,help", "Print usage info");
         options.parse(argc, argv);
 
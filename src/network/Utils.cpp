@@ -0,0 +1,40 @@
+#include "Utils.h"
+
+#include <stdexcept>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace Afina {
+namespace Network {
+
+// See Utils.h
+void send_value(int client_socket, const Value &value) {
+    struct iovec iov[64];
+    std::size_t chunk = 0, offset = 0;
+    while (chunk < value.chunks()) {
+        int iovcnt = 0;
+        for (std::size_t i = chunk; i < value.chunks() && iovcnt < 64; i++, iovcnt++) {
+            std::size_t skip = (i == chunk) ? offset : 0;
+            iov[iovcnt].iov_base = const_cast<char *>(value.chunk(i).data()) + skip;
+            iov[iovcnt].iov_len = value.chunk(i).size() - skip;
+        }
+
+        ssize_t sent = writev(client_socket, iov, iovcnt);
+        if (sent <= 0) {
+            throw std::runtime_error("Failed to send response");
+        }
+
+        // Skip completely written chunks, the last one could be written partially
+        std::size_t written = sent;
+        while (chunk < value.chunks() && written >= value.chunk(chunk).size() - offset) {
+            written -= value.chunk(chunk).size() - offset;
+            chunk++;
+            offset = 0;
+        }
+        offset += written;
+    }
+}
+
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,18 @@
+#ifndef AFINA_NETWORK_UTILS_H
+#define AFINA_NETWORK_UTILS_H
+
+#include <afina/Value.h>
+
+namespace Afina {
+namespace Network {
+
+/**
+ * Writes all chunks of the response to the blocking socket with as few syscalls as possible, response is never
+ * glued together. Throws if socket fails
+ */
+void send_value(int client_socket, const Value &value);
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_UTILS_H
@@ -22,6 +22,7 @@
 #include <afina/logging/Service.h>
 #include <afina/concurrency/Executor.h>
 
+#include "network/Utils.h"
 #include "protocol/Parser.h"
 
 namespace Afina {
@@ -183,7 +184,7 @@ void ServerImpl::OnHandleClientRequest(int client_socket) {
     // - argument_for_command: buffer stores argument
     std::size_t arg_remains;
     Protocol::Parser parser;
-    std::string argument_for_command;
+    Afina::Value argument_for_command;
     std::unique_ptr<Execute::Command> command_to_execute;
 
     // Process new connection:
@@ -212,6 +213,9 @@ void ServerImpl::OnHandleClientRequest(int client_socket) {
                         command_to_execute = parser.Build(arg_remains);
                         if (arg_remains > 0) {
                             arg_remains += 2;
+
+                            // Argument chunks are allocated at their final size and never regrow
+                            argument_for_command.Reserve(arg_remains);
                         }
                     }
 
@@ -230,7 +234,7 @@ void ServerImpl::OnHandleClientRequest(int client_socket) {
                     _logger->debug("Fill argument: {} bytes of {}", readed_bytes, arg_remains);
                     // There is some parsed command, and now we are reading argument
                     std::size_t to_read = std::min(arg_remains, std::size_t(readed_bytes));
-                    argument_for_command.append(client_buffer, to_read);
+                    argument_for_command.Append(client_buffer, to_read);
 
                     std::memmove(client_buffer, client_buffer + to_read, readed_bytes - to_read);
                     arg_remains -= to_read;
@@ -241,21 +245,19 @@ void ServerImpl::OnHandleClientRequest(int client_socket) {
                 if (command_to_execute && arg_remains == 0) {
                     _logger->debug("Start command execution");
 
-                    std::string result;
+                    Afina::Value result;
                     if (argument_for_command.size()) {
-                        argument_for_command.resize(argument_for_command.size() - 2);
+                        argument_for_command.Truncate(argument_for_command.size() - 2);
                     }
-                    command_to_execute->Execute(*pStorage, argument_for_command, result);
+                    command_to_execute->ExecuteChunked(*pStorage, std::move(argument_for_command), result);
 
                     // Send response
-                    result += "\r\n";
-                    if (send(client_socket, result.data(), result.size(), 0) <= 0) {
-                        throw std::runtime_error("Failed to send response");
-                    }
+                    result.Append("\r\n", 2);
+                    send_value(client_socket, result);
 
                     // Prepare for the next command
                     command_to_execute.reset();
-                    argument_for_command.resize(0);
+                    argument_for_command.clear();
                     parser.Reset();
                 }
             } // while (readed_bytes)
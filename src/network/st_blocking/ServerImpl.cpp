@@ -21,6 +21,7 @@
 #include <afina/execute/Command.h>
 #include <afina/logging/Service.h>
 
+#include "network/Utils.h"
 #include "protocol/Parser.h"
 
 namespace Afina {
@@ -127,7 +128,7 @@ void ServerImpl::OnRun() {
     // - argument_for_command: buffer stores argument
     std::size_t arg_remains;
     Protocol::Parser parser;
-    std::string argument_for_command;
+    Afina::Value argument_for_command;
     std::unique_ptr<Execute::Command> command_to_execute;
     while (running.load()) {
         _logger->debug("waiting for connection...");
@@ -187,6 +188,9 @@ void ServerImpl::OnRun() {
                             command_to_execute = parser.Build(arg_remains);
                             if (arg_remains > 0) {
                                 arg_remains += 2;
+
+                                // Argument chunks are allocated at their final size and never regrow
+                                argument_for_command.Reserve(arg_remains);
                             }
                         }
 
@@ -205,7 +209,7 @@ void ServerImpl::OnRun() {
                         _logger->debug("Fill argument: {} bytes of {}", readed_bytes, arg_remains);
                         // There is some parsed command, and now we are reading argument
                         std::size_t to_read = std::min(arg_remains, std::size_t(readed_bytes));
-                        argument_for_command.append(client_buffer, to_read);
+                        argument_for_command.Append(client_buffer, to_read);
 
                         std::memmove(client_buffer, client_buffer + to_read, readed_bytes - to_read);
                         arg_remains -= to_read;
@@ -216,21 +220,19 @@ void ServerImpl::OnRun() {
                     if (command_to_execute && arg_remains == 0) {
                         _logger->debug("Start command execution");
 
-                        std::string result;
+                        Afina::Value result;
                         if (argument_for_command.size()) {
-                            argument_for_command.resize(argument_for_command.size() - 2);
+                            argument_for_command.Truncate(argument_for_command.size() - 2);
                         }
-                        command_to_execute->Execute(*pStorage, argument_for_command, result);
+                        command_to_execute->ExecuteChunked(*pStorage, std::move(argument_for_command), result);
 
                         // Send response
-                        result += "\r\n";
-                        if (send(client_socket, result.data(), result.size(), 0) <= 0) {
-                            throw std::runtime_error("Failed to send response");
-                        }
+                        result.Append("\r\n", 2);
+                        send_value(client_socket, result);
 
                         // Prepare for the next command
                         command_to_execute.reset();
-                        argument_for_command.resize(0);
+                        argument_for_command.clear();
                         parser.Reset();
                     }
                 } // while (readed_bytes)
@@ -250,7 +252,7 @@ void ServerImpl::OnRun() {
 
         // Prepare for the next command: just in case if connection was closed in the middle of executing something
         command_to_execute.reset();
-        argument_for_command.resize(0);
+        argument_for_command.clear();
         parser.Reset();
     }
 
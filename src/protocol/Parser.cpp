@@ -6,9 +6,15 @@
 
 #include <afina/execute/Add.h>
 #include <afina/execute/Append.h>
+#include <afina/execute/ClientError.h>
 #include <afina/execute/Command.h>
 #include <afina/execute/Delete.h>
+#include <afina/execute/FlushAll.h>
 #include <afina/execute/Get.h>
+#include <afina/execute/Invalidate.h>
+#include <afina/execute/InvalidateTag.h>
+#include <afina/execute/Prepend.h>
+#include <afina/execute/Replace.h>
 #include <afina/execute/Set.h>
 #include <afina/execute/Stats.h>
 
@@ -28,13 +34,34 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
         case State::sName: {
             if (c == ' ' || c == '\r') {
                 // std::cout << "parser debug: name='" << name << "'" << std::endl;
-                if (name == "set" || name == "add" || name == "append" || name == "prepend") {
+                if (name == "set" || name == "add" || name == "replace" || name == "append" || name == "prepend") {
                     state = State::spKey;
                 } else if (name == "get" || name == "gets") {
                     state = State::sgKey;
+                } else if (name == "stats" && c == ' ') {
+                    // Group of statistics is parsed the same way as keys of get
+                    state = State::sgKey;
                 } else if (name == "stats") {
                     state = State::sLF;
                     continue;
+                } else if (name == "delete") {
+                    // Key is parsed the same way as keys of get
+                    if (c != ' ') {
+                        throw std::runtime_error("Client provides no key to delete");
+                    }
+                    state = State::sgKey;
+                } else if (name == "flush_all" && c == ' ') {
+                    // Delay is parsed the same way as keys of get
+                    state = State::sgKey;
+                } else if (name == "flush_all") {
+                    state = State::sLF;
+                    continue;
+                } else if (name == "invalidate" || name == "invalidate_tag") {
+                    // Prefixes and tag are parsed the same way as keys of get
+                    if (c != ' ') {
+                        throw std::runtime_error("Client provides nothing to invalidate");
+                    }
+                    state = State::sgKey;
                 } else {
                     throw std::runtime_error("Unknown command name: " + name);
                 }
@@ -48,31 +75,37 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
             if (c == ' ') {
                 state = State::spFlags;
                 keys.push_back(curKey);
+                hashes.push_back(hasher.Digest());
                 // std::cout << "parser debug: key[" << keys.size() - 1 << "]='" << curKey << "'" << std::endl;
             } else {
                 curKey.push_back(c);
+                hasher.Update(c);
             }
             break;
         }
 
         case State::sgKey: {
-            if (c == '\r') {
-                keys.push_back(curKey);
-                // std::cout << "parser debug: total '" << keys.size() << " keys" << std::endl;
+            if (c == '\r' || c == ' ') {
+                // Repeated and trailing spaces give no empty keys, empty prefix would match every key
+                if (!curKey.empty()) {
+                    // std::cout << "parser debug: key[" << keys.size() << "]='" << curKey << "'" << std::endl;
+                    keys.push_back(curKey);
+                    hashes.push_back(hasher.Digest());
+                    curKey.clear();
+                    hasher.Reset();
+                }
+                if (c == ' ') {
+                    break;
+                }
 
-                if (keys.size() == 0) {
+                // Statistics group and flush delay are optional
+                if (keys.empty() && name != "stats" && name != "flush_all") {
                     throw std::runtime_error("Client provides no key to retrive");
                 }
-
-                curKey.clear();
                 state = State::sLF;
-            } else if (c == ' ') {
-                // std::cout << "parser debug: key[" << keys.size() << "]='" << curKey << "'" << std::endl;
-                state = State::sgKey;
-                keys.push_back(curKey);
-                curKey.clear();
             } else {
                 curKey.push_back(c);
+                hasher.Update(c);
             }
             break;
         }
@@ -130,6 +163,8 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
             if (c == '\r') {
                 state = State::sLF;
                 // std::cout << "parser debug: bytes='" << bytes << "'" << std::endl;
+            } else if (c == ' ') {
+                state = State::spOption;
             } else if (c >= '0' && c <= '9') {
                 uint32_t b = (bytes * 10) + (c - '0');
                 if (b < bytes) {
@@ -141,6 +176,21 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
             break;
         }
 
+        case State::spOption: {
+            if (c == ' ' || c == '\r') {
+                if (option.compare(0, 4, "tag:") == 0) {
+                    tag = option.substr(4);
+                }
+                option.clear();
+                if (c == '\r') {
+                    state = State::sLF;
+                }
+            } else {
+                option.push_back(c);
+            }
+            break;
+        }
+
         case State::sLF: {
             if (c == '\n') {
                 parse_complete = true;
@@ -168,27 +218,70 @@ std::unique_ptr<Execute::Command> Parser::Build(size_t &body_size) const {
     }
 
     body_size = bytes;
-    if (name == "set") {
-        return std::unique_ptr<Execute::Command>(new Execute::Set(keys[0], flags, exprtime));
+    if (!tag.empty() && name != "set") {
+        // Whole command is read already, so that connection could go on
+        return std::unique_ptr<Execute::Command>(new Execute::ClientError("only set stores tags"));
+    } else if (name == "set") {
+        return std::unique_ptr<Execute::Command>(new Execute::Set(keys[0], flags, exprtime, tag, hashes[0]));
     } else if (name == "add") {
-        return std::unique_ptr<Execute::Command>(new Execute::Add(keys[0], flags, exprtime));
+        return std::unique_ptr<Execute::Command>(new Execute::Add(keys[0], flags, exprtime, hashes[0]));
+    } else if (name == "replace") {
+        return std::unique_ptr<Execute::Command>(new Execute::Replace(keys[0], flags, exprtime, hashes[0]));
     } else if (name == "append") {
-        return std::unique_ptr<Execute::Command>(new Execute::Append(keys[0], flags, exprtime));
+        return std::unique_ptr<Execute::Command>(new Execute::Append(keys[0], flags, exprtime, hashes[0]));
+    } else if (name == "prepend") {
+        return std::unique_ptr<Execute::Command>(new Execute::Prepend(keys[0], flags, exprtime, hashes[0]));
     } else if (name == "get") {
-        return std::unique_ptr<Execute::Command>(new Execute::Get(keys));
+        return std::unique_ptr<Execute::Command>(new Execute::Get(keys, hashes));
+    } else if (name == "delete") {
+        return std::unique_ptr<Execute::Command>(new Execute::Delete(keys[0], hashes[0]));
+    } else if (name == "flush_all") {
+        return std::unique_ptr<Execute::Command>(new Execute::FlushAll(ParseDelay()));
+    } else if (name == "invalidate") {
+        return std::unique_ptr<Execute::Command>(new Execute::Invalidate(keys));
+    } else if (name == "invalidate_tag") {
+        if (keys.size() != 1) {
+            return std::unique_ptr<Execute::Command>(new Execute::ClientError("invalidate_tag takes one tag"));
+        }
+        return std::unique_ptr<Execute::Command>(new Execute::InvalidateTag(keys[0]));
     } else if (name == "stats") {
-        return std::unique_ptr<Execute::Command>(new Execute::Stats());
+        return std::unique_ptr<Execute::Command>(new Execute::Stats(keys.empty() ? "" : keys[0]));
     } else {
         throw std::runtime_error("Unsupported command");
     }
 }
 
+// See Parse.h
+uint32_t Parser::ParseDelay() const {
+    // "noreply" could come in place of the delay
+    if (keys.empty() || keys[0] == "noreply") {
+        return 0;
+    }
+
+    uint32_t delay = 0;
+    for (char c : keys[0]) {
+        if (c < '0' || c > '9') {
+            throw std::runtime_error("Invalid flush delay: " + keys[0]);
+        }
+        uint32_t d = delay * 10 + (c - '0');
+        if (d < delay) {
+            throw std::runtime_error("Flush delay overflow");
+        }
+        delay = d;
+    }
+    return delay;
+}
+
 // See Parse.h
 void Parser::Reset() {
     state = State::sName;
     name.clear();
     keys.clear();
+    hashes.clear();
     curKey.clear();
+    hasher.Reset();
+    option.clear();
+    tag.clear();
     parse_complete = false;
     flags = 0;
     bytes = 0;
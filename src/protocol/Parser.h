@@ -8,6 +8,8 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <afina/KeyHash.h>
+
 namespace Afina {
 namespace Execute {
 class Command;
@@ -62,7 +64,10 @@ private:
      * - sp: for PUT commands only
      * - sg: for GET commands only
      */
-    enum State : uint16_t { sCR, sLF, sName, spKey, spFlags, spExprTimeStart, spExprTime, spBytes, sgKey };
+    enum State : uint16_t { sCR, sLF, sName, spKey, spFlags, spExprTimeStart, spExprTime, spBytes, spOption, sgKey };
+
+    // Delay argument of flush_all, 0 if there is none
+    uint32_t ParseDelay() const;
 
     // Current parser state
     State state;
@@ -71,6 +76,10 @@ private:
     std::string name;
     std::vector<std::string> keys;
 
+    // Hashes of keys, computed byte by byte while keys are read, so that no layer below hashes them again
+    std::vector<uint64_t> hashes;
+    KeyHasher hasher;
+
     // <flags> is an arbitrary 16-bit unsigned integer (written out in decimal) that the server stores along with
     // the data and sends back when the item is retrieved. Clients may use this as a bit field to store data-specific
     //  information; this field is opaque to the server. Note that in memcached 1.2.1 and higher, flags may be 32-bits,
@@ -88,6 +97,10 @@ private:
     // it's followed by an empty data block).
     uint32_t bytes;
 
+    // Options following <bytes>, only "tag:<name>" is recognized, the rest (i.e. "noreply") are ignored
+    std::string option;
+    std::string tag;
+
     bool negative;
     std::string curKey;
     bool parse_complete;
@@ -0,0 +1,129 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// Every block handed out by the arena is aligned by that value
+const std::size_t kAlignment = 16;
+
+// Blocks larger than that go to the heap directly
+const std::size_t kMaxClassSize = 256 * 1024;
+
+// Huge page size on x86_64, region is rounded up to the multiple of it
+const std::size_t kHugePageSize = 2 * 1024 * 1024;
+
+inline std::size_t align_up(std::size_t value, std::size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+// See Arena.h
+Arena::Arena(std::size_t size, const ArenaConfig &config)
+    : _config(config), _base(nullptr), _size(align_up(std::max(size, kHugePageSize), kHugePageSize)),
+      _hugetlb(false) {
+    void *region = MAP_FAILED;
+    if (_config.huge_pages) {
+        region = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        _hugetlb = (region != MAP_FAILED);
+    }
+
+    if (region == MAP_FAILED) {
+        // No reserved huge pages in the system, fallback to regular pages
+        region = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) {
+            throw std::runtime_error("Failed to map storage arena: " + std::string(strerror(errno)));
+        }
+
+#ifdef MADV_HUGEPAGE
+        // Ask for transparent huge pages, it is only a hint so errors are ignored
+        if (_config.huge_pages) {
+            madvise(region, _size, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    _base = static_cast<char *>(region);
+    _top = _base;
+
+    // Classes grow by ~25%, so that internal fragmentation is bounded the same way as in memcached slabs
+    for (std::size_t cls = kAlignment; cls <= kMaxClassSize;) {
+        _class_size.push_back(cls);
+        cls = std::max(cls + kAlignment, align_up(cls + cls / 4, kAlignment));
+    }
+    _free.resize(_class_size.size(), nullptr);
+}
+
+// See Arena.h
+Arena::~Arena() { munmap(_base, _size); }
+
+// See Arena.h
+void Arena::Start() {
+    if (_config.prefault || _config.mlock) {
+        // Write fault every page, so that kernel backs whole region right now instead of
+        // in the middle of some request
+        const std::size_t page = sysconf(_SC_PAGESIZE);
+        for (std::size_t offset = 0; offset < _size; offset += page) {
+            *static_cast<volatile char *>(_base + offset) = *(_base + offset);
+        }
+    }
+
+    if (_config.mlock && mlock(_base, _size) != 0) {
+        throw std::runtime_error("Failed to mlock storage arena: " + std::string(strerror(errno)));
+    }
+}
+
+// See Arena.h
+void *Arena::Allocate(std::size_t size) {
+    std::size_t cls = SizeClass(size);
+    if (cls == _class_size.size()) {
+        return ::operator new(size);
+    }
+
+    // Reuse previously freed block
+    void *block = _free[cls];
+    if (block != nullptr) {
+        _free[cls] = *static_cast<void **>(block);
+        return block;
+    }
+
+    // Bump allocation from the untouched part of the region
+    if (std::size_t(_base + _size - _top) >= _class_size[cls]) {
+        block = _top;
+        _top += _class_size[cls];
+        return block;
+    }
+
+    return ::operator new(size);
+}
+
+// See Arena.h
+void Arena::Deallocate(void *ptr, std::size_t size) {
+    if (!Contains(ptr)) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    std::size_t cls = SizeClass(size);
+    *static_cast<void **>(ptr) = _free[cls];
+    _free[cls] = ptr;
+}
+
+// See Arena.h
+std::size_t Arena::SizeClass(std::size_t size) const {
+    return std::lower_bound(_class_size.begin(), _class_size.end(), size) - _class_size.begin();
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,141 @@
+#ifndef AFINA_STORAGE_ARENA_H
+#define AFINA_STORAGE_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Arena configuration
+ * By default arena is disabled and storage allocates from the general purpose heap
+ */
+struct ArenaConfig {
+    // Allocate items from the dedicated arena instead of the heap
+    bool enabled = false;
+
+    // Try explicit huge pages (MAP_HUGETLB) first, then transparent ones (MADV_HUGEPAGE)
+    bool huge_pages = true;
+
+    // Touch every page of the arena on Start, so that no page fault happens on the request path
+    bool prefault = false;
+
+    // mlock arena on Start, so that kernel never swaps it out. Implies prefault
+    bool mlock = false;
+
+    // Size of the region to reserve, 0 means "twice the storage limit"
+    std::size_t size = 0;
+};
+
+/**
+ * # Memory arena for storage items
+ * Reserves one contiguous region of virtual memory up front, backed by huge pages whenever kernel allows that, so
+ * that lookups over many GB of small items do not pay for TLB misses. Region is carved into size classes:
+ * freed blocks go to the per-class free list and get reused by the next allocation of the same class.
+ *
+ * Once region is exhausted or requested block is too large, allocation falls back to the heap.
+ * That is NOT thread safe implementation!!
+ */
+class Arena {
+public:
+    Arena(std::size_t size, const ArenaConfig &config);
+    ~Arena();
+
+    /**
+     * Applies prefault/mlock options, must be called before storage starts serving requests
+     */
+    void Start();
+
+    /**
+     * Allocates block of at least size bytes aligned by alignof(std::max_align_t)
+     */
+    void *Allocate(std::size_t size);
+
+    /**
+     * Returns block back to the arena, size must be the same as was passed into Allocate
+     */
+    void Deallocate(void *ptr, std::size_t size);
+
+    inline bool Contains(const void *ptr) const {
+        return static_cast<const char *>(ptr) >= _base && static_cast<const char *>(ptr) < _base + _size;
+    }
+
+    // True if region is backed by explicit huge pages
+    inline bool huge_pages() const { return _hugetlb; }
+
+    // Size of the reserved region
+    inline std::size_t size() const { return _size; }
+
+    // Number of bytes handed out from the region (including free lists)
+    inline std::size_t used() const { return _top - _base; }
+
+private:
+    Arena(const Arena &);            // = delete;
+    Arena &operator=(const Arena &); // = delete;
+
+    // Index of the smallest class that fits given size, or _class_size.size() if there is none
+    std::size_t SizeClass(std::size_t size) const;
+
+    const ArenaConfig _config;
+
+    // Reserved region
+    char *_base;
+    std::size_t _size;
+    bool _hugetlb;
+
+    // Bump pointer: everything before was handed out at least once
+    char *_top;
+
+    // Upper bound of each size class, ascending
+    std::vector<std::size_t> _class_size;
+
+    // Heads of intrusive free lists, one per size class
+    std::vector<void *> _free;
+};
+
+/**
+ * # STL allocator on top of the Arena
+ * Allocator without arena uses global operator new
+ */
+template <typename T> class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator(Arena *arena = nullptr) : _arena(arena) {}
+    template <typename U> ArenaAllocator(const ArenaAllocator<U> &other) : _arena(other.arena()) {}
+
+    T *allocate(std::size_t n) {
+        if (_arena != nullptr) {
+            return static_cast<T *>(_arena->Allocate(n * sizeof(T)));
+        }
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *ptr, std::size_t n) {
+        if (_arena != nullptr) {
+            _arena->Deallocate(ptr, n * sizeof(T));
+        } else {
+            ::operator delete(ptr);
+        }
+    }
+
+    inline Arena *arena() const { return _arena; }
+
+private:
+    Arena *_arena;
+};
+
+template <typename T, typename U> bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U> bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+    return a.arena() != b.arena();
+}
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_ARENA_H
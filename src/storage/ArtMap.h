@@ -0,0 +1,783 @@
+#ifndef AFINA_STORAGE_ART_MAP_H
+#define AFINA_STORAGE_ART_MAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Adaptive radix tree
+ * Map from byte string keys ordered the same way as std::string, see "The Adaptive Radix Tree: ARTful Indexing
+ * for Main-Memory Databases" by Leis et al. Each inner node branches by a single byte of the key and grows
+ * through four layouts as children are added: up to 4 and up to 16 sorted key bytes (the latter searched by
+ * single SSE2 comparison), 256 byte index into 48 children, and plain array of 256 children. Chains of inner
+ * nodes with a single child are collapsed into the prefix of the node below, so keys sharing long prefixes
+ * like "user:1234:profile:" cost the same as short ones, and lookup never compares that prefix more than once.
+ *
+ * Only the first kMaxPrefix bytes of each prefix are kept in the node, longer ones are skipped optimistically
+ * on lookup and verified against the key of the leaf at the end. Key that ends inside of the inner node, i.e.
+ * "user" while "user:1" is present too, is kept in its terminal slot.
+ *
+ * Map doesn't own key bytes: Key is anything with data and size fields, bytes must stay in place while entry is
+ * in the map. Interface is the subset of std::map used by the storage, entries are visited in key order by
+ * ForEach. That is NOT thread safe implementation!!
+ */
+template <typename Key, typename T, typename Alloc = std::allocator<std::pair<const Key, T>>> class ArtMap {
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using allocator_type = Alloc;
+
+    // Points to the entry, invalidated only by erase of that entry
+    class iterator {
+    public:
+        iterator(value_type *leaf = nullptr) : _leaf(leaf) {}
+
+        inline value_type &operator*() const { return *_leaf; }
+        inline value_type *operator->() const { return _leaf; }
+        inline bool operator==(const iterator &other) const { return _leaf == other._leaf; }
+        inline bool operator!=(const iterator &other) const { return _leaf != other._leaf; }
+
+    private:
+        value_type *_leaf;
+    };
+
+    explicit ArtMap(const Alloc &alloc = Alloc()) : _alloc(alloc), _root(nullptr), _size(0), _memory(0) {}
+    ~ArtMap() { clear(); }
+
+    iterator find(const Key &key) const {
+        void *p = _root;
+        std::size_t depth = 0;
+        while (p != nullptr) {
+            if (IsLeaf(p)) {
+                return Matches(AsLeaf(p), key) ? iterator(AsLeaf(p)) : end();
+            }
+
+            Node *n = static_cast<Node *>(p);
+            if (n->prefix_len > 0) {
+                if (CheckPrefix(n, key, depth) != std::min<std::size_t>(n->prefix_len, kMaxPrefix)) {
+                    return end();
+                }
+                depth += n->prefix_len;
+            }
+
+            if (depth >= key.size) {
+                return depth == key.size && n->terminal != nullptr && Matches(n->terminal, key) ? iterator(n->terminal)
+                                                                                               : end();
+            }
+
+            void **child = FindChild(n, Byte(key, depth));
+            p = child != nullptr ? *child : nullptr;
+            depth++;
+        }
+        return end();
+    }
+
+    inline iterator end() const { return iterator(); }
+
+    /**
+     * Inserts entry if key is absent
+     */
+    template <typename K, typename V> std::pair<iterator, bool> emplace(K &&key, V &&value) {
+        iterator it = find(Key(key));
+        if (it != end()) {
+            return std::make_pair(it, false);
+        }
+
+        value_type *leaf = new (Allocate(sizeof(value_type))) value_type(std::forward<K>(key), std::forward<V>(value));
+        Insert(&_root, leaf, 0);
+        _size++;
+        return std::make_pair(iterator(leaf), true);
+    }
+
+    std::size_t erase(const Key &key) {
+        void **ref = &_root;
+        std::size_t depth = 0;
+        while (*ref != nullptr) {
+            if (IsLeaf(*ref)) {
+                // Only root could be a leaf here, child leaves are removed by the parent below
+                if (!Matches(AsLeaf(*ref), key)) {
+                    return 0;
+                }
+                FreeLeaf(AsLeaf(*ref));
+                *ref = nullptr;
+                return 1;
+            }
+
+            Node *n = static_cast<Node *>(*ref);
+            if (n->prefix_len > 0) {
+                if (CheckPrefix(n, key, depth) != std::min<std::size_t>(n->prefix_len, kMaxPrefix)) {
+                    return 0;
+                }
+                depth += n->prefix_len;
+            }
+
+            if (depth >= key.size) {
+                if (depth > key.size || n->terminal == nullptr || !Matches(n->terminal, key)) {
+                    return 0;
+                }
+                FreeLeaf(n->terminal);
+                n->terminal = nullptr;
+                Shrink(ref, n);
+                return 1;
+            }
+
+            uint8_t byte = Byte(key, depth);
+            void **child = FindChild(n, byte);
+            if (child == nullptr) {
+                return 0;
+            }
+            if (IsLeaf(*child)) {
+                if (!Matches(AsLeaf(*child), key)) {
+                    return 0;
+                }
+                FreeLeaf(AsLeaf(*child));
+                RemoveChild(ref, n, byte, child);
+                return 1;
+            }
+
+            ref = child;
+            depth++;
+        }
+        return 0;
+    }
+
+    void clear() {
+        Destroy(_root);
+        _root = nullptr;
+    }
+
+    inline std::size_t size() const { return _size; }
+    inline bool empty() const { return _size == 0; }
+
+    // Bytes allocated for nodes and entries
+    inline std::size_t memory() const { return _memory; }
+
+    /**
+     * Calls fn for each entry in key order
+     */
+    template <typename F> void ForEach(F fn) const {
+        if (_root != nullptr) {
+            Visit(_root, fn);
+        }
+    }
+
+    /**
+     * Calls fn for each entry whose key starts with prefix, in key order. Only the subtree covering the prefix
+     * is visited
+     */
+    template <typename F> void ForEachPrefix(const Key &prefix, F fn) const {
+        void *p = _root;
+        std::size_t depth = 0;
+        while (p != nullptr && !IsLeaf(p)) {
+            Node *n = static_cast<Node *>(p);
+            if (depth + n->prefix_len >= prefix.size) {
+                // Keys below share all their bytes up to the end of prefix, so either all of them match or none
+                break;
+            }
+            if (n->prefix_len > 0) {
+                if (CheckPrefix(n, prefix, depth) != std::min<std::size_t>(n->prefix_len, kMaxPrefix)) {
+                    return;
+                }
+                depth += n->prefix_len;
+            }
+
+            void **child = FindChild(n, Byte(prefix, depth));
+            p = child != nullptr ? *child : nullptr;
+            depth++;
+        }
+
+        // Prefix bytes that are not stored in nodes were skipped, one key tells whether they match
+        if (p != nullptr && StartsWith(Minimum(p), prefix)) {
+            Visit(p, fn);
+        }
+    }
+
+private:
+    ArtMap(const ArtMap &);            // = delete;
+    ArtMap &operator=(const ArtMap &); // = delete;
+
+    using byte_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<char>;
+
+    // Prefix bytes stored in the node
+    enum : std::size_t { kMaxPrefix = 8 };
+
+    enum NodeType : uint8_t { kNode4, kNode16, kNode48, kNode256 };
+
+    // Child slots hold either inner node or leaf, which is tagged by the lowest bit
+    struct Node {
+        NodeType type;
+        uint16_t count;
+        uint32_t prefix_len;
+        uint8_t prefix[kMaxPrefix];
+
+        // Entry which key ends right after prefix of this node
+        value_type *terminal;
+    };
+
+    struct Node4 : Node {
+        uint8_t keys[4];
+        void *children[4];
+    };
+
+    struct Node16 : Node {
+        uint8_t keys[16];
+        void *children[16];
+    };
+
+    struct Node48 : Node {
+        // Slot in children plus one, 0 if there is no child
+        uint8_t index[256];
+        void *children[48];
+    };
+
+    struct Node256 : Node {
+        void *children[256];
+    };
+
+    static inline uint8_t Byte(const Key &key, std::size_t i) { return static_cast<uint8_t>(key.data[i]); }
+
+    static inline bool IsLeaf(const void *p) { return reinterpret_cast<uintptr_t>(p) & 1; }
+    static inline value_type *AsLeaf(const void *p) {
+        return reinterpret_cast<value_type *>(reinterpret_cast<uintptr_t>(p) & ~uintptr_t(1));
+    }
+    static inline void *Tag(value_type *leaf) { return reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(leaf) | 1); }
+
+    static inline bool Matches(const value_type *leaf, const Key &key) {
+        return leaf->first.size == key.size && std::memcmp(leaf->first.data, key.data, key.size) == 0;
+    }
+
+    static inline bool StartsWith(const value_type *leaf, const Key &prefix) {
+        return leaf->first.size >= prefix.size && std::memcmp(leaf->first.data, prefix.data, prefix.size) == 0;
+    }
+
+    void *Allocate(std::size_t size) {
+        _memory += size;
+        return byte_allocator(_alloc).allocate(size);
+    }
+
+    void Free(void *ptr, std::size_t size) {
+        _memory -= size;
+        byte_allocator(_alloc).deallocate(static_cast<char *>(ptr), size);
+    }
+
+    template <typename N> N *NewNode(NodeType type) {
+        N *n = new (Allocate(sizeof(N))) N();
+        n->type = type;
+        return n;
+    }
+
+    void FreeNode(Node *n) {
+        switch (n->type) {
+        case kNode4:
+            Free(n, sizeof(Node4));
+            break;
+        case kNode16:
+            Free(n, sizeof(Node16));
+            break;
+        case kNode48:
+            Free(n, sizeof(Node48));
+            break;
+        case kNode256:
+            Free(n, sizeof(Node256));
+            break;
+        }
+    }
+
+    void FreeLeaf(value_type *leaf) {
+        leaf->~value_type();
+        Free(leaf, sizeof(value_type));
+        _size--;
+    }
+
+    // Number of stored prefix bytes of the node that match the key from depth on
+    static std::size_t CheckPrefix(const Node *n, const Key &key, std::size_t depth) {
+        std::size_t limit = std::min(std::min<std::size_t>(n->prefix_len, kMaxPrefix), key.size - depth);
+        std::size_t i = 0;
+        while (i < limit && n->prefix[i] == Byte(key, depth + i)) {
+            i++;
+        }
+        return i;
+    }
+
+    // Number of prefix bytes of the node that match the key from depth on, bytes which are not stored
+    // are taken from any leaf below
+    static std::size_t PrefixMismatch(const Node *n, const Key &key, std::size_t depth) {
+        std::size_t limit = std::min<std::size_t>(n->prefix_len, key.size - depth);
+        std::size_t i = 0;
+        for (; i < std::min<std::size_t>(limit, kMaxPrefix); i++) {
+            if (n->prefix[i] != Byte(key, depth + i)) {
+                return i;
+            }
+        }
+
+        if (limit > kMaxPrefix) {
+            const value_type *leaf = Minimum(n);
+            for (; i < limit; i++) {
+                if (Byte(leaf->first, depth + i) != Byte(key, depth + i)) {
+                    return i;
+                }
+            }
+        }
+        return i;
+    }
+
+    // The smallest entry under the node
+    static const value_type *Minimum(const void *p) {
+        while (!IsLeaf(p)) {
+            const Node *n = static_cast<const Node *>(p);
+            if (n->terminal != nullptr) {
+                return n->terminal;
+            }
+
+            switch (n->type) {
+            case kNode4:
+                p = static_cast<const Node4 *>(n)->children[0];
+                break;
+            case kNode16:
+                p = static_cast<const Node16 *>(n)->children[0];
+                break;
+            case kNode48: {
+                const Node48 *n48 = static_cast<const Node48 *>(n);
+                std::size_t b = 0;
+                while (n48->index[b] == 0) {
+                    b++;
+                }
+                p = n48->children[n48->index[b] - 1];
+                break;
+            }
+            case kNode256: {
+                const Node256 *n256 = static_cast<const Node256 *>(n);
+                std::size_t b = 0;
+                while (n256->children[b] == nullptr) {
+                    b++;
+                }
+                p = n256->children[b];
+                break;
+            }
+            }
+        }
+        return AsLeaf(p);
+    }
+
+    // Slot of the child for the given byte, nullptr if there is none
+    static void **FindChild(Node *n, uint8_t byte) {
+        switch (n->type) {
+        case kNode4: {
+            Node4 *n4 = static_cast<Node4 *>(n);
+            for (std::size_t i = 0; i < n4->count; i++) {
+                if (n4->keys[i] == byte) {
+                    return &n4->children[i];
+                }
+            }
+            return nullptr;
+        }
+        case kNode16: {
+            Node16 *n16 = static_cast<Node16 *>(n);
+#ifdef __SSE2__
+            __m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i *>(n16->keys));
+            unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(byte)), keys));
+            mask &= (1u << n16->count) - 1;
+            return mask != 0 ? &n16->children[__builtin_ctz(mask)] : nullptr;
+#else
+            for (std::size_t i = 0; i < n16->count; i++) {
+                if (n16->keys[i] == byte) {
+                    return &n16->children[i];
+                }
+            }
+            return nullptr;
+#endif
+        }
+        case kNode48: {
+            Node48 *n48 = static_cast<Node48 *>(n);
+            return n48->index[byte] != 0 ? &n48->children[n48->index[byte] - 1] : nullptr;
+        }
+        case kNode256: {
+            Node256 *n256 = static_cast<Node256 *>(n);
+            return n256->children[byte] != nullptr ? &n256->children[byte] : nullptr;
+        }
+        }
+        return nullptr;
+    }
+
+    static void CopyHeader(Node *to, const Node *from) {
+        to->count = from->count;
+        to->prefix_len = from->prefix_len;
+        std::memcpy(to->prefix, from->prefix, kMaxPrefix);
+        to->terminal = from->terminal;
+    }
+
+    // Inserts child into sorted keys/children arrays with room for one more
+    template <typename N> static void InsertSorted(N *n, uint8_t byte, void *child) {
+        std::size_t pos = 0;
+        while (pos < n->count && n->keys[pos] < byte) {
+            pos++;
+        }
+        std::memmove(n->keys + pos + 1, n->keys + pos, n->count - pos);
+        std::memmove(n->children + pos + 1, n->children + pos, (n->count - pos) * sizeof(void *));
+        n->keys[pos] = byte;
+        n->children[pos] = child;
+        n->count++;
+    }
+
+    // Adds child of node n living in the slot ref, node is replaced by the larger one once it is full
+    void AddChild(void **ref, Node *n, uint8_t byte, void *child) {
+        switch (n->type) {
+        case kNode4: {
+            Node4 *n4 = static_cast<Node4 *>(n);
+            if (n4->count < 4) {
+                InsertSorted(n4, byte, child);
+                return;
+            }
+
+            Node16 *n16 = NewNode<Node16>(kNode16);
+            CopyHeader(n16, n4);
+            std::memcpy(n16->keys, n4->keys, 4);
+            std::memcpy(n16->children, n4->children, 4 * sizeof(void *));
+            FreeNode(n4);
+            *ref = n16;
+            InsertSorted(n16, byte, child);
+            return;
+        }
+        case kNode16: {
+            Node16 *n16 = static_cast<Node16 *>(n);
+            if (n16->count < 16) {
+                InsertSorted(n16, byte, child);
+                return;
+            }
+
+            Node48 *n48 = NewNode<Node48>(kNode48);
+            CopyHeader(n48, n16);
+            for (std::size_t i = 0; i < 16; i++) {
+                n48->index[n16->keys[i]] = i + 1;
+                n48->children[i] = n16->children[i];
+            }
+            FreeNode(n16);
+            *ref = n48;
+            AddChild(ref, n48, byte, child);
+            return;
+        }
+        case kNode48: {
+            Node48 *n48 = static_cast<Node48 *>(n);
+            if (n48->count < 48) {
+                std::size_t pos = 0;
+                while (n48->children[pos] != nullptr) {
+                    pos++;
+                }
+                n48->children[pos] = child;
+                n48->index[byte] = pos + 1;
+                n48->count++;
+                return;
+            }
+
+            Node256 *n256 = NewNode<Node256>(kNode256);
+            CopyHeader(n256, n48);
+            for (std::size_t b = 0; b < 256; b++) {
+                if (n48->index[b] != 0) {
+                    n256->children[b] = n48->children[n48->index[b] - 1];
+                }
+            }
+            FreeNode(n48);
+            *ref = n256;
+            AddChild(ref, n256, byte, child);
+            return;
+        }
+        case kNode256: {
+            Node256 *n256 = static_cast<Node256 *>(n);
+            n256->children[byte] = child;
+            n256->count++;
+            return;
+        }
+        }
+    }
+
+    // Removes child in the given slot of node n living in the slot ref
+    void RemoveChild(void **ref, Node *n, uint8_t byte, void **slot) {
+        switch (n->type) {
+        case kNode4: {
+            Node4 *n4 = static_cast<Node4 *>(n);
+            std::size_t pos = slot - n4->children;
+            std::memmove(n4->keys + pos, n4->keys + pos + 1, n4->count - pos - 1);
+            std::memmove(n4->children + pos, n4->children + pos + 1, (n4->count - pos - 1) * sizeof(void *));
+            break;
+        }
+        case kNode16: {
+            Node16 *n16 = static_cast<Node16 *>(n);
+            std::size_t pos = slot - n16->children;
+            std::memmove(n16->keys + pos, n16->keys + pos + 1, n16->count - pos - 1);
+            std::memmove(n16->children + pos, n16->children + pos + 1, (n16->count - pos - 1) * sizeof(void *));
+            break;
+        }
+        case kNode48: {
+            Node48 *n48 = static_cast<Node48 *>(n);
+            n48->children[n48->index[byte] - 1] = nullptr;
+            n48->index[byte] = 0;
+            break;
+        }
+        case kNode256:
+            static_cast<Node256 *>(n)->children[byte] = nullptr;
+            break;
+        }
+        n->count--;
+        Shrink(ref, n);
+    }
+
+    // Replaces node by the smaller one once it gets too sparse, node without children becomes its terminal
+    // entry and single child node is merged into the child
+    void Shrink(void **ref, Node *n) {
+        switch (n->type) {
+        case kNode4: {
+            Node4 *n4 = static_cast<Node4 *>(n);
+            if (n4->count == 0) {
+                *ref = n4->terminal != nullptr ? Tag(n4->terminal) : nullptr;
+                FreeNode(n4);
+            } else if (n4->count == 1 && n4->terminal == nullptr) {
+                void *child = n4->children[0];
+                if (!IsLeaf(child)) {
+                    // Child prefix becomes: node prefix, byte of the child, child prefix
+                    Node *c = static_cast<Node *>(child);
+                    uint8_t prefix[kMaxPrefix];
+                    std::size_t len = std::min<std::size_t>(n4->prefix_len, kMaxPrefix);
+                    std::memcpy(prefix, n4->prefix, len);
+                    if (len < kMaxPrefix) {
+                        prefix[len++] = n4->keys[0];
+                    }
+                    std::size_t rest = std::min<std::size_t>(c->prefix_len, kMaxPrefix - len);
+                    std::memcpy(prefix + len, c->prefix, rest);
+                    std::memcpy(c->prefix, prefix, len + rest);
+                    c->prefix_len += n4->prefix_len + 1;
+                }
+                *ref = child;
+                FreeNode(n4);
+            }
+            return;
+        }
+        case kNode16: {
+            Node16 *n16 = static_cast<Node16 *>(n);
+            if (n16->count <= 3) {
+                Node4 *n4 = NewNode<Node4>(kNode4);
+                CopyHeader(n4, n16);
+                std::memcpy(n4->keys, n16->keys, n16->count);
+                std::memcpy(n4->children, n16->children, n16->count * sizeof(void *));
+                FreeNode(n16);
+                *ref = n4;
+            }
+            return;
+        }
+        case kNode48: {
+            Node48 *n48 = static_cast<Node48 *>(n);
+            if (n48->count <= 12) {
+                Node16 *n16 = NewNode<Node16>(kNode16);
+                CopyHeader(n16, n48);
+                std::size_t pos = 0;
+                for (std::size_t b = 0; b < 256; b++) {
+                    if (n48->index[b] != 0) {
+                        n16->keys[pos] = b;
+                        n16->children[pos++] = n48->children[n48->index[b] - 1];
+                    }
+                }
+                FreeNode(n48);
+                *ref = n16;
+            }
+            return;
+        }
+        case kNode256: {
+            Node256 *n256 = static_cast<Node256 *>(n);
+            if (n256->count <= 37) {
+                Node48 *n48 = NewNode<Node48>(kNode48);
+                CopyHeader(n48, n256);
+                std::size_t pos = 0;
+                for (std::size_t b = 0; b < 256; b++) {
+                    if (n256->children[b] != nullptr) {
+                        n48->children[pos] = n256->children[b];
+                        n48->index[b] = ++pos;
+                    }
+                }
+                FreeNode(n256);
+                *ref = n48;
+            }
+            return;
+        }
+        }
+    }
+
+    // Puts entry into the fresh node which prefix ends at depth
+    void Place(void **ref, Node *n, value_type *leaf, std::size_t depth) {
+        if (leaf->first.size == depth) {
+            n->terminal = leaf;
+        } else {
+            AddChild(ref, n, Byte(leaf->first, depth), Tag(leaf));
+        }
+    }
+
+    // Inserts entry which key is absent into the subtree living in the slot ref
+    void Insert(void **ref, value_type *leaf, std::size_t depth) {
+        const Key &key = leaf->first;
+        for (;;) {
+            if (*ref == nullptr) {
+                *ref = Tag(leaf);
+                return;
+            }
+
+            if (IsLeaf(*ref)) {
+                // Both entries go into the new node, common part of the keys becomes its prefix
+                value_type *other = AsLeaf(*ref);
+                std::size_t limit = std::min(other->first.size, key.size);
+                std::size_t common = depth;
+                while (common < limit && Byte(other->first, common) == Byte(key, common)) {
+                    common++;
+                }
+
+                Node4 *n = NewNode<Node4>(kNode4);
+                n->prefix_len = common - depth;
+                std::memcpy(n->prefix, key.data + depth, std::min<std::size_t>(n->prefix_len, kMaxPrefix));
+                *ref = n;
+                Place(ref, n, other, common);
+                Place(ref, n, leaf, common);
+                return;
+            }
+
+            Node *n = static_cast<Node *>(*ref);
+            if (n->prefix_len > 0) {
+                std::size_t diff = PrefixMismatch(n, key, depth);
+                if (diff < n->prefix_len) {
+                    SplitPrefix(ref, n, leaf, depth, diff);
+                    return;
+                }
+                depth += n->prefix_len;
+            }
+
+            if (depth == key.size) {
+                assert(n->terminal == nullptr);
+                n->terminal = leaf;
+                return;
+            }
+
+            void **child = FindChild(n, Byte(key, depth));
+            if (child == nullptr) {
+                AddChild(ref, n, Byte(key, depth), Tag(leaf));
+                return;
+            }
+            ref = child;
+            depth++;
+        }
+    }
+
+    // Key differs from the prefix of node n at diff: new node takes the matching part of the prefix, old node
+    // and the new entry become its children
+    void SplitPrefix(void **ref, Node *n, value_type *leaf, std::size_t depth, std::size_t diff) {
+        Node4 *parent = NewNode<Node4>(kNode4);
+        parent->prefix_len = diff;
+        std::memcpy(parent->prefix, n->prefix, std::min<std::size_t>(diff, kMaxPrefix));
+        *ref = parent;
+
+        uint8_t byte;
+        if (n->prefix_len <= kMaxPrefix) {
+            byte = n->prefix[diff];
+            n->prefix_len -= diff + 1;
+            std::memmove(n->prefix, n->prefix + diff + 1, n->prefix_len);
+        } else {
+            const value_type *min = Minimum(n);
+            byte = Byte(min->first, depth + diff);
+            n->prefix_len -= diff + 1;
+            std::memcpy(n->prefix, min->first.data + depth + diff + 1,
+                        std::min<std::size_t>(n->prefix_len, kMaxPrefix));
+        }
+        AddChild(ref, parent, byte, n);
+        Place(ref, parent, leaf, depth + diff);
+    }
+
+    void Destroy(void *p) {
+        if (p == nullptr) {
+            return;
+        }
+        if (IsLeaf(p)) {
+            FreeLeaf(AsLeaf(p));
+            return;
+        }
+
+        Node *n = static_cast<Node *>(p);
+        if (n->terminal != nullptr) {
+            FreeLeaf(n->terminal);
+        }
+        ForEachChild(n, [this](void *child) { Destroy(child); });
+        FreeNode(n);
+    }
+
+    template <typename F> static void Visit(const void *p, F &fn) {
+        if (IsLeaf(p)) {
+            fn(*AsLeaf(p));
+            return;
+        }
+
+        const Node *n = static_cast<const Node *>(p);
+        if (n->terminal != nullptr) {
+            fn(*n->terminal);
+        }
+        ForEachChild(n, [&fn](void *child) { Visit(child, fn); });
+    }
+
+    // Calls fn for each child in key byte order
+    template <typename F> static void ForEachChild(const Node *n, F fn) {
+        switch (n->type) {
+        case kNode4: {
+            const Node4 *n4 = static_cast<const Node4 *>(n);
+            for (std::size_t i = 0; i < n4->count; i++) {
+                fn(n4->children[i]);
+            }
+            break;
+        }
+        case kNode16: {
+            const Node16 *n16 = static_cast<const Node16 *>(n);
+            for (std::size_t i = 0; i < n16->count; i++) {
+                fn(n16->children[i]);
+            }
+            break;
+        }
+        case kNode48: {
+            const Node48 *n48 = static_cast<const Node48 *>(n);
+            for (std::size_t b = 0; b < 256; b++) {
+                if (n48->index[b] != 0) {
+                    fn(n48->children[n48->index[b] - 1]);
+                }
+            }
+            break;
+        }
+        case kNode256: {
+            const Node256 *n256 = static_cast<const Node256 *>(n);
+            for (std::size_t b = 0; b < 256; b++) {
+                if (n256->children[b] != nullptr) {
+                    fn(n256->children[b]);
+                }
+            }
+            break;
+        }
+        }
+    }
+
+    Alloc _alloc;
+
+    // Inner node or tagged leaf, nullptr if map is empty
+    void *_root;
+
+    std::size_t _size;
+    std::size_t _memory;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_ART_MAP_H
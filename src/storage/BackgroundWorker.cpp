@@ -0,0 +1,55 @@
+#include "BackgroundWorker.h"
+
+namespace Afina {
+namespace Backend {
+
+// See BackgroundWorker.h
+void BackgroundWorker::Start() {
+    std::lock_guard<std::mutex> lk(_mtx);
+    if (_running) {
+        return;
+    }
+    _running = true;
+    _wakeup = false;
+    _thread = std::thread(&BackgroundWorker::OnRun, this);
+}
+
+// See BackgroundWorker.h
+void BackgroundWorker::Stop() {
+    {
+        std::lock_guard<std::mutex> lk(_mtx);
+        if (!_running) {
+            return;
+        }
+        _running = false;
+    }
+    _cv.notify_all();
+    _thread.join();
+}
+
+// See BackgroundWorker.h
+void BackgroundWorker::Wakeup() {
+    {
+        std::lock_guard<std::mutex> lk(_mtx);
+        _wakeup = true;
+    }
+    _cv.notify_one();
+}
+
+// See BackgroundWorker.h
+void BackgroundWorker::OnRun() {
+    std::unique_lock<std::mutex> lk(_mtx);
+    while (_running) {
+        lk.unlock();
+        bool more = _task();
+        lk.lock();
+
+        if (!more && !_wakeup) {
+            _cv.wait_for(lk, _idle, [this]() { return !_running || _wakeup; });
+        }
+        _wakeup = false;
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
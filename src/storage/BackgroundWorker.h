@@ -0,0 +1,55 @@
+#ifndef AFINA_STORAGE_BACKGROUND_WORKER_H
+#define AFINA_STORAGE_BACKGROUND_WORKER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Storage maintenance thread
+ * Runs given task over and over while it reports there is more work to do, otherwise sleeps for the
+ * idle period or until woken up
+ */
+class BackgroundWorker {
+public:
+    BackgroundWorker(std::function<bool()> task, std::chrono::milliseconds idle)
+        : _task(task), _idle(idle), _running(false), _wakeup(false) {}
+    ~BackgroundWorker() { Stop(); }
+
+    void Start();
+
+    /**
+     * Stops the thread and waits until current task run is complete
+     */
+    void Stop();
+
+    /**
+     * Makes sleeping thread run the task right now
+     */
+    void Wakeup();
+
+private:
+    BackgroundWorker(const BackgroundWorker &);            // = delete;
+    BackgroundWorker &operator=(const BackgroundWorker &); // = delete;
+
+    void OnRun();
+
+    std::function<bool()> _task;
+    const std::chrono::milliseconds _idle;
+
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    bool _running;
+    bool _wakeup;
+    std::thread _thread;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_BACKGROUND_WORKER_H
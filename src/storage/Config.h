@@ -0,0 +1,50 @@
+#ifndef AFINA_STORAGE_CONFIG_H
+#define AFINA_STORAGE_CONFIG_H
+
+#include "Arena.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Tuning of thread safe storage engines
+ * Defaults give plain behavior of the engine
+ */
+struct Config {
+    // Memory for items, see Arena.h
+    ArenaConfig arena;
+
+    // Put returns as soon as mutation is queued, queue is applied by the next lock holder or by the
+    // background thread. See ThreadSafeSimpleLRU.h
+    bool write_behind = false;
+
+    // Background thread starts evicting once storage is filled above high watermark, and keeps going in
+    // small batches until it drops below the low one. Both are fractions of the storage limit, 0 disables
+    // background eviction. Puts evict inline only when hard limit is reached
+    double low_watermark = 0;
+    double high_watermark = 0;
+
+    // Keep cuckoo filter of keys per lock, so that lookups of absent keys don't take the lock at all.
+    // Ignored in write behind mode: queued puts are not in the filter yet
+    bool filter = false;
+
+    // Values of at least that many bytes are stored once per lock however many items hold them, 0 disables
+    // dedup. See ValueTable.h
+    std::size_t dedup_threshold = 0;
+
+    // Fraction of keys whose accesses are fed into miss ratio curve of each lock, 0 disables the curve. See
+    // MissRatioCurve.h
+    double mrc_sample_rate = 0;
+
+    // Number of the most accessed keys "stats hotkeys" lists, 0 disables tracking. See HeavyHitters.h
+    std::size_t hot_keys = 0;
+
+    // Striped storage doubles number of its stripes, up to that many, once their locks are found busy too often.
+    // 0 keeps number of stripes fixed, so that requests pick their stripes without epoch guard. See StripedLockLRU.h
+    std::size_t max_stripes = 0;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_CONFIG_H
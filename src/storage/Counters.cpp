@@ -0,0 +1,85 @@
+#include "Counters.h"
+
+#include <cstdio>
+
+namespace Afina {
+namespace Backend {
+
+// See Counters.h
+StorageStats &StorageStats::operator+=(const StorageStats &other) {
+    get_hits += other.get_hits;
+    get_misses += other.get_misses;
+    cmd_set += other.cmd_set;
+    delete_hits += other.delete_hits;
+    delete_misses += other.delete_misses;
+    filter_misses += other.filter_misses;
+    evictions += other.evictions;
+    curr_items += other.curr_items;
+    bytes += other.bytes;
+    limit_maxbytes += other.limit_maxbytes;
+    dedup_values += other.dedup_values;
+    dedup_items += other.dedup_items;
+    dedup_saved_bytes += other.dedup_saved_bytes;
+    mrc_gets += other.mrc_gets;
+    mrc_hits_half += other.mrc_hits_half;
+    mrc_hits_1x += other.mrc_hits_1x;
+    mrc_hits_2x += other.mrc_hits_2x;
+    mrc_hits_4x += other.mrc_hits_4x;
+    return *this;
+}
+
+// See Counters.h
+void StorageStats::Report(const std::string &prefix, std::vector<std::pair<std::string, std::string>> &out) const {
+    const std::pair<const char *, uint64_t> fields[] = {
+        {"cmd_get", get_hits + get_misses},
+        {"get_hits", get_hits},
+        {"get_misses", get_misses},
+        {"cmd_set", cmd_set},
+        {"delete_hits", delete_hits},
+        {"delete_misses", delete_misses},
+        {"filter_misses", filter_misses},
+        {"evictions", evictions},
+        {"curr_items", curr_items},
+        {"bytes", bytes},
+        {"limit_maxbytes", limit_maxbytes},
+        {"dedup_values", dedup_values},
+        {"dedup_items", dedup_items},
+        {"dedup_saved_bytes", dedup_saved_bytes},
+    };
+    for (auto &field : fields) {
+        out.emplace_back(prefix + field.first, std::to_string(field.second));
+    }
+
+    // Curve is reported only by the storage that estimates it
+    if (mrc_gets > 0) {
+        const std::pair<const char *, uint64_t> hits[] = {
+            {"0.5x", mrc_hits_half}, {"1x", mrc_hits_1x}, {"2x", mrc_hits_2x}, {"4x", mrc_hits_4x},
+        };
+        out.emplace_back(prefix + "mrc_gets", std::to_string(mrc_gets));
+        for (auto &hit : hits) {
+            char ratio[16];
+            std::snprintf(ratio, sizeof(ratio), "%.4f", double(hit.second) / mrc_gets);
+            out.emplace_back(prefix + "mrc_hit_ratio_" + hit.first, ratio);
+        }
+    }
+}
+
+// See Counters.h
+void Counters::Collect(StorageStats &stats) {
+    uint64_t sum[kCounters] = {};
+    _local.for_each([&sum](Local &local) {
+        for (std::size_t i = 0; i < kCounters; i++) {
+            sum[i] += local.values[i].load(std::memory_order_relaxed);
+        }
+    });
+
+    stats.get_hits += sum[kGetHits];
+    stats.get_misses += sum[kGetMisses];
+    stats.cmd_set += sum[kCmdSet];
+    stats.delete_hits += sum[kDeleteHits];
+    stats.delete_misses += sum[kDeleteMisses];
+    stats.filter_misses += sum[kFilterMisses];
+}
+
+} // namespace Backend
+} // namespace Afina
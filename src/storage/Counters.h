@@ -0,0 +1,119 @@
+#ifndef AFINA_STORAGE_COUNTERS_H
+#define AFINA_STORAGE_COUNTERS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <afina/concurrency/ThreadLocal.h>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Snapshot of the storage statistics
+ * Names of the fields are the same as memcached "stats" command uses
+ */
+struct StorageStats {
+    // Operations
+    uint64_t get_hits = 0;
+    uint64_t get_misses = 0;
+    uint64_t cmd_set = 0;
+    uint64_t delete_hits = 0;
+    uint64_t delete_misses = 0;
+
+    // Operations on absent keys answered by the key filter without taking the lock, those are
+    // included into the counters above as well
+    uint64_t filter_misses = 0;
+
+    // Items evicted to free space for the new ones
+    uint64_t evictions = 0;
+
+    // Current state
+    uint64_t curr_items = 0;
+    uint64_t bytes = 0;
+    uint64_t limit_maxbytes = 0;
+
+    // Values kept once for all items holding the same bytes, see ValueTable.h: number of distinct values,
+    // items referring to them, and bytes saved by not having a copy per item
+    uint64_t dedup_values = 0;
+    uint64_t dedup_items = 0;
+    uint64_t dedup_saved_bytes = 0;
+
+    // Sampled gets and how many of them would hit in the storage of half, the same, double and quadruple size,
+    // see MissRatioCurve.h
+    uint64_t mrc_gets = 0;
+    uint64_t mrc_hits_half = 0;
+    uint64_t mrc_hits_1x = 0;
+    uint64_t mrc_hits_2x = 0;
+    uint64_t mrc_hits_4x = 0;
+
+    StorageStats &operator+=(const StorageStats &other);
+
+    /**
+     * Appends "<prefix><name>" / value pairs of all fields
+     */
+    void Report(const std::string &prefix, std::vector<std::pair<std::string, std::string>> &out) const;
+};
+
+// Operations counted by the storage
+struct CounterId {
+    enum Counter { kGetHits, kGetMisses, kCmdSet, kDeleteHits, kDeleteMisses, kFilterMisses, kCounters };
+};
+
+/**
+ * # Per thread operation counters
+ * Every thread increments its own copy living on its own cache line, so counting on the request path costs
+ * a plain load and store without any shared cache line or locked instruction. Copy of the counters thread used
+ * last is found by a single thread local compare, so consecutive Adds of the same request don't search for it.
+ * Collect sums copies of all threads, result may miss operations that are running concurrently.
+ */
+class Counters : public CounterId {
+public:
+    Counters() {}
+    ~Counters() {}
+
+    inline void Add(Counter counter, uint64_t n = 1) {
+        std::atomic<uint64_t> &value = _local.get().values[counter];
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    /**
+     * Adds current values of all counters into stats
+     */
+    void Collect(StorageStats &stats);
+
+private:
+    Counters(const Counters &);            // = delete;
+    Counters &operator=(const Counters &); // = delete;
+
+    struct Local {
+        Local() {
+            for (auto &value : values) {
+                value.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        std::atomic<uint64_t> values[kCounters];
+    };
+
+    Concurrency::ThreadLocal<Local> _local;
+};
+
+/**
+ * # Counters that count nothing
+ * For the storage whose owner doesn't need statistics, operations cost nothing extra then
+ */
+class NullCounters : public CounterId {
+public:
+    inline void Add(Counter counter, uint64_t n = 1) {}
+
+    inline void Collect(StorageStats &stats) {}
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_COUNTERS_H
@@ -0,0 +1,145 @@
+#include "CuckooFilter.h"
+
+#include <cstring>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// Fingerprints per bucket and bits per fingerprint
+const std::size_t kSlots = 4;
+const std::size_t kFingerprintBits = 16;
+
+// Relocations tried before filter gives up
+const std::size_t kMaxKicks = 500;
+
+// Never less buckets than that
+const std::size_t kMinBuckets = 16;
+
+inline uint16_t fingerprint(uint64_t hash) {
+    // 0 marks empty slot
+    uint16_t fp = hash >> 48;
+    return fp == 0 ? 1 : fp;
+}
+
+inline uint16_t lane(uint64_t word, std::size_t slot) { return word >> (slot * kFingerprintBits); }
+
+inline uint64_t with_lane(uint64_t word, std::size_t slot, uint16_t fp) {
+    const std::size_t shift = slot * kFingerprintBits;
+    return (word & ~(uint64_t(0xffff) << shift)) | (uint64_t(fp) << shift);
+}
+
+inline bool has(uint64_t word, uint16_t fp) {
+    for (std::size_t slot = 0; slot < kSlots; slot++) {
+        if (lane(word, slot) == fp) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+// See CuckooFilter.h
+CuckooFilter::CuckooFilter(std::size_t capacity) : _seq(0), _overflow(false) {
+    // Keep load factor below 75%, insertions rarely need long relocation chains then
+    std::size_t n_buckets = kMinBuckets;
+    while (n_buckets * 3 < capacity) {
+        n_buckets *= 2;
+    }
+    _capacity = n_buckets * 3;
+    _mask = n_buckets - 1;
+    _buckets.reset(new std::atomic<uint64_t>[n_buckets]);
+    for (std::size_t i = 0; i < n_buckets; i++) {
+        _buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+// See CuckooFilter.h
+void CuckooFilter::Insert(uint64_t hash) {
+    uint16_t fp = fingerprint(hash);
+    std::size_t index = hash & _mask;
+    if (TryPlace(index, fp) || TryPlace(AltIndex(index, fp), fp)) {
+        return;
+    }
+
+    // Both buckets are full: kick fingerprints around until some of them finds a free slot. In between
+    // victim is in neither of its buckets, so readers have to retry
+    uint64_t seq = _seq.load(std::memory_order_relaxed);
+    _seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (std::size_t kick = 0; kick < kMaxKicks; kick++) {
+        std::size_t slot = (hash + kick) % kSlots;
+        uint64_t word = _buckets[index].load(std::memory_order_relaxed);
+        uint16_t victim = lane(word, slot);
+        _buckets[index].store(with_lane(word, slot, fp), std::memory_order_relaxed);
+
+        fp = victim;
+        index = AltIndex(index, fp);
+        if (TryPlace(index, fp)) {
+            _seq.store(seq + 2, std::memory_order_release);
+            return;
+        }
+    }
+
+    // Homeless fingerprint is lost, so filter can't answer "absent" anymore
+    _overflow.store(true, std::memory_order_relaxed);
+    _seq.store(seq + 2, std::memory_order_release);
+}
+
+// See CuckooFilter.h
+void CuckooFilter::Erase(uint64_t hash) {
+    uint16_t fp = fingerprint(hash);
+    std::size_t buckets[] = {hash & _mask, AltIndex(hash & _mask, fp)};
+    for (std::size_t i : buckets) {
+        uint64_t word = _buckets[i].load(std::memory_order_relaxed);
+        for (std::size_t slot = 0; slot < kSlots; slot++) {
+            if (lane(word, slot) == fp) {
+                _buckets[i].store(with_lane(word, slot, 0), std::memory_order_release);
+                return;
+            }
+        }
+    }
+}
+
+// See CuckooFilter.h
+bool CuckooFilter::MayContain(uint64_t hash) const {
+    uint16_t fp = fingerprint(hash);
+    std::size_t index = hash & _mask;
+    std::size_t alt = AltIndex(index, fp);
+
+    for (;;) {
+        uint64_t seq = _seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+
+        if (has(_buckets[index].load(std::memory_order_acquire), fp) ||
+            has(_buckets[alt].load(std::memory_order_acquire), fp)) {
+            return true;
+        }
+
+        // Nothing was moved while buckets were read, so "absent" is the truth
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_seq.load(std::memory_order_relaxed) == seq) {
+            return _overflow.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// See CuckooFilter.h
+bool CuckooFilter::TryPlace(std::size_t index, uint16_t fp) {
+    uint64_t word = _buckets[index].load(std::memory_order_relaxed);
+    for (std::size_t slot = 0; slot < kSlots; slot++) {
+        if (lane(word, slot) == 0) {
+            _buckets[index].store(with_lane(word, slot, fp), std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace Backend
+} // namespace Afina
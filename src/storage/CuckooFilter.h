@@ -0,0 +1,84 @@
+#ifndef AFINA_STORAGE_CUCKOO_FILTER_H
+#define AFINA_STORAGE_CUCKOO_FILTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <afina/KeyHash.h>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Cuckoo filter
+ * Compact set of key fingerprints that answers "definitely absent" or "maybe present" and, unlike Bloom
+ * filter, supports deletion. Each bucket holds four 16 bit fingerprints packed into a single atomic word,
+ * key could live in one of two buckets.
+ *
+ * Filter has single writer and many lock free readers: Insert/Erase must be serialized by the caller,
+ * MayContain could be called concurrently with them. Fingerprint relocations are wrapped into sequence
+ * counter, so reader never misses a key that is being moved between buckets.
+ *
+ * Once filter is too full to take a new key it overflows: MayContain always says "maybe" until the owner
+ * replaces filter with a larger one.
+ */
+class CuckooFilter {
+public:
+    /**
+     * Creates filter able to hold at least capacity keys
+     */
+    explicit CuckooFilter(std::size_t capacity);
+    ~CuckooFilter() {}
+
+    /**
+     * Hash of the key that all other methods expect, the one every layer uses, see afina/KeyHash.h
+     */
+    static inline uint64_t Hash(const char *data, std::size_t size) { return HashKey(data, size); }
+
+    /**
+     * Adds key, sets overflow flag if there is no room for it
+     */
+    void Insert(uint64_t hash);
+
+    /**
+     * Removes single copy of the key, which must have been inserted before
+     */
+    void Erase(uint64_t hash);
+
+    /**
+     * False if key was definitely never inserted or erased already
+     */
+    bool MayContain(uint64_t hash) const;
+
+    // True if some key couldn't be inserted, filter is useless since then
+    inline bool overflow() const { return _overflow.load(std::memory_order_acquire); }
+
+    // Number of keys filter is designed for
+    inline std::size_t capacity() const { return _capacity; }
+
+private:
+    CuckooFilter(const CuckooFilter &);            // = delete;
+    CuckooFilter &operator=(const CuckooFilter &); // = delete;
+
+    inline std::size_t AltIndex(std::size_t index, uint16_t fp) const {
+        return (index ^ (fp * 0x5bd1e995u)) & _mask;
+    }
+
+    // Puts fp into free slot of the bucket, single writer only
+    bool TryPlace(std::size_t index, uint16_t fp);
+
+    std::size_t _capacity;
+    std::size_t _mask;
+    std::unique_ptr<std::atomic<uint64_t>[]> _buckets;
+
+    // Odd while fingerprints are being moved between buckets
+    std::atomic<uint64_t> _seq;
+    std::atomic<bool> _overflow;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_CUCKOO_FILTER_H
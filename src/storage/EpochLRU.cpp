@@ -0,0 +1,375 @@
+#include "EpochLRU.h"
+
+#include <cassert>
+
+#include <afina/KeyHash.h>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// Initial number of index buckets, index grows once there are more items than buckets
+const std::size_t kInitialBuckets = 16;
+
+} // namespace
+
+// See EpochLRU.h
+EpochLRU::Table::Table(std::size_t size) : mask(size - 1), buckets(new std::atomic<Entry *>[size]) {
+    assert((size & mask) == 0);
+    for (std::size_t i = 0; i < size; i++) {
+        buckets[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+// See EpochLRU.h
+EpochLRU::Table::~Table() {
+    for (std::size_t i = 0; i <= mask; i++) {
+        Entry *entry = buckets[i].load(std::memory_order_relaxed);
+        while (entry != nullptr) {
+            Entry *next = entry->next.load(std::memory_order_relaxed);
+            delete entry;
+            entry = next;
+        }
+    }
+    delete[] buckets;
+}
+
+// See EpochLRU.h
+EpochLRU::EpochLRU(size_t max_size)
+    : _max_size(max_size), _table(new Table(kInitialBuckets)), _current_size(0), _count(0), _evictions(0),
+      _hand(nullptr) {}
+
+// See EpochLRU.h
+EpochLRU::~EpochLRU() {
+    delete _table.load();
+
+    while (_hand != nullptr) {
+        Item *item = _hand;
+        _hand = (item->next == item) ? nullptr : item->next;
+        item->prev->next = item->next;
+        item->next->prev = item->prev;
+
+        delete item->value.load();
+        delete item;
+    }
+}
+
+// See EpochLRU.h
+bool EpochLRU::Put(const std::string &key, const std::string &value) {
+    return Put(key, HashKey(key.data(), key.size()), value);
+}
+
+// See EpochLRU.h
+bool EpochLRU::Put(const std::string &key, uint64_t hash, const std::string &value) {
+    _counters.Add(Counters::kCmdSet);
+    if (key.size() + value.size() > _max_size) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    std::atomic<Entry *> *link;
+    Entry *entry = FindEntry(key, hash, link);
+    if (entry != nullptr) {
+        UpdateItem(*entry->item, value);
+    } else {
+        InsertItem(key, hash, value);
+    }
+    return true;
+}
+
+// See EpochLRU.h
+bool EpochLRU::PutIfAbsent(const std::string &key, const std::string &value) {
+    return PutIfAbsent(key, HashKey(key.data(), key.size()), value);
+}
+
+// See EpochLRU.h
+bool EpochLRU::PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) {
+    _counters.Add(Counters::kCmdSet);
+    if (key.size() + value.size() > _max_size) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    std::atomic<Entry *> *link;
+    if (FindEntry(key, hash, link) != nullptr) {
+        return false;
+    }
+    InsertItem(key, hash, value);
+    return true;
+}
+
+// See EpochLRU.h
+bool EpochLRU::Set(const std::string &key, const std::string &value) {
+    return Set(key, HashKey(key.data(), key.size()), value);
+}
+
+// See EpochLRU.h
+bool EpochLRU::Set(const std::string &key, uint64_t hash, const std::string &value) {
+    _counters.Add(Counters::kCmdSet);
+    if (key.size() + value.size() > _max_size) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    std::atomic<Entry *> *link;
+    Entry *entry = FindEntry(key, hash, link);
+    if (entry == nullptr) {
+        return false;
+    }
+    UpdateItem(*entry->item, value);
+    return true;
+}
+
+// See EpochLRU.h
+bool EpochLRU::Delete(const std::string &key) { return Delete(key, HashKey(key.data(), key.size())); }
+
+// See EpochLRU.h
+bool EpochLRU::Delete(const std::string &key, uint64_t hash) {
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    std::atomic<Entry *> *link;
+    Entry *entry = FindEntry(key, hash, link);
+    if (entry == nullptr) {
+        _counters.Add(Counters::kDeleteMisses);
+        return false;
+    }
+    _counters.Add(Counters::kDeleteHits);
+    RemoveEntry(entry, *link);
+    return true;
+}
+
+// See EpochLRU.h
+bool EpochLRU::Get(const std::string &key, std::string &value) {
+    return Get(key, HashKey(key.data(), key.size()), value);
+}
+
+// See EpochLRU.h
+bool EpochLRU::Get(const std::string &key, uint64_t hash, std::string &value) {
+    Concurrency::EpochManager::Guard guard(_epoch);
+
+    Table *table = _table.load(std::memory_order_acquire);
+    Entry *entry = table->buckets[hash & table->mask].load(std::memory_order_acquire);
+    for (; entry != nullptr; entry = entry->next.load(std::memory_order_acquire)) {
+        Item *item = entry->item;
+        if (entry->hash != hash || item->key != key) {
+            continue;
+        }
+
+        const std::string *found = item->value.load(std::memory_order_acquire);
+        if (found == nullptr) {
+            break;
+        }
+
+        // Avoid writing into shared cache line if bit is set already
+        if (!item->referenced.load(std::memory_order_relaxed)) {
+            item->referenced.store(true, std::memory_order_relaxed);
+        }
+        value = *found;
+        _counters.Add(Counters::kGetHits);
+        return true;
+    }
+    _counters.Add(Counters::kGetMisses);
+    return false;
+}
+
+// See EpochLRU.h
+bool EpochLRU::Compute(const std::string &key, const Mutation &mutation) {
+    return Compute(key, HashKey(key.data(), key.size()), mutation);
+}
+
+// See EpochLRU.h
+bool EpochLRU::Compute(const std::string &key, uint64_t hash, const Mutation &mutation) {
+    std::lock_guard<std::mutex> lk(_mtx);
+
+    std::atomic<Entry *> *link;
+    Entry *entry = FindEntry(key, hash, link);
+    auto current = MakeCurrent([entry](Value &value) {
+        if (entry != nullptr) {
+            value = Value(*entry->item->value.load(std::memory_order_relaxed));
+        }
+    });
+    Value value;
+    switch (mutation(entry != nullptr, current, value)) {
+    case Action::kStore:
+        _counters.Add(Counters::kCmdSet);
+        if (key.size() + value.size() > _max_size) {
+            return false;
+        }
+        if (entry != nullptr) {
+            UpdateItem(*entry->item, value.str());
+        } else {
+            InsertItem(key, hash, value.str());
+        }
+        return true;
+    case Action::kDelete:
+        if (entry == nullptr) {
+            _counters.Add(Counters::kDeleteMisses);
+            return false;
+        }
+        _counters.Add(Counters::kDeleteHits);
+        RemoveEntry(entry, *link);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// See EpochLRU.h
+void EpochLRU::Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) {
+    if (!group.empty()) {
+        return;
+    }
+
+    StorageStats snapshot;
+    _counters.Collect(snapshot);
+    {
+        std::lock_guard<std::mutex> lk(_mtx);
+        snapshot.evictions = _evictions;
+        snapshot.curr_items = _count;
+        snapshot.bytes = _current_size;
+    }
+    snapshot.limit_maxbytes = _max_size;
+    snapshot.Report("", stats);
+}
+
+// See EpochLRU.h
+EpochLRU::Entry *EpochLRU::FindEntry(const std::string &key, uint64_t hash, std::atomic<Entry *> *&link) {
+    Table *table = _table.load(std::memory_order_relaxed);
+    link = &table->buckets[hash & table->mask];
+
+    Entry *entry = link->load(std::memory_order_relaxed);
+    for (; entry != nullptr; entry = link->load(std::memory_order_relaxed)) {
+        if (entry->hash == hash && entry->item->key == key) {
+            return entry;
+        }
+        link = &entry->next;
+    }
+    return nullptr;
+}
+
+// See EpochLRU.h
+void EpochLRU::InsertItem(const std::string &key, uint64_t hash, const std::string &value) {
+    FreeSpace(key.size() + value.size(), nullptr);
+
+    // Item must be complete before it gets published
+    Item *item = new Item(key, hash, new std::string(value));
+    Entry *entry = new Entry(hash, item);
+
+    Table *table = _table.load(std::memory_order_relaxed);
+    std::atomic<Entry *> &bucket = table->buckets[hash & table->mask];
+    entry->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bucket.store(entry, std::memory_order_release);
+
+    // New item is the last one CLOCK hand reaches
+    if (_hand == nullptr) {
+        item->prev = item->next = item;
+        _hand = item;
+    } else {
+        item->next = _hand;
+        item->prev = _hand->prev;
+        _hand->prev->next = item;
+        _hand->prev = item;
+    }
+
+    _current_size += key.size() + value.size();
+    if (++_count > table->mask + 1) {
+        Grow();
+    }
+}
+
+// See EpochLRU.h
+void EpochLRU::UpdateItem(Item &item, const std::string &value) {
+    std::size_t old_size = item.value.load(std::memory_order_relaxed)->size();
+    if (value.size() > old_size) {
+        FreeSpace(value.size() - old_size, &item);
+    }
+
+    const std::string *old_value = item.value.exchange(new std::string(value), std::memory_order_acq_rel);
+    item.referenced.store(true, std::memory_order_relaxed);
+    _current_size = _current_size - old_size + value.size();
+
+    _epoch.Retire(old_value);
+}
+
+// See EpochLRU.h
+void EpochLRU::RemoveEntry(Entry *entry, std::atomic<Entry *> &link) {
+    // Unlink first, so that no new reader could find it
+    link.store(entry->next.load(std::memory_order_relaxed), std::memory_order_release);
+
+    Item *item = entry->item;
+    const std::string *value = item->value.exchange(nullptr, std::memory_order_acq_rel);
+    _current_size -= item->key.size() + value->size();
+    _count--;
+
+    if (item->next == item) {
+        _hand = nullptr;
+    } else {
+        if (_hand == item) {
+            _hand = item->next;
+        }
+        item->prev->next = item->next;
+        item->next->prev = item->prev;
+    }
+
+    // Readers of the retired tables could still reach item, so it goes last
+    _epoch.Retire(value);
+    _epoch.Retire(entry);
+    _epoch.Retire(item);
+}
+
+// See EpochLRU.h
+void EpochLRU::FreeSpace(std::size_t put_size, const Item *keep) {
+    assert(put_size <= _max_size);
+
+    while (_current_size + put_size > _max_size && _hand != nullptr) {
+        Item *victim = _hand;
+        if (victim == keep) {
+            // Item being updated is all there is, its old size is counted already, so the new one fits
+            if (victim->next == victim) {
+                break;
+            }
+            _hand = victim->next;
+            continue;
+        }
+        if (victim->referenced.load(std::memory_order_relaxed)) {
+            // Second chance, once the hand comes back bit is clear and item goes even if it is the only one.
+            // Readers still copying its value don't stop that, they hold the epoch and value is retired
+            victim->referenced.store(false, std::memory_order_relaxed);
+            _hand = victim->next;
+            continue;
+        }
+
+        std::atomic<Entry *> *link;
+        Entry *entry = FindEntry(victim->key, victim->hash, link);
+        assert(entry != nullptr);
+        RemoveEntry(entry, *link);
+        _evictions++;
+    }
+}
+
+// See EpochLRU.h
+void EpochLRU::Grow() {
+    Table *old_table = _table.load(std::memory_order_relaxed);
+    Table *table = new Table(2 * (old_table->mask + 1));
+
+    // Old entries are still traversed by readers, so new table gets its own copies
+    for (std::size_t i = 0; i <= old_table->mask; i++) {
+        Entry *entry = old_table->buckets[i].load(std::memory_order_relaxed);
+        for (; entry != nullptr; entry = entry->next.load(std::memory_order_relaxed)) {
+            Entry *copy = new Entry(entry->hash, entry->item);
+            std::atomic<Entry *> &bucket = table->buckets[entry->hash & table->mask];
+            copy->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            bucket.store(copy, std::memory_order_relaxed);
+        }
+    }
+
+    _table.store(table, std::memory_order_release);
+    _epoch.Retire(old_table);
+}
+
+} // namespace Backend
+} // namespace Afina
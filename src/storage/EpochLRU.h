@@ -0,0 +1,146 @@
+#ifndef AFINA_STORAGE_EPOCH_LRU_H
+#define AFINA_STORAGE_EPOCH_LRU_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include <afina/Storage.h>
+#include <afina/concurrency/Epoch.h>
+
+#include "Counters.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Storage with lock free reads
+ * Readers enter epoch, find item through the atomically published hash index and copy value out, no lock is
+ * taken. Writers are serialized by the mutex, they never modify anything reader could see in place: value
+ * replaced by pointer swap, index resized by publishing new table, and all replaced parts get retired into
+ * the epoch manager for deferred freeing.
+ *
+ * Exact LRU order would require every reader to relink list, so eviction is approximated by CLOCK: reader
+ * only sets reference bit of the item (if it isn't set already), writer sweeps items in a ring giving a
+ * second chance to the referenced ones.
+ */
+class EpochLRU : public Afina::Storage {
+private:
+    // Cached element, all fields except value and reference bit are guarded by _mtx
+    struct Item {
+        Item(const std::string &k, uint64_t h, const std::string *v)
+            : key(k), hash(h), value(v), referenced(false), prev(nullptr), next(nullptr) {}
+
+        const std::string key;
+        const uint64_t hash;
+
+        // nullptr once item removed from the storage
+        std::atomic<const std::string *> value;
+
+        // CLOCK reference bit
+        std::atomic<bool> referenced;
+
+        // CLOCK ring
+        Item *prev;
+        Item *next;
+    };
+
+    // Entry of the hash index bucket chain, immutable except of the link
+    struct Entry {
+        Entry(uint64_t h, Item *i) : hash(h), item(i), next(nullptr) {}
+
+        const uint64_t hash;
+        Item *const item;
+        std::atomic<Entry *> next;
+    };
+
+    // Hash index, table owns all entries linked into it
+    struct Table {
+        explicit Table(std::size_t size);
+        ~Table();
+
+        const std::size_t mask;
+        std::atomic<Entry *> *buckets;
+    };
+
+public:
+    EpochLRU(size_t max_size = 1024);
+    ~EpochLRU();
+
+    // Implements Afina::Storage interface, hashed variants take the hash computed by HashKey, see afina/KeyHash.h
+    bool Put(const std::string &key, const std::string &value) override;
+    bool Put(const std::string &key, uint64_t hash, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override;
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override;
+    bool Set(const std::string &key, uint64_t hash, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+    bool Delete(const std::string &key, uint64_t hash) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override;
+
+    // Implements Afina::Storage interface, mutation runs under the writers lock
+    bool Compute(const std::string &key, const Mutation &mutation) override;
+    bool Compute(const std::string &key, uint64_t hash, const Mutation &mutation) override;
+
+    // Implements Afina::Storage interface
+    void Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) override;
+
+private:
+    // Finds entry of the given key in the current table, link is set to the pointer entry is referenced by
+    Entry *FindEntry(const std::string &key, uint64_t hash, std::atomic<Entry *> *&link);
+
+    void InsertItem(const std::string &key, uint64_t hash, const std::string &value);
+
+    void UpdateItem(Item &item, const std::string &value);
+
+    void RemoveEntry(Entry *entry, std::atomic<Entry *> &link);
+
+    // Evicts items by CLOCK until put_size bytes fit, item keep is never evicted
+    void FreeSpace(std::size_t put_size, const Item *keep);
+
+    // Rebuilds index with twice as much buckets
+    void Grow();
+
+private:
+    // Maximum number of bytes could be stored in this cache.
+    // i.e all (keys+values) must be not greater than the _max_size
+    const std::size_t _max_size;
+
+    // Operation counters, readers update them without taking the lock
+    Counters _counters;
+
+    // Reclamation of everything readers could see
+    Concurrency::EpochManager _epoch;
+
+    // Published index
+    std::atomic<Table *> _table;
+
+    // Writers synchronization, guards everything below
+    std::mutex _mtx;
+
+    // Current number of bytes in this cache.
+    std::size_t _current_size;
+
+    // Number of items in the index
+    std::size_t _count;
+
+    // Number of items evicted by CLOCK
+    uint64_t _evictions;
+
+    // CLOCK hand, points to the next eviction candidate
+    Item *_hand;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_EPOCH_LRU_H
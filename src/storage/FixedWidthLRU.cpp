@@ -0,0 +1,368 @@
+#include "FixedWidthLRU.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <afina/KeyHash.h>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// Control bytes of free slots have the high bit set, those of used ones keep 7 bits of the hash
+const uint8_t kEmpty = 0x80;
+const uint8_t kDeleted = 0xfe;
+const uint8_t kHashBits = 0x7f;
+
+inline bool is_full(uint8_t ctrl) { return (ctrl & 0x80) == 0; }
+
+} // namespace
+
+// See FixedWidthLRU.h
+template <std::size_t Width>
+FixedWidthLRU<Width>::FixedWidthLRU(std::size_t max_size)
+    : _max_size(max_size), _count(0), _deleted(0), _key_bytes(0), _hand(0), _evictions(0) {
+    const std::size_t slot_size = 1 + sizeof(KeySlot) + sizeof(ValueSlot);
+    _n_groups = std::max<std::size_t>(max_size / (kGroup * slot_size), 1);
+    _n_slots = _n_groups * kGroup;
+    _max_items = _n_slots - _n_slots / 8;
+
+    _ctrl.reset(new uint8_t[_n_slots]);
+    std::memset(_ctrl.get(), kEmpty, _n_slots);
+    _keys.reset(new KeySlot[_n_slots]);
+    _values.reset(new ValueSlot[_n_slots]);
+    _referenced.assign((_n_slots + 63) / 64, 0);
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width> bool FixedWidthLRU<Width>::Put(const std::string &key, const std::string &value) {
+    return Put(key, HashKey(key.data(), key.size()), value);
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width>
+bool FixedWidthLRU<Width>::Put(const std::string &key, uint64_t hash, const std::string &value) {
+    _counters.Add(Counters::kCmdSet);
+    if (!Fits(key, value)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtx);
+    std::size_t slot = Find(key, hash);
+    if (slot != _n_slots) {
+        std::memcpy(_values[slot].data, value.data(), Width);
+        Reference(slot);
+    } else {
+        Insert(key, hash, value);
+    }
+    return true;
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width> bool FixedWidthLRU<Width>::PutIfAbsent(const std::string &key, const std::string &value) {
+    return PutIfAbsent(key, HashKey(key.data(), key.size()), value);
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width>
+bool FixedWidthLRU<Width>::PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) {
+    _counters.Add(Counters::kCmdSet);
+    if (!Fits(key, value)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtx);
+    if (Find(key, hash) != _n_slots) {
+        return false;
+    }
+    Insert(key, hash, value);
+    return true;
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width> bool FixedWidthLRU<Width>::Set(const std::string &key, const std::string &value) {
+    return Set(key, HashKey(key.data(), key.size()), value);
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width>
+bool FixedWidthLRU<Width>::Set(const std::string &key, uint64_t hash, const std::string &value) {
+    _counters.Add(Counters::kCmdSet);
+    if (!Fits(key, value)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtx);
+    std::size_t slot = Find(key, hash);
+    if (slot == _n_slots) {
+        return false;
+    }
+    std::memcpy(_values[slot].data, value.data(), Width);
+    Reference(slot);
+    return true;
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width> bool FixedWidthLRU<Width>::Delete(const std::string &key) {
+    return Delete(key, HashKey(key.data(), key.size()));
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width> bool FixedWidthLRU<Width>::Delete(const std::string &key, uint64_t hash) {
+    if (key.size() > kMaxKey) {
+        _counters.Add(Counters::kDeleteMisses);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtx);
+    std::size_t slot = Find(key, hash);
+    if (slot == _n_slots) {
+        _counters.Add(Counters::kDeleteMisses);
+        return false;
+    }
+    _counters.Add(Counters::kDeleteHits);
+    Erase(slot);
+    return true;
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width> bool FixedWidthLRU<Width>::Get(const std::string &key, std::string &value) {
+    return Get(key, HashKey(key.data(), key.size()), value);
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width> bool FixedWidthLRU<Width>::Get(const std::string &key, uint64_t hash, std::string &value) {
+    if (key.size() > kMaxKey) {
+        _counters.Add(Counters::kGetMisses);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtx);
+    std::size_t slot = Find(key, hash);
+    if (slot == _n_slots) {
+        _counters.Add(Counters::kGetMisses);
+        return false;
+    }
+    _counters.Add(Counters::kGetHits);
+    Reference(slot);
+    value.assign(_values[slot].data, Width);
+    return true;
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width> bool FixedWidthLRU<Width>::Compute(const std::string &key, const Mutation &mutation) {
+    return Compute(key, HashKey(key.data(), key.size()), mutation);
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width>
+bool FixedWidthLRU<Width>::Compute(const std::string &key, uint64_t hash, const Mutation &mutation) {
+    if (key.size() > kMaxKey) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtx);
+    std::size_t slot = Find(key, hash);
+    auto current = MakeCurrent([this, slot](Value &value) {
+        if (slot != _n_slots) {
+            value.Append(_values[slot].data, Width);
+        }
+    });
+    Value value;
+    switch (mutation(slot != _n_slots, current, value)) {
+    case Action::kStore: {
+        _counters.Add(Counters::kCmdSet);
+        if (value.size() != Width) {
+            return false;
+        }
+        const std::string bytes = value.str();
+        if (slot != _n_slots) {
+            std::memcpy(_values[slot].data, bytes.data(), Width);
+            Reference(slot);
+        } else {
+            Insert(key, hash, bytes);
+        }
+        return true;
+    }
+    case Action::kDelete:
+        if (slot == _n_slots) {
+            _counters.Add(Counters::kDeleteMisses);
+            return false;
+        }
+        _counters.Add(Counters::kDeleteHits);
+        Erase(slot);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width>
+void FixedWidthLRU<Width>::Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) {
+    if (group.empty()) {
+        StorageStats snapshot;
+        Snapshot(snapshot);
+        snapshot.Report("", stats);
+    }
+}
+
+// See FixedWidthLRU.h
+template <std::size_t Width> void FixedWidthLRU<Width>::Snapshot(StorageStats &stats) {
+    _counters.Collect(stats);
+
+    std::lock_guard<std::mutex> lk(_mtx);
+    stats.evictions += _evictions;
+    stats.curr_items += _count;
+    stats.bytes += _key_bytes + _count * Width;
+    stats.limit_maxbytes += _max_size;
+}
+
+template <std::size_t Width> std::size_t FixedWidthLRU<Width>::Find(const std::string &key, uint64_t hash) const {
+    const uint8_t ctrl = hash & kHashBits;
+    std::size_t group = Home(hash);
+    for (std::size_t probe = 0; probe < _n_groups; probe++, group = Next(group)) {
+        for (uint32_t match = Match(group, ctrl); match != 0; match &= match - 1) {
+            std::size_t slot = group * kGroup + __builtin_ctz(match);
+            const KeySlot &candidate = _keys[slot];
+            if (candidate.size == key.size() && std::memcmp(candidate.data, key.data(), key.size()) == 0) {
+                return slot;
+            }
+        }
+
+        // Key would have been put into this group if it had been inserted
+        if (Match(group, kEmpty) != 0) {
+            break;
+        }
+    }
+    return _n_slots;
+}
+
+template <std::size_t Width> uint32_t FixedWidthLRU<Width>::Match(std::size_t group, uint8_t ctrl) const {
+    const uint8_t *bytes = &_ctrl[group * kGroup];
+#ifdef __SSE2__
+    __m128i all = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(all, _mm_set1_epi8(static_cast<char>(ctrl))));
+#else
+    uint32_t match = 0;
+    for (std::size_t i = 0; i < kGroup; i++) {
+        match |= uint32_t(bytes[i] == ctrl) << i;
+    }
+    return match;
+#endif
+}
+
+template <std::size_t Width>
+void FixedWidthLRU<Width>::Insert(const std::string &key, uint64_t hash, const std::string &value) {
+    MakeRoom();
+
+    std::size_t slot = FindFree(hash);
+    if (_ctrl[slot] == kDeleted) {
+        _deleted--;
+    }
+    _ctrl[slot] = hash & kHashBits;
+    _keys[slot].size = key.size();
+    std::memcpy(_keys[slot].data, key.data(), key.size());
+    std::memcpy(_values[slot].data, value.data(), Width);
+    _count++;
+    _key_bytes += key.size();
+}
+
+template <std::size_t Width> void FixedWidthLRU<Width>::Erase(std::size_t slot) {
+    // Group that has an empty slot was never full, so no probe went past it and slot could become empty as well
+    _ctrl[slot] = Match(slot / kGroup, kEmpty) != 0 ? kEmpty : kDeleted;
+    if (_ctrl[slot] == kDeleted) {
+        _deleted++;
+    }
+    _referenced[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    _count--;
+    _key_bytes -= _keys[slot].size;
+}
+
+template <std::size_t Width> void FixedWidthLRU<Width>::MakeRoom() {
+    while (_count + _deleted >= _max_items) {
+        if (_deleted > _max_items / 16) {
+            Rebuild();
+            continue;
+        }
+
+        // CLOCK: referenced items get another round
+        for (;;) {
+            std::size_t slot = _hand;
+            _hand = _hand + 1 < _n_slots ? _hand + 1 : 0;
+            if (!is_full(_ctrl[slot])) {
+                continue;
+            }
+            uint64_t &word = _referenced[slot / 64];
+            const uint64_t bit = uint64_t(1) << (slot % 64);
+            if (word & bit) {
+                word &= ~bit;
+                continue;
+            }
+            Erase(slot);
+            _evictions++;
+            break;
+        }
+    }
+}
+
+template <std::size_t Width> std::size_t FixedWidthLRU<Width>::FindFree(uint64_t hash) const {
+    std::size_t group = Home(hash);
+    uint32_t free;
+    while ((free = Match(group, kEmpty) | Match(group, kDeleted)) == 0) {
+        group = Next(group);
+    }
+    return group * kGroup + __builtin_ctz(free);
+}
+
+template <std::size_t Width> void FixedWidthLRU<Width>::Rebuild() {
+    // Deleted slots become empty and items become deleted, i.e. not placed yet, the same way SwissTable drops
+    // tombstones without resize. Placed items get their hash bits back
+    for (std::size_t slot = 0; slot < _n_slots; slot++) {
+        _ctrl[slot] = is_full(_ctrl[slot]) ? kDeleted : kEmpty;
+    }
+
+    for (std::size_t from = 0; from < _n_slots; from++) {
+        if (_ctrl[from] != kDeleted) {
+            continue;
+        }
+
+        const uint64_t hash = HashKey(_keys[from].data, _keys[from].size);
+        const std::size_t to = FindFree(hash);
+
+        // Item is in the first group probe could put it to already
+        if (to / kGroup == from / kGroup) {
+            _ctrl[from] = hash & kHashBits;
+            continue;
+        }
+
+        const bool occupied = _ctrl[to] == kDeleted;
+        std::swap(_keys[from], _keys[to]);
+        std::swap(_values[from], _values[to]);
+        const uint64_t from_bit = (_referenced[from / 64] >> (from % 64)) & 1;
+        const uint64_t to_bit = (_referenced[to / 64] >> (to % 64)) & 1;
+        _referenced[from / 64] ^= (from_bit ^ to_bit) << (from % 64);
+        _referenced[to / 64] ^= (from_bit ^ to_bit) << (to % 64);
+        _ctrl[to] = hash & kHashBits;
+
+        // Item swapped in is not placed yet, it is the next one to place
+        if (occupied) {
+            from--;
+        } else {
+            _ctrl[from] = kEmpty;
+        }
+    }
+    _deleted = 0;
+}
+
+// Widths of counters and of small records
+template class FixedWidthLRU<8>;
+template class FixedWidthLRU<16>;
+
+} // namespace Backend
+} // namespace Afina
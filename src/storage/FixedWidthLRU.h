@@ -0,0 +1,159 @@
+#ifndef AFINA_STORAGE_FIXED_WIDTH_LRU_H
+#define AFINA_STORAGE_FIXED_WIDTH_LRU_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+
+#include "Counters.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Storage of values of the single width
+ * Counters and small records don't need a string per value: every slot of this storage has room for the key of
+ * up to kMaxKey bytes and the value of exactly Width bytes, and slots are laid out as structure of arrays:
+ *
+ * - control bytes, 7 bits of the key hash per slot, or marker of the empty/deleted one
+ * - keys, length byte followed by key bytes
+ * - values, Width bytes each
+ *
+ * Slots are split into groups of 16, lookup compares control bytes of the whole group at once (single SSE2
+ * comparison) and touches keys only of slots whose hash bits match, the same way SwissTable does. Group where
+ * probing starts is picked by the rest of the hash, scaled to the number of groups by multiply-shift, so that
+ * the number of groups is whatever fits into the memory limit. Probing moves to the next group only if this
+ * one has no empty slots.
+ *
+ * Table is allocated once for the memory limit, so each item costs 1 + kKeySlot + Width bytes and a bit, instead
+ * of a couple of hundreds SimpleLRU spends on node, index entry and strings. Once table is 7/8 full, items are
+ * evicted by CLOCK: Get and Put set the reference bit, hand clears it and evicts the first slot it finds clear.
+ *
+ * Put of the value of other width or of the longer key fails. Thread safe, all operations are serialized by the
+ * single mutex.
+ */
+template <std::size_t Width> class FixedWidthLRU : public Afina::Storage {
+public:
+    // Longest key that fits into the slot
+    enum : std::size_t { kKeySlot = 24, kMaxKey = kKeySlot - 1, kGroup = 16 };
+
+    FixedWidthLRU(std::size_t max_size = 1024);
+    ~FixedWidthLRU() {}
+
+    // True if item of such size could be stored
+    static inline bool Fits(const std::string &key, const std::string &value) {
+        return key.size() <= kMaxKey && value.size() == Width;
+    }
+
+    // Implements Afina::Storage interface, hashed variants take the hash computed by HashKey, see afina/KeyHash.h
+    bool Put(const std::string &key, const std::string &value) override;
+    bool Put(const std::string &key, uint64_t hash, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override;
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override;
+    bool Set(const std::string &key, uint64_t hash, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+    bool Delete(const std::string &key, uint64_t hash) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override;
+
+    // Implements Afina::Storage interface, mutation runs under the lock
+    bool Compute(const std::string &key, const Mutation &mutation) override;
+    bool Compute(const std::string &key, uint64_t hash, const Mutation &mutation) override;
+
+    // Implements Afina::Storage interface
+    void Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) override;
+
+    /**
+     * Adds statistics of this storage into stats
+     */
+    void Snapshot(StorageStats &stats);
+
+    // Number of slots and number of items that could be stored
+    inline std::size_t capacity() const { return _n_slots; }
+    inline std::size_t max_items() const { return _max_items; }
+
+private:
+    FixedWidthLRU(const FixedWidthLRU &);            // = delete;
+    FixedWidthLRU &operator=(const FixedWidthLRU &); // = delete;
+
+    struct KeySlot {
+        uint8_t size;
+        char data[kMaxKey];
+    };
+
+    struct ValueSlot {
+        char data[Width];
+    };
+
+    // Slot of the key, or n_slots if it is absent
+    std::size_t Find(const std::string &key, uint64_t hash) const;
+
+    // Bit mask of slots in the group whose control byte equals to the given one
+    uint32_t Match(std::size_t group, uint8_t ctrl) const;
+
+    // Stores item into the free slot, key must be absent
+    void Insert(const std::string &key, uint64_t hash, const std::string &value);
+
+    void Erase(std::size_t slot);
+
+    // Evicts items or drops deleted markers until there is room for one more item
+    void MakeRoom();
+
+    // First free slot of the probe sequence of the hash
+    std::size_t FindFree(uint64_t hash) const;
+
+    // Rehashes all items in place, so that no deleted slots are left
+    void Rebuild();
+
+    // Group where probing of the hash starts, bits 7-38 of it scaled to the number of groups
+    inline std::size_t Home(uint64_t hash) const { return (uint64_t(uint32_t(hash >> 7)) * _n_groups) >> 32; }
+
+    inline std::size_t Next(std::size_t group) const { return group + 1 < _n_groups ? group + 1 : 0; }
+
+    inline void Reference(std::size_t slot) { _referenced[slot / 64] |= uint64_t(1) << (slot % 64); }
+
+private:
+    const std::size_t _max_size;
+
+    // Table takes the whole memory limit, number of slots is the multiple of the group size
+    std::size_t _n_groups;
+    std::size_t _n_slots;
+    std::size_t _max_items;
+
+    std::unique_ptr<uint8_t[]> _ctrl;
+    std::unique_ptr<KeySlot[]> _keys;
+    std::unique_ptr<ValueSlot[]> _values;
+    std::vector<uint64_t> _referenced;
+
+    // Guards everything below and arrays above
+    std::mutex _mtx;
+
+    std::size_t _count;
+    std::size_t _deleted;
+    std::size_t _key_bytes;
+
+    // CLOCK hand
+    std::size_t _hand;
+
+    Counters _counters;
+    uint64_t _evictions;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_FIXED_WIDTH_LRU_H
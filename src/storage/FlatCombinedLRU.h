@@ -0,0 +1,154 @@
+#ifndef AFINA_STORAGE_FLAT_COMBINED_LRU_H
+#define AFINA_STORAGE_FLAT_COMBINED_LRU_H
+
+#include <string>
+
+#include <afina/concurrency/FlatCombine.h>
+
+#include "SimpleLRU.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # SimpleLRU behind flat combining
+ * Each call is published as an operation, and one thread at a time applies everything published so far.
+ * Under heavy contention that replaces mutex ping-pong of ThreadSafeSimplLRU by a single thread working on
+ * the LRU that is hot in its cache.
+ */
+class FlatCombinedLRU : public Afina::Storage {
+private:
+    // Storage call waiting for the combiner
+    struct Operation {
+        enum class Type { kPut, kPutIfAbsent, kSet, kDelete, kGet, kStats, kDeletePrefix, kPutTagged, kCompute };
+
+        Type type;
+        const std::string *key;
+        const std::string *value;
+        std::string *out;
+        bool result;
+        StorageStats *stats;
+        const std::string *tag;
+        std::size_t deleted;
+        const Mutation *mutation;
+    };
+
+public:
+    FlatCombinedLRU(size_t max_size = 1024, const ArenaConfig &arena = ArenaConfig())
+        : _lru(max_size, arena), _combiner([this](Operation &op) { Apply(op); }) {}
+    ~FlatCombinedLRU() {}
+
+    // see SimpleLRU.h
+    void Start() override { _lru.Start(); }
+
+    // see SimpleLRU.h
+    bool Put(const std::string &key, const std::string &value) override {
+        return Execute(Operation::Type::kPut, key, &value, nullptr);
+    }
+
+    // see SimpleLRU.h
+    bool PutIfAbsent(const std::string &key, const std::string &value) override {
+        return Execute(Operation::Type::kPutIfAbsent, key, &value, nullptr);
+    }
+
+    // see SimpleLRU.h
+    bool Set(const std::string &key, const std::string &value) override {
+        return Execute(Operation::Type::kSet, key, &value, nullptr);
+    }
+
+    // see SimpleLRU.h
+    bool Delete(const std::string &key) override { return Execute(Operation::Type::kDelete, key, nullptr, nullptr); }
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, std::string &value) override {
+        return Execute(Operation::Type::kGet, key, nullptr, &value);
+    }
+
+    // see SimpleLRU.h
+    bool DeletePrefix(const std::string &prefix, std::size_t &deleted) override {
+        Operation op{Operation::Type::kDeletePrefix, &prefix, nullptr, nullptr, false, nullptr, nullptr, 0, nullptr};
+        _combiner.Execute(op);
+        deleted = op.deleted;
+        return op.result;
+    }
+
+    // see SimpleLRU.h
+    bool PutTagged(const std::string &key, const std::string &value, const std::string &tag) override {
+        Operation op{Operation::Type::kPutTagged, &key, &value, nullptr, false, nullptr, &tag, 0, nullptr};
+        _combiner.Execute(op);
+        return op.result;
+    }
+
+    // see SimpleLRU.h, mutation is applied by the combiner thread
+    bool Compute(const std::string &key, const Mutation &mutation) override {
+        Operation op{Operation::Type::kCompute, &key, nullptr, nullptr, false, nullptr, nullptr, 0, &mutation};
+        _combiner.Execute(op);
+        return op.result;
+    }
+
+    // see SimpleLRU.h, doesn't need the combiner
+    bool InvalidateTag(const std::string &tag) override { return _lru.InvalidateTag(tag); }
+
+    // see SimpleLRU.h, doesn't need the combiner either
+    bool FlushAll(uint32_t delay) override { return _lru.FlushAll(delay); }
+
+    // see SimpleLRU.h
+    void Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) override {
+        if (!group.empty()) {
+            return;
+        }
+
+        StorageStats snapshot;
+        Operation op{Operation::Type::kStats, nullptr, nullptr, nullptr, false, &snapshot, nullptr, 0, nullptr};
+        _combiner.Execute(op);
+        snapshot.Report("", stats);
+    }
+
+private:
+    bool Execute(Operation::Type type, const std::string &key, const std::string *value, std::string *out) {
+        Operation op{type, &key, value, out, false, nullptr, nullptr, 0, nullptr};
+        _combiner.Execute(op);
+        return op.result;
+    }
+
+    // Called by combiner thread only
+    void Apply(Operation &op) {
+        switch (op.type) {
+        case Operation::Type::kPut:
+            op.result = _lru.Put(*op.key, *op.value);
+            break;
+        case Operation::Type::kPutIfAbsent:
+            op.result = _lru.PutIfAbsent(*op.key, *op.value);
+            break;
+        case Operation::Type::kSet:
+            op.result = _lru.Set(*op.key, *op.value);
+            break;
+        case Operation::Type::kDelete:
+            op.result = _lru.Delete(*op.key);
+            break;
+        case Operation::Type::kGet:
+            op.result = _lru.Get(*op.key, *op.out);
+            break;
+        case Operation::Type::kStats:
+            _lru.Snapshot(*op.stats);
+            break;
+        case Operation::Type::kDeletePrefix:
+            op.result = _lru.DeletePrefix(*op.key, op.deleted);
+            break;
+        case Operation::Type::kPutTagged:
+            op.result = _lru.PutTagged(*op.key, *op.value, *op.tag);
+            break;
+        case Operation::Type::kCompute:
+            op.result = _lru.Compute(*op.key, *op.mutation);
+            break;
+        }
+    }
+
+    SimpleLRU _lru;
+    Concurrency::FlatCombine<Operation> _combiner;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_FLAT_COMBINED_LRU_H
@@ -0,0 +1,96 @@
+#include "HeavyHitters.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+namespace Afina {
+namespace Backend {
+
+// See HeavyHitters.h
+HeavyHitters::HeavyHitters(std::size_t k, uint32_t sample_period, std::chrono::steady_clock::duration window)
+    : _k(k), _sample_period(std::max<uint32_t>(1, sample_period)), _window(window) {}
+
+// See HeavyHitters.h
+void HeavyHitters::Record(Local &local, const std::string &key, bool get) {
+    // Random gap between samples, so that periodic access patterns are not aliased
+    local.seed = local.seed * 1103515245 + 12345 + uint32_t(reinterpret_cast<uintptr_t>(&local));
+    local.skip = 1 + (local.seed >> 8) % (2 * _sample_period - 1);
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lk(local.mtx);
+    if (!local.started) {
+        local.started = true;
+        local.since = now;
+    } else if (now - local.since > _window) {
+        local.since = now - (now - local.since) / 2;
+        auto end = std::remove_if(local.counters.begin(), local.counters.end(), [](Counter &counter) {
+            counter.count /= 2;
+            counter.gets /= 2;
+            return counter.count == 0;
+        });
+        local.counters.erase(end, local.counters.end());
+    }
+
+    std::vector<Counter> &counters = local.counters;
+    auto it = std::find_if(counters.begin(), counters.end(),
+                           [&key](const Counter &counter) { return counter.key == key; });
+    if (it == counters.end()) {
+        if (counters.size() < 4 * _k) {
+            counters.push_back(Counter{key, 0, 0});
+            it = counters.end() - 1;
+        } else {
+            // Space-Saving: the least counted key gives its counter away, count goes on from there
+            it = std::min_element(counters.begin(), counters.end(),
+                                  [](const Counter &a, const Counter &b) { return a.count < b.count; });
+            it->key = key;
+            it->gets = 0;
+        }
+    }
+    it->count++;
+    it->gets += get;
+}
+
+// See HeavyHitters.h
+void HeavyHitters::Top(std::vector<Hitter> &top) {
+    auto now = std::chrono::steady_clock::now();
+    std::map<std::string, Hitter> merged;
+    _local.for_each([this, now, &merged](Local &local) {
+        std::lock_guard<std::mutex> lk(local.mtx);
+        if (!local.started) {
+            return;
+        }
+
+        // Rates of the thread that just started are not inflated by the short time
+        double seconds = std::max(1.0, std::chrono::duration<double>(now - local.since).count());
+        for (auto &counter : local.counters) {
+            Hitter &hitter = merged[counter.key];
+            hitter.rate += double(counter.count) * _sample_period / seconds;
+            hitter.get_rate += double(counter.gets) * _sample_period / seconds;
+        }
+    });
+
+    top.clear();
+    for (auto &entry : merged) {
+        top.push_back(Hitter{entry.first, entry.second.rate, entry.second.get_rate});
+    }
+    std::sort(top.begin(), top.end(), [](const Hitter &a, const Hitter &b) { return a.rate > b.rate; });
+    if (top.size() > _k) {
+        top.resize(_k);
+    }
+}
+
+// See HeavyHitters.h
+void HeavyHitters::Report(std::size_t rank, const Hitter &hitter,
+                          std::vector<std::pair<std::string, std::string>> &out) {
+    const std::string prefix = "hotkey:" + std::to_string(rank) + ":";
+    char rate[32], ratio[16];
+    std::snprintf(rate, sizeof(rate), "%.1f", hitter.rate);
+    std::snprintf(ratio, sizeof(ratio), "%.2f", hitter.rate > 0 ? hitter.get_rate / hitter.rate : 0);
+    out.emplace_back(prefix + "key", hitter.key);
+    out.emplace_back(prefix + "ops_per_sec", rate);
+    out.emplace_back(prefix + "get_ratio", ratio);
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,102 @@
+#ifndef AFINA_STORAGE_HEAVY_HITTERS_H
+#define AFINA_STORAGE_HEAVY_HITTERS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <afina/concurrency/ThreadLocal.h>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Most accessed keys
+ * Space-Saving summary of sampled accesses: every thread picks one access out of sample_period on average and
+ * counts its key in its own summary of 4 * k counters. Key that isn't there takes the counter of the least
+ * counted one and starts from its count, so that count never underestimates and overestimates no more than
+ * by the count it took over. Each key accessed more often than 1 / (4 * k) of all sampled accesses is
+ * guaranteed to have a counter.
+ *
+ * Summaries are merged by Top, so that access path touches nothing shared. Every window counts are halved
+ * along with the time they were collected for, rate stays the same but recent accesses weigh more, so hot key
+ * that cooled down leaves the top in a couple of windows.
+ *
+ * Memory is bounded by 4 * k keys per thread. Thread safe.
+ */
+class HeavyHitters {
+public:
+    // Key with its estimated rates of accesses and of gets among them, per second
+    struct Hitter {
+        std::string key;
+        double rate;
+        double get_rate;
+    };
+
+    HeavyHitters(std::size_t k, uint32_t sample_period = 64,
+                 std::chrono::steady_clock::duration window = std::chrono::seconds(10));
+    ~HeavyHitters() {}
+
+    /**
+     * Counts access to the key, sampled ones only
+     */
+    inline void Add(const std::string &key, bool get) {
+        Local &local = _local.get();
+        if (--local.skip == 0) {
+            Record(local, key, get);
+        }
+    }
+
+    /**
+     * Replaces contents of top by up to k most accessed keys, most accessed first
+     */
+    void Top(std::vector<Hitter> &top);
+
+    /**
+     * Appends "hotkey:<rank>:key", "hotkey:<rank>:ops_per_sec" and "hotkey:<rank>:get_ratio" of the hitter
+     */
+    static void Report(std::size_t rank, const Hitter &hitter, std::vector<std::pair<std::string, std::string>> &out);
+
+    inline std::size_t k() const { return _k; }
+
+private:
+    HeavyHitters(const HeavyHitters &);            // = delete;
+    HeavyHitters &operator=(const HeavyHitters &); // = delete;
+
+    struct Counter {
+        std::string key;
+        uint64_t count;
+        uint64_t gets;
+    };
+
+    // Summary of a single thread, guarded by its own mutex that only Top contends for
+    struct Local {
+        Local() : skip(1), seed(0), started(false) {}
+
+        uint32_t skip;
+        uint32_t seed;
+
+        std::mutex mtx;
+        bool started;
+        std::chrono::steady_clock::time_point since;
+        std::vector<Counter> counters;
+    };
+
+    // Counts the sampled access and picks the next one
+    void Record(Local &local, const std::string &key, bool get);
+
+    const std::size_t _k;
+    const uint32_t _sample_period;
+    const std::chrono::steady_clock::duration _window;
+
+    Concurrency::ThreadLocal<Local> _local;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_HEAVY_HITTERS_H
@@ -0,0 +1,548 @@
+#include "LogStructuredLRU.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include <afina/KeyHash.h>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// Marks free index slot and absent survivor segment
+const uint32_t kNoSegment = UINT32_MAX;
+
+// Each item in the log is a header followed by key and value bytes. Header is key size with flags in the upper
+// bits, then value size
+const std::size_t kHeaderSize = 2 * sizeof(uint32_t);
+const uint32_t kDead = 1u << 31;
+const uint32_t kReferenced = 1u << 30;
+const uint32_t kKeyMask = kReferenced - 1;
+
+const std::size_t kDefaultSegmentSize = 1024 * 1024UL;
+
+// Smallest segment picked by default, smaller ones would make item size limit and cleaning granularity useless
+const std::size_t kMinSegmentSize = 64 * 1024UL;
+
+// Bytes of the segment background cleaner goes through under the lock at once
+const std::size_t kCleanBatch = 64 * 1024UL;
+const std::size_t kInitialSlots = 16;
+
+// Put cleans inline the segment with that fraction of live bytes at most, otherwise evicts the oldest one. Cleaning
+// segment with fraction u costs u / (1 - u) bytes copied per byte freed
+const double kCleanUtilization = 0.75;
+
+// Background cleaner doesn't hold anyone up, so it goes further
+const double kBackgroundUtilization = 0.9;
+
+inline uint32_t key_word(const char *entry) {
+    uint32_t word;
+    std::memcpy(&word, entry, sizeof(word));
+    return word;
+}
+
+inline void set_key_word(char *entry, uint32_t word) { std::memcpy(entry, &word, sizeof(word)); }
+
+inline std::size_t value_size(const char *entry) {
+    uint32_t size;
+    std::memcpy(&size, entry + sizeof(uint32_t), sizeof(size));
+    return size;
+}
+
+inline std::size_t entry_size(const char *entry) {
+    return kHeaderSize + (key_word(entry) & kKeyMask) + value_size(entry);
+}
+
+} // namespace
+
+// See LogStructuredLRU.h
+LogStructuredLRU::LogStructuredLRU(std::size_t max_size, std::size_t segment_size)
+    : _max_size(max_size),
+      _segment_size(segment_size > 0 ? segment_size : std::min(kDefaultSegmentSize, max_size / kMinSegments)),
+      _worker([this]() { return Clean(); }, std::chrono::milliseconds(1)), _head(0), _survivor(kNoSegment),
+      _cleaning(kNoSegment), _cleaning_offset(0), _seq(0), _count(0), _live_bytes(0), _evictions(0),
+      _cleaned_segments(0), _evicted_segments(0), _relocated_bytes(0) {
+    if (segment_size == 0 && _segment_size < kMinSegmentSize) {
+        throw std::runtime_error("log storage needs at least " + std::to_string(kMinSegments * kMinSegmentSize) +
+                                 " bytes");
+    }
+    std::size_t n_segments = _segment_size > kHeaderSize ? max_size / _segment_size : 0;
+    if (n_segments < kMinSegments || n_segments >= kNoSegment) {
+        throw std::runtime_error("parameters are set incorrectly");
+    }
+    _clean_target = kReserve + 1 + n_segments / 16;
+
+    // Segments are value initialized, memory is allocated once segment is taken
+    _segments.resize(n_segments);
+    for (std::size_t i = n_segments - 1; i > 0; i--) {
+        _free.push_back(i);
+    }
+    _segments[_head].seq = _seq++;
+    SegmentData(_head);
+
+    _slots.assign(kInitialSlots, Slot{0, kNoSegment, 0});
+}
+
+// See LogStructuredLRU.h
+LogStructuredLRU::~LogStructuredLRU() { Stop(); }
+
+// See LogStructuredLRU.h
+void LogStructuredLRU::Start() { _worker.Start(); }
+
+// See LogStructuredLRU.h
+void LogStructuredLRU::Stop() { _worker.Stop(); }
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::Put(const std::string &key, const std::string &value) {
+    return Put(key, HashKey(key.data(), key.size()), value);
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::Put(const std::string &key, uint64_t hash, const std::string &value) {
+    _counters.Add(Counters::kCmdSet);
+    if (kHeaderSize + key.size() + value.size() > _segment_size) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtx);
+    Write(key, hash, value);
+    return true;
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::PutIfAbsent(const std::string &key, const std::string &value) {
+    return PutIfAbsent(key, HashKey(key.data(), key.size()), value);
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) {
+    _counters.Add(Counters::kCmdSet);
+    if (kHeaderSize + key.size() + value.size() > _segment_size) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtx);
+    if (Find(key.data(), key.size(), hash) != nullptr) {
+        return false;
+    }
+    Write(key, hash, value);
+    return true;
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::Set(const std::string &key, const std::string &value) {
+    return Set(key, HashKey(key.data(), key.size()), value);
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::Set(const std::string &key, uint64_t hash, const std::string &value) {
+    _counters.Add(Counters::kCmdSet);
+    if (kHeaderSize + key.size() + value.size() > _segment_size) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_mtx);
+    if (Find(key.data(), key.size(), hash) == nullptr) {
+        return false;
+    }
+    Write(key, hash, value);
+    return true;
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::Delete(const std::string &key) {
+    return Delete(key, HashKey(key.data(), key.size()));
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::Delete(const std::string &key, uint64_t hash) {
+    std::lock_guard<std::mutex> lk(_mtx);
+    Slot *slot = Find(key.data(), key.size(), hash);
+    if (slot == nullptr) {
+        _counters.Add(Counters::kDeleteMisses);
+        return false;
+    }
+
+    _counters.Add(Counters::kDeleteHits);
+    Kill(*slot);
+    EraseSlot(slot);
+    return true;
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::Get(const std::string &key, std::string &value) {
+    return Get(key, HashKey(key.data(), key.size()), value);
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::Get(const std::string &key, uint64_t hash, std::string &value) {
+    std::lock_guard<std::mutex> lk(_mtx);
+    Slot *slot = Find(key.data(), key.size(), hash);
+    if (slot == nullptr) {
+        _counters.Add(Counters::kGetMisses);
+        return false;
+    }
+
+    _counters.Add(Counters::kGetHits);
+    char *entry = _segments[slot->segment].data.get() + slot->offset;
+    set_key_word(entry, key_word(entry) | kReferenced);
+    value.assign(entry + kHeaderSize + key.size(), value_size(entry));
+    return true;
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::Compute(const std::string &key, const Mutation &mutation) {
+    return Compute(key, HashKey(key.data(), key.size()), mutation);
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::Compute(const std::string &key, uint64_t hash, const Mutation &mutation) {
+    std::lock_guard<std::mutex> lk(_mtx);
+    Slot *slot = Find(key.data(), key.size(), hash);
+    auto current = MakeCurrent([this, slot, &key](Value &value) {
+        if (slot != nullptr) {
+            const char *entry = _segments[slot->segment].data.get() + slot->offset;
+            value.Append(entry + kHeaderSize + key.size(), value_size(entry));
+        }
+    });
+    Value value;
+    switch (mutation(slot != nullptr, current, value)) {
+    case Action::kStore:
+        _counters.Add(Counters::kCmdSet);
+        if (kHeaderSize + key.size() + value.size() > _segment_size) {
+            return false;
+        }
+        Write(key, hash, value.str());
+        return true;
+    case Action::kDelete:
+        if (slot == nullptr) {
+            _counters.Add(Counters::kDeleteMisses);
+            return false;
+        }
+        _counters.Add(Counters::kDeleteHits);
+        Kill(*slot);
+        EraseSlot(slot);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// See LogStructuredLRU.h
+void LogStructuredLRU::Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) {
+    if (!group.empty()) {
+        return;
+    }
+
+    StorageStats snapshot;
+    _counters.Collect(snapshot);
+
+    std::size_t in_use, live = 0;
+    uint64_t cleaned, evicted, relocated;
+    {
+        std::lock_guard<std::mutex> lk(_mtx);
+        snapshot.evictions = _evictions;
+        snapshot.curr_items = _count;
+        snapshot.bytes = _live_bytes;
+        snapshot.limit_maxbytes = _max_size;
+
+        in_use = _segments.size() - _free.size();
+        for (auto &segment : _segments) {
+            live += segment.live;
+        }
+        cleaned = _cleaned_segments;
+        evicted = _evicted_segments;
+        relocated = _relocated_bytes;
+    }
+
+    snapshot.Report("", stats);
+    stats.emplace_back("log_segment_size", std::to_string(_segment_size));
+    stats.emplace_back("log_segments", std::to_string(_segments.size()));
+    stats.emplace_back("log_segments_in_use", std::to_string(in_use));
+    stats.emplace_back("log_cleaned_segments", std::to_string(cleaned));
+    stats.emplace_back("log_evicted_segments", std::to_string(evicted));
+    stats.emplace_back("log_relocated_bytes", std::to_string(relocated));
+
+    // Percent of memory of the segments in use taken by live items, headers included
+    stats.emplace_back("log_utilization", std::to_string(live * 100 / (in_use * _segment_size)));
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::Clean() {
+    std::lock_guard<std::mutex> lk(_mtx);
+    if (_cleaning == kNoSegment) {
+        if (_free.size() >= _clean_target) {
+            return false;
+        }
+
+        uint32_t victim, oldest;
+        double utilization;
+        if (!PickVictims(victim, utilization, oldest) || utilization > kBackgroundUtilization) {
+            return false;
+        }
+        _cleaning = victim;
+        _cleaning_offset = 0;
+    }
+
+    // Segment is cleaned batch by batch, so that lock is released in between
+    if (Relocate(_cleaning, false, _cleaning_offset, kCleanBatch)) {
+        _cleaning = kNoSegment;
+        _cleaned_segments++;
+    }
+    return _cleaning != kNoSegment || _free.size() < _clean_target;
+}
+
+// See LogStructuredLRU.h
+LogStructuredLRU::Slot *LogStructuredLRU::Find(const char *key, std::size_t key_size, uint64_t hash) {
+    const std::size_t mask = _slots.size() - 1;
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+        Slot &slot = _slots[i];
+        if (slot.segment == kNoSegment) {
+            return nullptr;
+        }
+        if (slot.hash == hash) {
+            const char *entry = _segments[slot.segment].data.get() + slot.offset;
+            if ((key_word(entry) & kKeyMask) == key_size && std::memcmp(entry + kHeaderSize, key, key_size) == 0) {
+                return &slot;
+            }
+        }
+    }
+}
+
+// See LogStructuredLRU.h
+void LogStructuredLRU::InsertSlot(uint64_t hash, uint32_t segment, uint32_t offset) {
+    // Keep load factor below 75%, probe sequences stay short then
+    if ((_count + 1) * 4 > _slots.size() * 3) {
+        Grow();
+    }
+
+    const std::size_t mask = _slots.size() - 1;
+    std::size_t i = hash & mask;
+    while (_slots[i].segment != kNoSegment) {
+        i = (i + 1) & mask;
+    }
+    _slots[i] = Slot{hash, segment, offset};
+    _count++;
+}
+
+// See LogStructuredLRU.h
+void LogStructuredLRU::EraseSlot(Slot *slot) {
+    // Backward shift: slots of the same probe sequence move into the hole, so lookups never need tombstones
+    const std::size_t mask = _slots.size() - 1;
+    std::size_t hole = slot - _slots.data();
+    for (std::size_t i = (hole + 1) & mask; _slots[i].segment != kNoSegment; i = (i + 1) & mask) {
+        std::size_t home = _slots[i].hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            _slots[hole] = _slots[i];
+            hole = i;
+        }
+    }
+    _slots[hole].segment = kNoSegment;
+    _count--;
+}
+
+// See LogStructuredLRU.h
+void LogStructuredLRU::Grow() {
+    std::vector<Slot> slots(_slots.size() * 2, Slot{0, kNoSegment, 0});
+    const std::size_t mask = slots.size() - 1;
+    for (auto &slot : _slots) {
+        if (slot.segment != kNoSegment) {
+            std::size_t i = slot.hash & mask;
+            while (slots[i].segment != kNoSegment) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = slot;
+        }
+    }
+    _slots.swap(slots);
+}
+
+// See LogStructuredLRU.h
+void LogStructuredLRU::Write(const std::string &key, uint64_t hash, const std::string &value) {
+    const std::size_t size = kHeaderSize + key.size() + value.size();
+    if (_segments[_head].used + size > _segment_size) {
+        // Room is made before the index is looked at, cleaning moves items around
+        uint32_t next;
+        while (!TakeFree(next, false)) {
+            Reclaim();
+        }
+        _head = next;
+        _segments[_head].seq = _seq++;
+    }
+
+    Segment &head = _segments[_head];
+    char *entry = head.data.get() + head.used;
+    uint32_t header[] = {static_cast<uint32_t>(key.size()), static_cast<uint32_t>(value.size())};
+    std::memcpy(entry, header, kHeaderSize);
+    std::memcpy(entry + kHeaderSize, key.data(), key.size());
+    std::memcpy(entry + kHeaderSize + key.size(), value.data(), value.size());
+
+    const uint32_t offset = head.used;
+    head.used += size;
+    head.live += size;
+    _live_bytes += key.size() + value.size();
+
+    Slot *slot = Find(key.data(), key.size(), hash);
+    if (slot != nullptr) {
+        Kill(*slot);
+        slot->segment = _head;
+        slot->offset = offset;
+    } else {
+        InsertSlot(hash, _head, offset);
+    }
+}
+
+// See LogStructuredLRU.h
+void LogStructuredLRU::Kill(const Slot &slot) {
+    Segment &segment = _segments[slot.segment];
+    char *entry = segment.data.get() + slot.offset;
+    std::size_t size = entry_size(entry);
+    set_key_word(entry, key_word(entry) | kDead);
+    segment.live -= size;
+    _live_bytes -= size - kHeaderSize;
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::TakeFree(uint32_t &segment, bool reserved) {
+    if (_free.size() <= (reserved ? 0 : std::size_t(kReserve))) {
+        return false;
+    }
+    segment = _free.back();
+    _free.pop_back();
+
+    SegmentData(segment);
+    _segments[segment].used = 0;
+    _segments[segment].live = 0;
+    return true;
+}
+
+// See LogStructuredLRU.h
+void LogStructuredLRU::Reclaim() {
+    // Segment background cleaner is in the middle of is the cheapest one to free
+    if (_cleaning != kNoSegment) {
+        Relocate(_cleaning, false, _cleaning_offset, _segment_size);
+        _cleaning = kNoSegment;
+        _cleaned_segments++;
+        return;
+    }
+
+    std::size_t offset = 0;
+    uint32_t victim, oldest;
+    double utilization;
+    bool found = PickVictims(victim, utilization, oldest);
+    assert(found);
+    (void)found;
+
+    if (utilization <= kCleanUtilization) {
+        Relocate(victim, false, offset, _segment_size);
+        _cleaned_segments++;
+    } else {
+        Relocate(oldest, true, offset, _segment_size);
+        _evicted_segments++;
+    }
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::PickVictims(uint32_t &cleanable, double &utilization, uint32_t &oldest) const {
+    bool found = false;
+    double best = -1;
+    for (uint32_t i = 0; i < _segments.size(); i++) {
+        const Segment &segment = _segments[i];
+        if (i == _head || i == _survivor || i == _cleaning || segment.used == 0) {
+            continue;
+        }
+
+        // Cold segments are worth cleaning at higher utilization: their live items are unlikely to die soon
+        double u = double(segment.live) / _segment_size;
+        double score = (1 - u) * (_seq - segment.seq) / (1 + u);
+        if (score > best) {
+            best = score;
+            cleanable = i;
+            utilization = u;
+        }
+        if (!found || segment.seq < _segments[oldest].seq) {
+            oldest = i;
+        }
+        found = true;
+    }
+    return found;
+}
+
+// See LogStructuredLRU.h
+bool LogStructuredLRU::Relocate(uint32_t segment, bool evicting, std::size_t &offset, std::size_t limit) {
+    Segment &from = _segments[segment];
+    char *data = from.data.get();
+    const std::size_t end = std::min(from.used, offset + limit);
+    while (offset < end) {
+        char *entry = data + offset;
+        const uint32_t word = key_word(entry);
+        const std::size_t key_size = word & kKeyMask;
+        const std::size_t size = entry_size(entry);
+        offset += size;
+        if (word & kDead) {
+            continue;
+        }
+
+        Slot *slot = Find(entry + kHeaderSize, key_size, HashKey(entry + kHeaderSize, key_size));
+        assert(slot != nullptr && slot->segment == segment && slot->offset == offset - size);
+        from.live -= size;
+        if (evicting && !(word & kReferenced)) {
+            _live_bytes -= size - kHeaderSize;
+            _evictions++;
+            EraseSlot(slot);
+            continue;
+        }
+
+        // Second chance is given once, item has to be referenced again to get another one
+        if (evicting) {
+            set_key_word(entry, word & ~kReferenced);
+        }
+        slot->offset = Survive(entry, size);
+        slot->segment = _survivor;
+        _relocated_bytes += size;
+    }
+    if (offset < from.used) {
+        return false;
+    }
+
+    from.used = 0;
+    from.live = 0;
+    _free.push_back(segment);
+    return true;
+}
+
+// See LogStructuredLRU.h
+uint32_t LogStructuredLRU::Survive(const char *entry, std::size_t size) {
+    if (_survivor == kNoSegment || _segments[_survivor].used + size > _segment_size) {
+        // There is always a reserved segment: Put never takes it, and relocation of a single segment takes
+        // one at most, while freeing one
+        uint32_t next = kNoSegment;
+        bool taken = TakeFree(next, true);
+        assert(taken);
+        (void)taken;
+        _survivor = next;
+        _segments[_survivor].seq = _seq++;
+    }
+
+    Segment &survivor = _segments[_survivor];
+    const uint32_t offset = survivor.used;
+    std::memcpy(survivor.data.get() + offset, entry, size);
+    survivor.used += size;
+    survivor.live += size;
+    return offset;
+}
+
+// See LogStructuredLRU.h
+char *LogStructuredLRU::SegmentData(uint32_t segment) {
+    std::unique_ptr<char[]> &data = _segments[segment].data;
+    if (!data) {
+        data.reset(new char[_segment_size]);
+    }
+    return data.get();
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,195 @@
+#ifndef AFINA_STORAGE_LOG_STRUCTURED_LRU_H
+#define AFINA_STORAGE_LOG_STRUCTURED_LRU_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+
+#include "BackgroundWorker.h"
+#include "Counters.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Log structured storage
+ * Memory is split into fixed size segments and items are appended to the head segment by bumping its pointer,
+ * the same way RAMCloud keeps its log in memory, see "Log-structured Memory for DRAM-based Storage" by Rumble
+ * et al. Heap never sees an allocation per item, so churn of values of varied sizes can't fragment it: replaced
+ * and deleted items just leave dead bytes behind in their segments.
+ *
+ * Dead bytes are reclaimed by the cleaner that picks segments by cost-benefit (1 - u) * age / (1 + u), where u
+ * is the fraction of live bytes, copies their live items into the survivor segment and frees them as a whole.
+ * Background thread keeps a few segments free in advance, releasing the lock after every batch of the segment it
+ * cleans, Put cleans inline only if background one fell behind.
+ *
+ * Once every segment is in use and none is worth cleaning, the oldest segment is evicted as a whole. Get sets
+ * reference bit of the item, and referenced items of the evicted segment get a second chance: they are moved
+ * into the survivor segment instead, so order of eviction approximates LRU the same way CLOCK does.
+ *
+ * Index is an open addressing hash table of item locations, key bytes are kept in the log only. Item must fit
+ * into a single segment. Thread safe, all operations are serialized by the single mutex.
+ */
+class LogStructuredLRU : public Afina::Storage {
+private:
+    // Place of the item in the log
+    struct Slot {
+        uint64_t hash;
+        uint32_t segment;
+        uint32_t offset;
+    };
+
+    struct Segment {
+        // Allocated on the first use, kept allocated once segment is freed
+        std::unique_ptr<char[]> data;
+
+        // Bytes appended so far, and bytes of items that are still in the index
+        std::size_t used;
+        std::size_t live;
+
+        // Order in which segments were opened
+        uint64_t seq;
+    };
+
+public:
+    /**
+     * Zero segment size picks the default one, limit is split into at least kMinSegments segments. Default segment
+     * is at least 64KB, so that limit below kMinSegments such segments is rejected
+     */
+    LogStructuredLRU(std::size_t max_size = 1024, std::size_t segment_size = 0);
+    ~LogStructuredLRU();
+
+    // Starts the background cleaner
+    void Start() override;
+
+    // Stops the background cleaner
+    void Stop() override;
+
+    // Implements Afina::Storage interface, hashed variants take the hash computed by HashKey, see afina/KeyHash.h
+    bool Put(const std::string &key, const std::string &value) override;
+    bool Put(const std::string &key, uint64_t hash, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override;
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override;
+    bool Set(const std::string &key, uint64_t hash, const std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+    bool Delete(const std::string &key, uint64_t hash) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override;
+
+    // Implements Afina::Storage interface, mutation runs under the lock
+    bool Compute(const std::string &key, const Mutation &mutation) override;
+    bool Compute(const std::string &key, uint64_t hash, const Mutation &mutation) override;
+
+    // Implements Afina::Storage interface, also reports state of the log as log_* statistics
+    void Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) override;
+
+    /**
+     * Cleans the next batch of a segment if there are less free segments than background cleaner keeps, returns
+     * true if there is more work to do
+     */
+    bool Clean();
+
+    // Size of each segment
+    inline std::size_t segment_size() const { return _segment_size; }
+
+private:
+    LogStructuredLRU(const LogStructuredLRU &);            // = delete;
+    LogStructuredLRU &operator=(const LogStructuredLRU &); // = delete;
+
+    // Segments never handed out to Put, so that cleaner always has somewhere to move live items to
+    enum : std::size_t { kReserve = 1, kMinSegments = 4 };
+
+    // Index slot of the key, nullptr if key is absent
+    Slot *Find(const char *key, std::size_t key_size, uint64_t hash);
+
+    void InsertSlot(uint64_t hash, uint32_t segment, uint32_t offset);
+
+    void EraseSlot(Slot *slot);
+
+    // Rebuilds index with twice as much slots
+    void Grow();
+
+    // Writes the new item into the head segment and points index to it, drops the previous version if any
+    void Write(const std::string &key, uint64_t hash, const std::string &value);
+
+    // Marks item the slot points to as dead, slot itself is kept
+    void Kill(const Slot &slot);
+
+    // Takes segment from the free list, reserved ones only if allowed. Returns false if there is none
+    bool TakeFree(uint32_t &segment, bool reserved);
+
+    // Frees space until there are free segments besides the reserved ones
+    void Reclaim();
+
+    // Picks segment that is the most profitable to clean and the oldest one, returns false if no segment but
+    // the head and the survivor is in use
+    bool PickVictims(uint32_t &cleanable, double &utilization, uint32_t &oldest) const;
+
+    // Moves items of the segment starting at the offset into survivor segment, until limit bytes are passed, and
+    // advances the offset. Evicting drops items that are not referenced. Returns true once segment is freed
+    bool Relocate(uint32_t segment, bool evicting, std::size_t &offset, std::size_t limit);
+
+    // Copies item into survivor segment, returns its new offset
+    uint32_t Survive(const char *entry, std::size_t size);
+
+    // Memory of the segment, allocated on the first use
+    char *SegmentData(uint32_t segment);
+
+private:
+    const std::size_t _max_size;
+    const std::size_t _segment_size;
+
+    // Number of free segments background cleaner tries to keep
+    std::size_t _clean_target;
+
+    // Operation counters
+    Counters _counters;
+
+    // Cleans segments ahead of Put
+    BackgroundWorker _worker;
+
+    // Guards everything below
+    std::mutex _mtx;
+
+    std::vector<Segment> _segments;
+    std::vector<uint32_t> _free;
+
+    // Segment Put appends to, and segment cleaner moves live items to (kNoSegment if there is none yet)
+    uint32_t _head;
+    uint32_t _survivor;
+
+    // Segment background cleaner is in the middle of (kNoSegment if there is none) and where it stopped
+    uint32_t _cleaning;
+    std::size_t _cleaning_offset;
+    uint64_t _seq;
+
+    // Open addressing index, number of slots is the power of 2
+    std::vector<Slot> _slots;
+    std::size_t _count;
+
+    // Bytes of keys and values of live items
+    std::size_t _live_bytes;
+
+    uint64_t _evictions;
+    uint64_t _cleaned_segments;
+    uint64_t _evicted_segments;
+    uint64_t _relocated_bytes;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_LOG_STRUCTURED_LRU_H
@@ -0,0 +1,115 @@
+#include "MemoryGovernor.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// Reads the first word of the file, false if file is missing or empty
+bool ReadWord(const std::string &path, std::string &word) {
+    std::ifstream in(path);
+    return static_cast<bool>(in >> word);
+}
+
+// Reads the number of bytes, false if file is missing or there is no number, i.e. "max"
+bool ReadBytes(const std::string &path, uint64_t &bytes) {
+    std::string word;
+    if (!ReadWord(path, word)) {
+        return false;
+    }
+    char *end;
+    bytes = std::strtoull(word.c_str(), &end, 10);
+    return !word.empty() && *end == '\0';
+}
+
+// Reads avg10 of the "some" line: "some avg10=1.23 avg60=0.50 avg300=0.10 total=12345"
+bool ReadPressure(const std::string &path, double &pressure) {
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 5, "some ") != 0) {
+            continue;
+        }
+        std::size_t at = line.find("avg10=");
+        if (at == std::string::npos) {
+            return false;
+        }
+        pressure = std::strtod(line.c_str() + at + 6, nullptr);
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+// See MemoryGovernor.h
+MemoryGovernor::MemoryGovernor(const std::shared_ptr<Afina::Storage> &storage, const GovernorConfig &config)
+    : _storage(storage), _config(config), _scale(1), _calm(0), _since_shrink(config.shrink_cooldown),
+      _shrink_usage(0),
+      _worker(
+          [this]() -> bool {
+              // Signals are averaged by the kernel, nothing changes until the next period
+              Poll();
+              return false;
+          },
+          config.period) {}
+
+// See MemoryGovernor.h
+void MemoryGovernor::Read(const std::string &cgroup, Signals &signals) {
+    signals.has_usage = ReadBytes(cgroup + "/memory.current", signals.current) &&
+                        ReadBytes(cgroup + "/memory.max", signals.max) && signals.max > 0;
+    signals.has_pressure = ReadPressure(cgroup + "/memory.pressure", signals.pressure);
+}
+
+// See MemoryGovernor.h
+bool MemoryGovernor::Poll() {
+    Signals signals;
+    Read(_config.cgroup, signals);
+    if (!signals.has_usage && !signals.has_pressure) {
+        return false;
+    }
+
+    const double usage = signals.has_usage ? double(signals.current) / signals.max : 0;
+    const double pressure = signals.has_pressure ? signals.pressure : 0;
+    const double scale = _scale.load(std::memory_order_relaxed);
+    double target = scale;
+    _since_shrink++;
+    if (usage > _config.high_usage || pressure > _config.high_pressure) {
+        _calm = 0;
+        if (_since_shrink >= _config.shrink_cooldown || (signals.has_usage && usage < _shrink_usage)) {
+            target = std::max(_config.min_scale, scale * _config.shrink_factor);
+        }
+    } else if (usage < _config.low_usage && pressure < _config.low_pressure) {
+        if (++_calm >= _config.calm_polls) {
+            _calm = 0;
+            target = std::min(1.0, scale + _config.grow_step);
+        }
+    } else {
+        _calm = 0;
+    }
+
+    if (target == scale || !_storage->SetLimitScale(target)) {
+        return false;
+    }
+    _scale.store(target, std::memory_order_relaxed);
+    if (target < scale) {
+        _since_shrink = 0;
+        _shrink_usage = usage;
+#ifdef __GLIBC__
+        // Evicted items went back to malloc, usage drops only once it gives their pages back to the kernel
+        malloc_trim(0);
+#endif
+    }
+    return true;
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,129 @@
+#ifndef AFINA_STORAGE_MEMORY_GOVERNOR_H
+#define AFINA_STORAGE_MEMORY_GOVERNOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <afina/Storage.h>
+
+#include "BackgroundWorker.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Tuning of the memory governor
+ * Defaults suit the server running in its own cgroup
+ */
+struct GovernorConfig {
+    // Directory of the cgroup v2 server runs in
+    std::string cgroup = "/sys/fs/cgroup";
+
+    // How often signals are read
+    std::chrono::milliseconds period = std::chrono::milliseconds(1000);
+
+    // Storage shrinks once cgroup uses more than that fraction of its limit, or tasks of the cgroup stall on
+    // memory more than that percent of time (PSI "some avg10")
+    double high_usage = 0.9;
+    double high_pressure = 10;
+
+    // Once limit shrinks, it shrinks again only after that many polls, or sooner if usage dropped in between.
+    // Pressure is averaged over 10 seconds and freed memory takes a while to show up in the usage, so that
+    // signals right after the shrink don't tell whether it was enough
+    std::size_t shrink_cooldown = 10;
+
+    // Storage grows back only once both are below those for calm_polls polls in a row
+    double low_usage = 0.8;
+    double low_pressure = 1;
+    std::size_t calm_polls = 5;
+
+    // Limit is multiplied by shrink_factor on pressure, but never gets below min_scale of the initial one, and
+    // grows back by grow_step of the initial one
+    double shrink_factor = 0.75;
+    double grow_step = 0.05;
+    double min_scale = 0.1;
+};
+
+/**
+ * # Storage limit that follows memory pressure
+ * Fixed limit doesn't help once the container as a whole runs out of memory: kernel reclaims page cache, tasks
+ * stall, and then OOM killer picks the largest process, the cache. Governor polls cgroup v2 files of the
+ * server:
+ *
+ * - memory.current and memory.max, usage of the cgroup and its limit ("max" if there is none)
+ * - memory.pressure, share of time tasks were stalled waiting for memory
+ *
+ * and scales storage limit, see Afina::Storage::SetLimitScale. Storage evicts items above the new limit right
+ * away, and governor asks malloc to return free pages, so that memory is given back before the kernel has to
+ * take it.
+ *
+ * Limit shrinks multiplicatively as soon as either signal is high, and grows back additively only after both
+ * stay low for a while. Gap between high and low thresholds together with the slow growth keeps limit from
+ * oscillating around the point where pressure starts: freed memory is never taken back within a single poll.
+ * Missing files mean no signal, governor does nothing if there are none at all.
+ */
+class MemoryGovernor {
+public:
+    // Signals read from the cgroup directory
+    struct Signals {
+        bool has_usage = false;
+        uint64_t current = 0;
+        uint64_t max = 0;
+
+        bool has_pressure = false;
+        double pressure = 0;
+    };
+
+    MemoryGovernor(const std::shared_ptr<Afina::Storage> &storage, const GovernorConfig &config = GovernorConfig());
+    ~MemoryGovernor() { Stop(); }
+
+    /**
+     * Starts thread polling signals every period
+     */
+    void Start() { _worker.Start(); }
+
+    /**
+     * Stops polling, limit stays as it is
+     */
+    void Stop() { _worker.Stop(); }
+
+    /**
+     * Reads signals once and rescales storage if needed, returns true if limit changed
+     */
+    bool Poll();
+
+    /**
+     * Reads signals of the given cgroup directory, those that are missing are left unset
+     */
+    static void Read(const std::string &cgroup, Signals &signals);
+
+    // Current fraction of the initial storage limit
+    inline double scale() const { return _scale.load(std::memory_order_relaxed); }
+
+private:
+    MemoryGovernor(const MemoryGovernor &);            // = delete;
+    MemoryGovernor &operator=(const MemoryGovernor &); // = delete;
+
+    std::shared_ptr<Afina::Storage> _storage;
+    const GovernorConfig _config;
+
+    std::atomic<double> _scale;
+
+    // Polls in a row both signals were low
+    std::size_t _calm;
+
+    // Polls since the last shrink and usage it was made at, 0 if usage is unknown
+    std::size_t _since_shrink;
+    double _shrink_usage;
+
+    BackgroundWorker _worker;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_MEMORY_GOVERNOR_H
@@ -0,0 +1,147 @@
+#include "MissRatioCurve.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace Afina {
+namespace Backend {
+
+// See MissRatioCurve.h
+MissRatioCurve::MissRatioCurve(std::size_t max_size, double rate)
+    : _max_size(max_size), _tree(kMinTimes + 1, 0), _clock(0), _total(0), _gets(0) {
+    const uint64_t range = uint64_t(1) << kHashBits;
+    _threshold = rate >= 1 ? range : std::max<uint64_t>(1, uint64_t(rate * range));
+    _rate = double(_threshold) / range;
+    std::fill(_bins, _bins + kBins, 0);
+}
+
+// See MissRatioCurve.h
+void MissRatioCurve::Access(uint64_t hash, std::size_t size, bool get) {
+    auto it = _samples.find(hash);
+    if (it == _samples.end()) {
+        // First access misses at any size
+        _gets += get;
+        if (size > 0) {
+            Sample sample{0, 0};
+            Touch(sample, size);
+            _samples.emplace(hash, sample);
+        }
+    } else {
+        Sample &sample = it->second;
+        if (get) {
+            const std::size_t item_size = size > 0 ? size : sample.size;
+            double distance = (_total - Sum(sample.time)) / _rate + item_size;
+            std::size_t bin = distance * kBins / (4.0 * _max_size);
+            if (bin < kBins) {
+                _bins[bin]++;
+            }
+            _gets++;
+        }
+        Touch(sample, size > 0 ? size : sample.size);
+    }
+
+    if (_gets >= kWindow) {
+        for (auto &bin : _bins) {
+            bin /= 2;
+        }
+        _gets /= 2;
+    }
+}
+
+// See MissRatioCurve.h
+void MissRatioCurve::Erase(uint64_t hash) {
+    auto it = _samples.find(hash);
+    if (it == _samples.end()) {
+        return;
+    }
+    Add(it->second.time, -int64_t(it->second.size));
+    _total -= it->second.size;
+    _samples.erase(it);
+}
+
+// See MissRatioCurve.h
+void MissRatioCurve::Collect(StorageStats &stats) const {
+    uint64_t hits = 0;
+    for (std::size_t bin = 0; bin < kBins; bin++) {
+        hits += _bins[bin];
+        if (bin + 1 == kBins / 8) {
+            stats.mrc_hits_half += hits;
+        } else if (bin + 1 == kBins / 4) {
+            stats.mrc_hits_1x += hits;
+        } else if (bin + 1 == kBins / 2) {
+            stats.mrc_hits_2x += hits;
+        }
+    }
+    stats.mrc_hits_4x += hits;
+    stats.mrc_gets += _gets;
+}
+
+void MissRatioCurve::Touch(Sample &sample, std::size_t size) {
+    if (sample.time != 0) {
+        Add(sample.time, -int64_t(sample.size));
+        _total -= sample.size;
+    }
+    // Sample is out of the tree until it gets the next time, so that compaction neither forgets nor renumbers it
+    sample.time = 0;
+    if (_clock + 1 >= _tree.size()) {
+        Compact();
+    }
+
+    sample.time = ++_clock;
+    sample.size = size;
+    Add(sample.time, size);
+    _total += size;
+}
+
+void MissRatioCurve::Add(uint64_t time, int64_t delta) {
+    for (; time < _tree.size(); time += time & (~time + 1)) {
+        _tree[time] += delta;
+    }
+}
+
+int64_t MissRatioCurve::Sum(uint64_t time) const {
+    int64_t sum = 0;
+    for (; time > 0; time &= time - 1) {
+        sum += _tree[time];
+    }
+    return sum;
+}
+
+void MissRatioCurve::Compact() {
+    std::vector<std::pair<uint64_t, uint64_t>> order;
+    order.reserve(_samples.size());
+    for (auto &entry : _samples) {
+        if (entry.second.time != 0) {
+            order.emplace_back(entry.second.time, entry.first);
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    // Newest first: once bytes accessed after the sample don't fit into 4 storage sizes, it can't hit anymore
+    const double limit = 4.0 * _max_size * _rate;
+    double behind = 0;
+    std::size_t keep = order.size();
+    for (std::size_t i = order.size(); i > 0; i--) {
+        if (behind > limit) {
+            keep = order.size() - i;
+            break;
+        }
+        behind += _samples[order[i - 1].second].size;
+    }
+    for (std::size_t i = 0; i + keep < order.size(); i++) {
+        _samples.erase(order[i].second);
+    }
+
+    _tree.assign(std::max<std::size_t>(kMinTimes, 2 * keep) + 1, 0);
+    _clock = 0;
+    _total = 0;
+    for (std::size_t i = order.size() - keep; i < order.size(); i++) {
+        Sample &sample = _samples[order[i].second];
+        sample.time = ++_clock;
+        Add(sample.time, sample.size);
+        _total += sample.size;
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
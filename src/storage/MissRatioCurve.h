@@ -0,0 +1,104 @@
+#ifndef AFINA_STORAGE_MISS_RATIO_CURVE_H
+#define AFINA_STORAGE_MISS_RATIO_CURVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Counters.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Online miss ratio curve
+ * Estimates how many gets would hit if the storage had 0.5, 1, 2 or 4 times as much memory, the way SHARDS does:
+ * only keys whose hash falls below the threshold are tracked, that is a fixed fraction of keys (not of accesses),
+ * so that every access to a tracked key is seen and reuse distances among tracked keys are exact. Distance is
+ * the number of bytes of distinct items accessed since the previous access to the same key, scaled back by the
+ * sampling rate it estimates the same distance among all keys. LRU of the given size hits the get if item fits
+ * into that distance.
+ *
+ * Distances are counted by Fenwick tree over logical access time where every tracked item has its size at the
+ * time of its last access. Items too far behind to hit even at 4x are forgotten once the tree is rebuilt, so
+ * that memory depends on the storage size and the rate only. Histogram of distances is halved every kWindow
+ * sampled gets, so the curve follows the current workload.
+ *
+ * NOT thread safe, owner guards the curve along with its items.
+ */
+class MissRatioCurve {
+public:
+    // Histogram covers distances up to 4 sizes of the storage, sampled gets are aged out after the window
+    enum : std::size_t { kBins = 64, kWindow = 1 << 16, kMinTimes = 1024 };
+
+    /**
+     * Tracks the given fraction of keys for the storage of max_size bytes
+     */
+    MissRatioCurve(std::size_t max_size, double rate);
+    ~MissRatioCurve() {}
+
+    // True if key with the given hash is tracked
+    inline bool Sampled(uint64_t hash) const { return (hash >> (64 - kHashBits)) < _threshold; }
+
+    /**
+     * Access of the tracked key: get or write of the item of the given size. Get that misses passes 0, the last
+     * size seen is used then
+     */
+    void Access(uint64_t hash, std::size_t size, bool get);
+
+    /**
+     * Tracked key is removed from the storage, next access to it is the first one
+     */
+    void Erase(uint64_t hash);
+
+    /**
+     * Adds sampled gets and their hits at each size into stats
+     */
+    void Collect(StorageStats &stats) const;
+
+    // Number of keys tracked
+    inline std::size_t size() const { return _samples.size(); }
+
+private:
+    MissRatioCurve(const MissRatioCurve &);            // = delete;
+    MissRatioCurve &operator=(const MissRatioCurve &); // = delete;
+
+    // Hash bits compared against the threshold
+    enum : unsigned { kHashBits = 24 };
+
+    struct Sample {
+        uint64_t time;
+        std::size_t size;
+    };
+
+    // Puts the sample at the next time
+    void Touch(Sample &sample, std::size_t size);
+
+    // Fenwick tree of sizes by time
+    void Add(uint64_t time, int64_t delta);
+    int64_t Sum(uint64_t time) const;
+
+    // Renumbers times of the samples starting from 1, forgets ones too far behind
+    void Compact();
+
+    const std::size_t _max_size;
+    uint64_t _threshold;
+    double _rate;
+
+    std::unordered_map<uint64_t, Sample> _samples;
+    std::vector<int64_t> _tree;
+    uint64_t _clock;
+
+    // Size of all tracked items
+    int64_t _total;
+
+    // Sampled gets by distance, bin is 1/16 of storage size, and total number of sampled gets
+    uint64_t _bins[kBins];
+    uint64_t _gets;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_MISS_RATIO_CURVE_H
@@ -0,0 +1,178 @@
+#include "Namespaces.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// Statistics that add up across namespaces. Configuration (stripes, log_segment_size) and ratios
+// (log_utilization, mrc_hit_ratio_*) are numbers as well, but their sums mean nothing
+const char *const kAdditive[] = {
+    "cmd_get", "get_hits", "get_misses", "cmd_set", "delete_hits", "delete_misses", "filter_misses", "evictions",
+    "curr_items", "bytes", "limit_maxbytes", "dedup_values", "dedup_items", "dedup_saved_bytes", "mrc_gets",
+    "log_segments", "log_segments_in_use", "log_cleaned_segments", "log_evicted_segments", "log_relocated_bytes",
+};
+bool Additive(const std::string &name) {
+    for (const char *additive : kAdditive) {
+        if (std::strcmp(name.c_str(), additive) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+const char *const Namespaces::kDefault = "default";
+
+// See Namespaces.h
+Namespaces::Namespaces(const std::shared_ptr<Afina::Storage> &fallback) {
+    _namespaces.push_back(Namespace{kDefault, "", fallback});
+}
+
+// See Namespaces.h
+void Namespaces::Add(const std::string &name, const std::string &prefix,
+                     const std::shared_ptr<Afina::Storage> &storage) {
+    if (prefix.empty() || storage == nullptr) {
+        throw std::runtime_error("parameters are set incorrectly");
+    }
+    for (auto &ns : _namespaces) {
+        if (ns.name == name || ns.prefix == prefix) {
+            throw std::runtime_error("namespace " + name + " overlaps with " + ns.name);
+        }
+    }
+
+    auto it = _namespaces.begin();
+    while (it->prefix.size() >= prefix.size()) {
+        ++it;
+    }
+    _namespaces.insert(it, Namespace{name, prefix, storage});
+}
+
+// See Namespaces.h
+std::shared_ptr<Afina::Storage> Namespaces::Find(const std::string &name) const {
+    for (auto &ns : _namespaces) {
+        if (ns.name == name) {
+            return ns.storage;
+        }
+    }
+    return nullptr;
+}
+
+// See Namespaces.h
+void Namespaces::Start() {
+    for (auto &ns : _namespaces) {
+        ns.storage->Start();
+    }
+}
+
+// See Namespaces.h
+void Namespaces::Stop() {
+    for (auto &ns : _namespaces) {
+        ns.storage->Stop();
+    }
+}
+
+// See Namespaces.h
+bool Namespaces::DeletePrefix(const std::string &prefix, std::size_t &deleted) {
+    // Keys starting with the prefix are owned either by the namespace that owns the prefix itself, or by those
+    // whose prefixes are longer and start with it
+    const Namespace &owner = Owner(prefix);
+    bool result = true;
+    deleted = 0;
+    for (auto &ns : _namespaces) {
+        if (&ns != &owner && ns.prefix.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        std::size_t n = 0;
+        result = ns.storage->DeletePrefix(prefix, n) && result;
+        deleted += n;
+    }
+    return result;
+}
+
+// See Namespaces.h
+bool Namespaces::InvalidateTag(const std::string &tag) {
+    bool result = true;
+    for (auto &ns : _namespaces) {
+        result = ns.storage->InvalidateTag(tag) && result;
+    }
+    return result;
+}
+
+// See Namespaces.h
+bool Namespaces::FlushAll(uint32_t delay) {
+    bool result = true;
+    for (auto &ns : _namespaces) {
+        result = ns.storage->FlushAll(delay) && result;
+    }
+    return result;
+}
+
+// See Namespaces.h
+bool Namespaces::SetLimitScale(double scale) {
+    bool result = true;
+    for (auto &ns : _namespaces) {
+        result = ns.storage->SetLimitScale(scale) && result;
+    }
+    return result;
+}
+
+// See Namespaces.h
+void Namespaces::Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) {
+    std::vector<std::pair<std::string, std::string>> own;
+    if (group.empty()) {
+        // Only counters and sizes add up, the rest is left out of totals
+        std::vector<std::pair<std::string, uint64_t>> totals;
+        for (auto &ns : _namespaces) {
+            own.clear();
+            ns.storage->Stats("", own);
+            for (auto &stat : own) {
+                if (!Additive(stat.first)) {
+                    continue;
+                }
+
+                char *end;
+                errno = 0;
+                uint64_t value = std::strtoull(stat.second.c_str(), &end, 10);
+                if (stat.second.empty() || *end != '\0' || errno != 0) {
+                    continue;
+                }
+
+                std::size_t i = 0;
+                while (i < totals.size() && totals[i].first != stat.first) {
+                    i++;
+                }
+                if (i == totals.size()) {
+                    totals.emplace_back(stat.first, 0);
+                }
+                totals[i].second += value;
+            }
+        }
+        for (auto &total : totals) {
+            stats.emplace_back(total.first, std::to_string(total.second));
+        }
+        return;
+    }
+
+    const bool general = group == "namespaces";
+    for (auto &ns : _namespaces) {
+        const std::string prefix = "namespace:" + ns.name + ":";
+        if (general) {
+            stats.emplace_back(prefix + "prefix", ns.prefix);
+        }
+        own.clear();
+        ns.storage->Stats(general ? "" : group, own);
+        for (auto &stat : own) {
+            stats.emplace_back(prefix + stat.first, stat.second);
+        }
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,185 @@
+#ifndef AFINA_STORAGE_NAMESPACES_H
+#define AFINA_STORAGE_NAMESPACES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <afina/Storage.h>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Storage split into namespaces
+ * Each namespace owns keys starting with its prefix and keeps them in its own storage, with its own memory
+ * limit and its own eviction policy, so that churn of one namespace never evicts items of another one. Keys
+ * that match no prefix go to the default namespace. Keys are passed down as they are, prefix included, so that
+ * responses and invalidation by prefix stay the same.
+ *
+ * Key matching several prefixes belongs to the longest one. Routing compares the key with each prefix, that is
+ * cheap for the handful of namespaces single server is shared by.
+ *
+ * Operations not bound to the key (flush, tag invalidation, limit scale) are applied to every namespace.
+ * Statistics of the general group are totals of counters and sizes of all namespaces, settings and ratios don't
+ * add up and are left out. "namespaces" group gives general statistics of each one as
+ * namespace:<name>:<name of statistic>, and any other group is collected from each namespace the same way, so
+ * that usage could be charged per namespace.
+ */
+class Namespaces : public Afina::Storage {
+public:
+    // Name of the namespace of keys no prefix matches
+    static const char *const kDefault;
+
+    explicit Namespaces(const std::shared_ptr<Afina::Storage> &fallback);
+    ~Namespaces() {}
+
+    /**
+     * Adds namespace of keys starting with the given prefix. Must be called before storage is used, throws if
+     * name or prefix is taken already or prefix is empty
+     */
+    void Add(const std::string &name, const std::string &prefix, const std::shared_ptr<Afina::Storage> &storage);
+
+    /**
+     * Storage of the namespace with the given name, nullptr if there is none
+     */
+    std::shared_ptr<Afina::Storage> Find(const std::string &name) const;
+
+    // Number of namespaces, default one included
+    inline std::size_t size() const { return _namespaces.size(); }
+
+    // Starts storages of all namespaces
+    void Start() override;
+
+    // Stops storages of all namespaces
+    void Stop() override;
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value) override { return Route(key).Put(key, value); }
+    bool Put(const std::string &key, std::string &&value) override { return Route(key).Put(key, std::move(value)); }
+    bool Put(const std::string &key, uint64_t hash, const std::string &value) override {
+        return Route(key).Put(key, hash, value);
+    }
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value) override {
+        return Route(key).PutIfAbsent(key, value);
+    }
+    bool PutIfAbsent(const std::string &key, std::string &&value) override {
+        return Route(key).PutIfAbsent(key, std::move(value));
+    }
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) override {
+        return Route(key).PutIfAbsent(key, hash, value);
+    }
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value) override { return Route(key).Set(key, value); }
+    bool Set(const std::string &key, std::string &&value) override { return Route(key).Set(key, std::move(value)); }
+    bool Set(const std::string &key, uint64_t hash, const std::string &value) override {
+        return Route(key).Set(key, hash, value);
+    }
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override { return Route(key).Delete(key); }
+    bool Delete(const std::string &key, uint64_t hash) override { return Route(key).Delete(key, hash); }
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) override { return Route(key).Get(key, value); }
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override {
+        return Route(key).Get(key, hash, value);
+    }
+
+    // Implements Afina::Storage interface
+    bool PutValue(const std::string &key, Value value) override { return Route(key).PutValue(key, std::move(value)); }
+    bool PutValue(const std::string &key, uint64_t hash, Value value) override {
+        return Route(key).PutValue(key, hash, std::move(value));
+    }
+
+    // Implements Afina::Storage interface
+    bool GetValue(const std::string &key, Value &value) override { return Route(key).GetValue(key, value); }
+    bool GetValue(const std::string &key, uint64_t hash, Value &value) override {
+        return Route(key).GetValue(key, hash, value);
+    }
+
+    // Implements Afina::Storage interface
+    bool GetItem(const std::string &key, Value &out) override { return Route(key).GetItem(key, out); }
+    bool GetItem(const std::string &key, uint64_t hash, Value &out) override {
+        return Route(key).GetItem(key, hash, out);
+    }
+
+    // Implements Afina::Storage interface
+    bool Compute(const std::string &key, const Mutation &mutation) override {
+        return Route(key).Compute(key, mutation);
+    }
+    bool Compute(const std::string &key, uint64_t hash, const Mutation &mutation) override {
+        return Route(key).Compute(key, hash, mutation);
+    }
+
+    // Implements Afina::Storage interface
+    bool Append(const std::string &key, Value data) override { return Route(key).Append(key, std::move(data)); }
+    bool Append(const std::string &key, uint64_t hash, Value data) override {
+        return Route(key).Append(key, hash, std::move(data));
+    }
+
+    // Implements Afina::Storage interface
+    bool Prepend(const std::string &key, Value data) override { return Route(key).Prepend(key, std::move(data)); }
+    bool Prepend(const std::string &key, uint64_t hash, Value data) override {
+        return Route(key).Prepend(key, hash, std::move(data));
+    }
+
+    // Implements Afina::Storage interface
+    bool PutTagged(const std::string &key, const std::string &value, const std::string &tag) override {
+        return Route(key).PutTagged(key, value, tag);
+    }
+    bool PutTagged(const std::string &key, uint64_t hash, const std::string &value, const std::string &tag) override {
+        return Route(key).PutTagged(key, hash, value, tag);
+    }
+
+    // Walks namespaces whose keys could start with the prefix, fails if any of them doesn't support that
+    bool DeletePrefix(const std::string &prefix, std::size_t &deleted) override;
+
+    // Implements Afina::Storage interface, tag is invalidated in every namespace
+    bool InvalidateTag(const std::string &tag) override;
+
+    // Implements Afina::Storage interface, every namespace is flushed
+    bool FlushAll(uint32_t delay) override;
+
+    // Implements Afina::Storage interface, limit of every namespace is scaled, so that their shares stay the same
+    bool SetLimitScale(double scale) override;
+
+    // Implements Afina::Storage interface
+    void Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) override;
+
+private:
+    Namespaces(const Namespaces &);            // = delete;
+    Namespaces &operator=(const Namespaces &); // = delete;
+
+    struct Namespace {
+        std::string name;
+        std::string prefix;
+        std::shared_ptr<Afina::Storage> storage;
+    };
+
+    // Namespace that owns the key
+    inline const Namespace &Owner(const std::string &key) const {
+        for (std::size_t i = 0; i + 1 < _namespaces.size(); i++) {
+            if (key.compare(0, _namespaces[i].prefix.size(), _namespaces[i].prefix) == 0) {
+                return _namespaces[i];
+            }
+        }
+        return _namespaces.back();
+    }
+
+    inline Afina::Storage &Route(const std::string &key) { return *Owner(key).storage; }
+
+    // Longer prefixes go first, default namespace with the empty one is always the last
+    std::vector<Namespace> _namespaces;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_NAMESPACES_H
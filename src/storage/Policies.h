@@ -0,0 +1,189 @@
+#ifndef AFINA_STORAGE_POLICIES_H
+#define AFINA_STORAGE_POLICIES_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+#include "ArtMap.h"
+#include "CuckooFilter.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Policies of the LRU template
+ * Storages are instantiations of BasicLRU/ThreadSafeLRU, each one resolved at compile time, so that the request
+ * path has no virtual calls but the single one through Afina::Storage done by the network layer:
+ *
+ * - Index: map type from KeyRef to node, OrderedIndex, HashIndex or ArtIndex
+ * - Accounting: Counters or NullCounters, see Counters.h
+ * - Lock: std::mutex or SpinLock, either of them could be wrapped into CountingLock. Storage owned by the single
+ *   thread is BasicLRU itself, with no lock at all
+ */
+
+// Index doesn't own keys, it points to the key bytes of the node. Hash is the one HashKey gives, 0 if it isn't
+// known, hash index computes it then
+struct KeyRef {
+    template <typename S> KeyRef(const S &s, uint64_t hash = 0) : data(s.data()), size(s.size()), hash(hash) {}
+
+    const char *data;
+    std::size_t size;
+    uint64_t hash;
+};
+
+// Same order as std::less<std::string> gives
+struct KeyLess {
+    bool operator()(const KeyRef &a, const KeyRef &b) const {
+        int cmp = std::memcmp(a.data, b.data, std::min(a.size, b.size));
+        return cmp < 0 || (cmp == 0 && a.size < b.size);
+    }
+};
+
+struct KeyHash {
+    std::size_t operator()(const KeyRef &key) const {
+        return key.hash != 0 ? key.hash : CuckooFilter::Hash(key.data, key.size);
+    }
+};
+
+struct KeyEqual {
+    bool operator()(const KeyRef &a, const KeyRef &b) const {
+        return a.size == b.size && std::memcmp(a.data, b.data, a.size) == 0;
+    }
+};
+
+inline bool HasPrefix(const KeyRef &key, const KeyRef &prefix) {
+    return key.size >= prefix.size && std::memcmp(key.data, prefix.data, prefix.size) == 0;
+}
+
+/**
+ * Each index has ForEachPrefix(map, prefix, fn) that calls fn for every entry whose key starts with prefix.
+ * Callback must not modify the map
+ */
+
+/**
+ * Red-black tree: lookup costs O(log n) key comparisons, but memory is allocated per entry only
+ */
+struct OrderedIndex {
+    template <typename T, typename Alloc> using map = std::map<KeyRef, T, KeyLess, Alloc>;
+
+    // Keys sharing the prefix are adjacent, walk starts from the first one
+    template <typename Map, typename F> static void ForEachPrefix(Map &map, const KeyRef &prefix, F fn) {
+        for (auto it = map.lower_bound(prefix); it != map.end() && HasPrefix(it->first, prefix); ++it) {
+            fn(*it);
+        }
+    }
+};
+
+/**
+ * Hash table: lookup costs single hash and usually single comparison, bucket array is reallocated as it grows
+ */
+struct HashIndex {
+    template <typename T, typename Alloc> using map = std::unordered_map<KeyRef, T, KeyHash, KeyEqual, Alloc>;
+
+    // Hashing scatters keys sharing the prefix, so it costs a full scan
+    template <typename Map, typename F> static void ForEachPrefix(Map &map, const KeyRef &prefix, F fn) {
+        for (auto &entry : map) {
+            if (HasPrefix(entry.first, prefix)) {
+                fn(entry);
+            }
+        }
+    }
+};
+
+/**
+ * Adaptive radix tree: ordered as the tree is, but lookup costs one step per key byte outside of shared prefixes,
+ * and entries sharing prefixes share inner nodes
+ */
+struct ArtIndex {
+    template <typename T, typename Alloc> using map = ArtMap<KeyRef, T, Alloc>;
+
+    // Walks only the subtree under the prefix
+    template <typename Map, typename F> static void ForEachPrefix(Map &map, const KeyRef &prefix, F fn) {
+        map.ForEachPrefix(prefix, fn);
+    }
+};
+
+/**
+ * # Test and set spin lock
+ * Critical sections of the LRU are a few hundred nanoseconds long, that is less than mutex spends putting waiter
+ * to sleep and waking it up. Waiter yields after a while, so that lock holder preempted on the same core could
+ * make progress
+ */
+class SpinLock {
+public:
+    SpinLock() { _flag.clear(); }
+
+    inline void lock() {
+        for (int spins = 0; _flag.test_and_set(std::memory_order_acquire); spins++) {
+            if (spins >= kSpins) {
+                std::this_thread::yield();
+                spins = 0;
+            }
+        }
+    }
+
+    inline bool try_lock() { return !_flag.test_and_set(std::memory_order_acquire); }
+
+    inline void unlock() { _flag.clear(std::memory_order_release); }
+
+private:
+    SpinLock(const SpinLock &);            // = delete;
+    SpinLock &operator=(const SpinLock &); // = delete;
+
+    static const int kSpins = 128;
+
+    std::atomic_flag _flag;
+};
+
+/**
+ * # Lock that counts how often it was found busy
+ * Waiter tries the lock first and counts the miss before blocking. Counters are written by the lock holder only,
+ * so that costs no atomic read-modify-write, and could be read by anyone, i.e. by the thread deciding whether
+ * storage needs more locks
+ */
+template <typename Mutex> class CountingLock {
+public:
+    CountingLock() : _acquired(0), _contended(0) {}
+
+    inline void lock() {
+        if (!_mtx.try_lock()) {
+            _mtx.lock();
+            _contended.store(_contended.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        _acquired.store(_acquired.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    inline bool try_lock() {
+        if (!_mtx.try_lock()) {
+            return false;
+        }
+        _acquired.store(_acquired.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    inline void unlock() { _mtx.unlock(); }
+
+    // Number of times lock was taken
+    inline uint64_t acquired() const { return _acquired.load(std::memory_order_relaxed); }
+
+    // Number of times lock was taken after waiting for it
+    inline uint64_t contended() const { return _contended.load(std::memory_order_relaxed); }
+
+private:
+    CountingLock(const CountingLock &);            // = delete;
+    CountingLock &operator=(const CountingLock &); // = delete;
+
+    Mutex _mtx;
+    std::atomic<uint64_t> _acquired;
+    std::atomic<uint64_t> _contended;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_POLICIES_H
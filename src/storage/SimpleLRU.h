@@ -1,13 +1,25 @@
 #ifndef AFINA_STORAGE_SIMPLE_LRU_H
 #define AFINA_STORAGE_SIMPLE_LRU_H
 
-#include <map>
+#include <cassert>
+#include <cstddef>
+#include <functional>
 #include <memory>
-#include <mutex>
 #include <string>
+#include <vector>
 
+#include <afina/KeyHash.h>
 #include <afina/Storage.h>
 
+#include "Arena.h"
+#include "Counters.h"
+#include "CuckooFilter.h"
+#include "HeavyHitters.h"
+#include "MissRatioCurve.h"
+#include "Policies.h"
+#include "TagRegistry.h"
+#include "ValueTable.h"
+
 namespace Afina {
 namespace Backend {
 
@@ -15,22 +27,60 @@ namespace Backend {
  * # Map based implementation
  * That is NOT thread safe implementaiton!!
  */
-class SimpleLRU : public Afina::Storage {
+template <typename Index = OrderedIndex, typename Accounting = Counters> class BasicLRU : public Afina::Storage {
 private:
+    using arena_string = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+    // Space in front of each node to keep arena pointer, keeps node aligned
+    static const std::size_t kNodeHeader = alignof(std::max_align_t);
+
     // LRU cache node
     using lru_node = struct lru_node {
-        const std::string key;
-        std::string value;
+        const arena_string key;
+
+        // Hash of the key, see afina/KeyHash.h: the one caller passed to the hashed operation or computed once on
+        // insert, so that filter, hash index and miss ratio curve never hash the key again
+        const uint64_t hash;
+
+        // Small value in the response form, "VALUE <key> 0 <bytes>\r\n<data>\r\n", so that GetItem copies it out as a
+        // single span. Empty if value is longer than Value::kChunkSize and is kept as chunks
+        arena_string wire;
+        uint32_t data_offset;
         lru_node* prev;
         std::unique_ptr<lru_node> next;
+
+        // Large value, wire field is empty then
+        std::unique_ptr<Value> chunks;
+
+        // Entry of the value table chunks are shared with, nullptr if item owns its value
+        ValueTable::Entry *shared;
+
+        // Tag of the item, id is 0 if item has none. Item whose tag was invalidated since is treated as absent and
+        // removed by the lookup, see TagRegistry.h
+        ItemTag tag;
+
+        // Node remembers arena it was allocated from, so that unique_ptr could free it
+        static void *operator new(std::size_t size, Arena *arena);
+        static void operator delete(void *ptr, Arena *arena);
+        static void operator delete(void *ptr, std::size_t size);
     };
 
-    using lru_map =
-        std::map<std::reference_wrapper<const std::string>, std::reference_wrapper<lru_node>, std::less<std::string>>;
+    // Index refers to the bytes of lru_node#key
+    using lru_map = typename Index::template map<
+        std::reference_wrapper<lru_node>, ArenaAllocator<std::pair<const KeyRef, std::reference_wrapper<lru_node>>>>;
+
 public:
-    SimpleLRU(size_t max_size = 1024) : _max_size(max_size), _current_size(0) {}
+    BasicLRU(size_t max_size = 1024) : BasicLRU(max_size, ArenaConfig()) {}
 
-    ~SimpleLRU() {
+    // With arena enabled nodes, index entries and small keys and values are allocated from it. Only key and value
+    // bytes are counted in the cache size
+    BasicLRU(size_t max_size, const ArenaConfig &arena)
+        : _max_size(max_size), _current_size(0),
+          _arena(arena.enabled ? new Arena(arena.size > 0 ? arena.size : 2 * max_size, arena) : nullptr),
+          _lru_index(typename lru_map::allocator_type(_arena.get())), _sweep(nullptr), _filter(nullptr),
+          _tags(new TagRegistry()), _evictions(0) {}
+
+    ~BasicLRU() {
         _lru_index.clear();
 
         // To avoid stack overflow, we do reset() in a loop,
@@ -44,28 +94,231 @@ public:
     }
 
     // Implements Afina::Storage interface
+    void Start() override;
+
+    // Implements Afina::Storage interface. Hashed variants take hash 0 as unknown one and compute it then
     bool Put(const std::string &key, const std::string &value) override;
+    bool Put(const std::string &key, uint64_t hash, const std::string &value) override;
 
     // Implements Afina::Storage interface
     bool PutIfAbsent(const std::string &key, const std::string &value) override;
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) override;
 
     // Implements Afina::Storage interface
     bool Set(const std::string &key, const std::string &value) override;
+    bool Set(const std::string &key, uint64_t hash, const std::string &value) override;
 
     // Implements Afina::Storage interface
     bool Delete(const std::string &key) override;
+    bool Delete(const std::string &key, uint64_t hash) override;
 
     // Implements Afina::Storage interface
     bool Get(const std::string &key, std::string &value) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override;
+
+    // Implements Afina::Storage interface
+    bool PutValue(const std::string &key, Value value) override;
+    bool PutValue(const std::string &key, uint64_t hash, Value value) override;
+
+    // Implements Afina::Storage interface
+    bool GetValue(const std::string &key, Value &value) override;
+    bool GetValue(const std::string &key, uint64_t hash, Value &value) override;
+
+    // Implements Afina::Storage interface, small value is copied as it is kept
+    bool GetItem(const std::string &key, Value &out) override;
+    bool GetItem(const std::string &key, uint64_t hash, Value &out) override;
+
+    // Implements Afina::Storage interface, item is looked up once
+    bool Compute(const std::string &key, const Mutation &mutation) override;
+    bool Compute(const std::string &key, uint64_t hash, const Mutation &mutation) override;
+
+    // Implements Afina::Storage interface, small value grows in place and large one gets bytes into its last
+    // chunk, so that cost doesn't depend on the size of the value
+    bool Append(const std::string &key, Value data) override;
+    bool Append(const std::string &key, uint64_t hash, Value data) override;
+
+    // Implements Afina::Storage interface, large value gets bytes into its first chunk or the new one
+    bool Prepend(const std::string &key, Value data) override;
+    bool Prepend(const std::string &key, uint64_t hash, Value data) override;
+
+    // Implements Afina::Storage interface
+    bool DeletePrefix(const std::string &prefix, std::size_t &deleted) override;
+
+    // Implements Afina::Storage interface
+    bool PutTagged(const std::string &key, const std::string &value, const std::string &tag) override;
+    bool PutTagged(const std::string &key, uint64_t hash, const std::string &value, const std::string &tag) override;
+
+    // Implements Afina::Storage interface, tag registry is thread safe on its own, so that could be called
+    // without any lock
+    bool InvalidateTag(const std::string &tag) override;
+
+    // Implements Afina::Storage interface, only bumps the counter of flushes, so that could be called without any
+    // lock. Flushed items are removed by access, by eviction, they are the oldest ones, or by DropStale
+    bool FlushAll(uint32_t delay) override;
+
+    // Implements Afina::Storage interface
+    void Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) override;
+
+    /**
+     * Adds statistics of this cache into stats
+     */
+    virtual void Snapshot(StorageStats &stats);
+
+    /**
+     * Evicts the oldest items until size drops to target_size, but no more than max_items at once.
+     * Returns number of evicted items
+     */
+    std::size_t Evict(std::size_t target_size, std::size_t max_items);
+
+    // Current number of bytes in this cache
+    inline std::size_t size() const { return _current_size; }
+
+    // Number of items in this cache
+    inline std::size_t count() const { return _lru_index.size(); }
+
+    /**
+     * Inserts item moved from other cache if key is absent, that isn't counted as operation. The oldest item is
+     * inserted only if it fits without eviction of anything else, the freshest one evicts as Put does. Tag is the
+     * one Extract gave, nullptr means item is stored right now without tag. Hash 0 means it is unknown
+     */
+    bool Adopt(const std::string &key, const Value &value, bool as_oldest, const ItemTag *tag = nullptr,
+               uint64_t hash = 0);
+
+    /**
+     * Removes item to be moved into other cache, that isn't counted as operation
+     */
+    bool Extract(const std::string &key, Value &value, ItemTag *tag = nullptr, uint64_t hash = 0);
+
+    /**
+     * Replaces registry of tags, so that caches sharing it could be invalidated at once. Must be called before
+     * the cache is used
+     */
+    inline void SetTagRegistry(const std::shared_ptr<TagRegistry> &tags) { _tags = tags; }
+
+    /**
+     * Stores values of at least threshold bytes once per cache, however many items hold them. Shared bytes are
+     * counted in the cache size once, so evicting one of the items sharing them frees only its key. Must be
+     * called before the cache is used
+     */
+    inline void EnableDedup(std::size_t threshold) { _values.reset(new ValueTable(threshold)); }
+
+    /**
+     * Estimates hit ratio of caches of other sizes by the given fraction of keys, see MissRatioCurve.h. Must be
+     * called before the cache is used
+     */
+    inline void EnableMissRatioCurve(double rate) { _mrc.reset(new MissRatioCurve(_max_size, rate)); }
+
+    /**
+     * Counts keys of gets and sets in the given summary, so that caches sharing it could be reported at once by
+     * "stats hotkeys". Must be called before the cache is used
+     */
+    inline void SetHeavyHitters(const std::shared_ptr<HeavyHitters> &hot) { _hot = hot; }
+
+    /**
+     * Looks through the next max_items items for flushed or invalidated ones and removes them. Live items don't
+     * stop the pass, i.e. the ones resize moved in as the oldest, it goes on from where the previous call stopped
+     * until the fresh end of the list. Returns true if the pass isn't over yet, the next call after it is over
+     * starts a new one
+     *
+     * @param max_items number of items to look through
+     * @param dropped output parameter to put number of removed items to
+     */
+    bool DropStale(std::size_t max_items, std::size_t &dropped);
+
+    // Number of flushes of the storage so far, see TagRegistry.h
+    inline uint32_t flushes() const { return _tags->Flushes(); }
+
+    /**
+     * Copies key of the most recently used item, returns false if cache is empty
+     */
+    bool FreshestKey(std::string &key) const;
+
+protected:
+    inline std::size_t max_size() const { return _max_size; }
+
+    // Changes the limit, items above it are evicted by the next put or by the caller
+    inline void SetMaxSize(std::size_t max_size) { _max_size = max_size; }
+
+    // Operation counters, could be updated by wrappers for operations that never reach the cache
+    inline Accounting &counters() { return _counters; }
+
+    /**
+     * Keeps filter in sync with the set of keys from now on, keys present already are inserted into it.
+     * nullptr detaches current filter. Cache doesn't own the filter
+     */
+    void AttachFilter(CuckooFilter *filter);
 
 private:
+    // Node of the key, stale tagged node is removed and isn't returned. Hash 0 means it is unknown
+    lru_node *Find(const std::string &key, uint64_t hash);
+
     void FreeSpace(std::size_t put_size);
 
+    void EvictHead();
+
+    void RemoveNode(lru_node &node);
+
+    // Value is forwarded down to AssignValue, so that moved in value is moved into the node
+    template <typename V> bool DoPut(const std::string &key, uint64_t hash, V &&value);
+
+    template <typename V> bool DoGet(const std::string &key, uint64_t hash, V &value);
+
+    template <typename V>
+    lru_node *NewNode(const std::string &key, uint64_t hash, V &&value, ValueTable::Entry *shared);
+
     void MoveNodeToTail(lru_node& node);
+
+    // Feeds access to the item into the miss ratio curve, if any. Get that misses passes item size 0
+    inline void Sample(const char *key, std::size_t key_size, uint64_t hash, std::size_t item_size, bool get) {
+        if (_mrc) {
+            SampleAccess(hash != 0 ? hash : HashKey(key, key_size), item_size, get);
+        }
+    }
+
+    void SampleAccess(uint64_t hash, std::size_t item_size, bool get);
+
+    inline void Track(const std::string &key, bool get) {
+        if (_hot) {
+            _hot->Add(key, get);
+        }
+    }
     
-    void InsertNode(const std::string &key, const std::string &value);
+    template <typename V> void InsertNode(const std::string &key, uint64_t hash, V &&value);
+
+    template <typename V> void UpdateNode(lru_node& node, V &&new_value);
 
-    void UpdateNode(lru_node& node, const std::string &new_value);
+    // Takes reference to the shared copy of the value if it is subject to dedup, nullptr otherwise. Charge is
+    // the number of bytes value adds to the cache size
+    template <typename V> ValueTable::Entry *Share(const V &value, std::size_t &charge);
+
+    // Drops reference to the value of the node, returns number of bytes freed. Node value is left for the
+    // caller to replace or to free along with the node
+    std::size_t DropValue(lru_node &node);
+
+    // Keeps shared value as chunks of the table entry, small value in place and large one as chunks
+    void AssignValue(lru_node &node, const std::string &value, ValueTable::Entry *shared);
+    void AssignValue(lru_node &node, const Value &value, ValueTable::Entry *shared);
+    void AssignValue(lru_node &node, Value &&value, ValueTable::Entry *shared);
+
+    // Adds data to the value of the item in place
+    bool Concat(const std::string &key, uint64_t hash, const Value &data, bool prepend);
+
+    // Value of the node with data added at its end or beginning, chunks are shared
+    static Value Joined(const lru_node &node, const Value &data, bool prepend);
+
+    // Lays out response header in front of the small value of the given size, value bytes go next
+    static void BeginWire(lru_node &node, std::size_t size);
+
+    // Rewrites size in the header of the small value, bytes after the header move only if number of digits changes
+    static void SetWireSize(lru_node &node, std::size_t size);
+
+    static void CopyValue(const lru_node &node, std::string &out);
+    static void CopyValue(const lru_node &node, Value &out);
+
+    static inline std::size_t ValueSize(const lru_node &node) {
+        // Header is followed by the value and CRLF
+        return node.chunks ? node.chunks->size() : node.wire.size() - node.data_offset - 2;
+    }
 
 private:
     // Maximum number of bytes could be stored in this cache.
@@ -75,6 +328,10 @@ private:
     // Current number of bytes in this cache.
     std::size_t _current_size;
 
+    // Memory for nodes and index, nullptr if items are allocated from the heap. Must outlive
+    // both of them
+    std::unique_ptr<Arena> _arena;
+
     // Main storage of lru_nodes, elements in this list ordered descending by "freshness": in the head
     // element that wasn't used for longest time.
     //
@@ -83,9 +340,37 @@ private:
 
     // Index of nodes from list above, allows fast random access to elements by lru_node#key
     lru_map _lru_index;
+
+    // Node DropStale goes on from, nullptr if there is no pass in progress. Nodes leaving their place pass it on
+    lru_node *_sweep;
+
+    // Membership filter updated on every insert and removal, if any
+    CuckooFilter *_filter;
+
+    // Generations of item tags, could be shared with other caches
+    std::shared_ptr<TagRegistry> _tags;
+
+    // Shared values, nullptr if dedup is disabled. Nodes only refer to entries, so it could go first
+    std::unique_ptr<ValueTable> _values;
+
+    // Reuse distances of the sampled keys, nullptr if curve isn't estimated
+    std::unique_ptr<MissRatioCurve> _mrc;
+
+    // Most accessed keys, could be shared with other caches. nullptr if they are not tracked
+    std::shared_ptr<HeavyHitters> _hot;
+
+    // Per thread counters, so that wrappers could report them without anything shared but the lock they hold
+    Accounting _counters;
+    uint64_t _evictions;
 };
 
+// Index and accounting are policies, see Policies.h. Template bodies live in SimpleLRU.inl, so that calls made on
+// the concrete type could be inlined
+using SimpleLRU = BasicLRU<OrderedIndex, Counters>;
+
 } // namespace Backend
 } // namespace Afina
 
+#include "SimpleLRU.inl"
+
 #endif // AFINA_STORAGE_SIMPLE_LRU_H
@@ -0,0 +1,862 @@
+// Template bodies of BasicLRU, included by SimpleLRU.h so that calls of the concrete storage type could be inlined
+
+namespace Afina {
+namespace Backend {
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+void *BasicLRU<Index, Accounting>::lru_node::operator new(std::size_t size, Arena *arena) {
+    char *block = ArenaAllocator<char>(arena).allocate(size + kNodeHeader);
+    *reinterpret_cast<Arena **>(block) = arena;
+    return block + kNodeHeader;
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::lru_node::operator delete(void *ptr, Arena *arena) {
+    char *block = static_cast<char *>(ptr) - kNodeHeader;
+    ArenaAllocator<char>(arena).deallocate(block, sizeof(lru_node) + kNodeHeader);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::lru_node::operator delete(void *ptr, std::size_t size) {
+    char *block = static_cast<char *>(ptr) - kNodeHeader;
+    ArenaAllocator<char>(*reinterpret_cast<Arena **>(block)).deallocate(block, size + kNodeHeader);
+}
+
+// See MapBasedGlobalLockImpl.h
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::Start() {
+    if (_arena) {
+        _arena->Start();
+    }
+}
+
+// See MapBasedGlobalLockImpl.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Put(const std::string &key, const std::string &value) {
+    return DoPut(key, 0, value);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Put(const std::string &key, uint64_t hash, const std::string &value) {
+    return DoPut(key, hash, value);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::PutValue(const std::string &key, Value value) {
+    return DoPut(key, 0, std::move(value));
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::PutValue(const std::string &key, uint64_t hash, Value value) {
+    return DoPut(key, hash, std::move(value));
+}
+
+// See MapBasedGlobalLockImpl.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::PutIfAbsent(const std::string &key, const std::string &value) {
+    return PutIfAbsent(key, 0, value);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) {
+    _counters.Add(Counters::kCmdSet);
+    Track(key, false);
+    std::size_t put_size = key.size() + value.size();
+    if (put_size > _max_size) {
+        return false;
+    }
+    if (Find(key, hash) != nullptr) {
+        return false;
+    }
+    InsertNode(key, hash, value);
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Set(const std::string &key, const std::string &value) { return Set(key, 0, value); }
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Set(const std::string &key, uint64_t hash, const std::string &value) {
+    _counters.Add(Counters::kCmdSet);
+    Track(key, false);
+    std::size_t put_size = key.size() + value.size();
+    if (put_size > _max_size) {
+        return false;
+    }
+    lru_node *node = Find(key, hash);
+    if (node == nullptr) {
+        return false;
+    }
+    else {
+        UpdateNode(*node, value);
+        return true;
+    }
+ }
+
+// See MapBasedGlobalLockImpl.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Delete(const std::string &key) { return Delete(key, 0); }
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Delete(const std::string &key, uint64_t hash) {
+    lru_node *node = Find(key, hash);
+    if (node == nullptr) {
+        _counters.Add(Counters::kDeleteMisses);
+        return false;
+    }
+    _counters.Add(Counters::kDeleteHits);
+    RemoveNode(*node);
+    return true;
+ }
+
+// See MapBasedGlobalLockImpl.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Get(const std::string &key, std::string &value) { return DoGet(key, 0, value); }
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Get(const std::string &key, uint64_t hash, std::string &value) {
+    return DoGet(key, hash, value);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::GetValue(const std::string &key, Value &value) { return DoGet(key, 0, value); }
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::GetValue(const std::string &key, uint64_t hash, Value &value) {
+    return DoGet(key, hash, value);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::GetItem(const std::string &key, Value &out) {
+    return GetItem(key, 0, out);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::GetItem(const std::string &key, uint64_t hash, Value &out) {
+    Track(key, true);
+    lru_node *node = Find(key, hash);
+    if (node == nullptr) {
+        _counters.Add(Counters::kGetMisses);
+        Sample(key.data(), key.size(), hash, 0, true);
+        return false;
+    }
+    _counters.Add(Counters::kGetHits);
+    Sample(key.data(), key.size(), node->hash, key.size() + ValueSize(*node), true);
+    MoveNodeToTail(*node);
+    if (node->chunks) {
+        out.Append("VALUE " + key + " 0 " + std::to_string(node->chunks->size()) + "\r\n");
+        out.Append(*node->chunks);
+        out.Append("\r\n", 2);
+    } else {
+        out.Append(node->wire.data(), node->wire.size());
+    }
+    return true;
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Compute(const std::string &key, const Mutation &mutation) {
+    return Compute(key, 0, mutation);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Compute(const std::string &key, uint64_t hash, const Mutation &mutation) {
+    Track(key, false);
+    lru_node *node = Find(key, hash);
+
+    // Large value shares chunks, mutation appending to it starts the new one
+    auto current = MakeCurrent([this, node](Value &value) {
+        if (node != nullptr) {
+            CopyValue(*node, value);
+        }
+    });
+    Value value;
+    switch (mutation(node != nullptr, current, value)) {
+    case Action::kStore:
+        _counters.Add(Counters::kCmdSet);
+        if (key.size() + value.size() > _max_size) {
+            return false;
+        }
+        if (node != nullptr) {
+            UpdateNode(*node, std::move(value));
+        } else {
+            InsertNode(key, hash, std::move(value));
+        }
+        return true;
+    case Action::kDelete:
+        if (node == nullptr) {
+            _counters.Add(Counters::kDeleteMisses);
+            return false;
+        }
+        _counters.Add(Counters::kDeleteHits);
+        RemoveNode(*node);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Append(const std::string &key, Value data) {
+    return Concat(key, 0, data, false);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Append(const std::string &key, uint64_t hash, Value data) {
+    return Concat(key, hash, data, false);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Prepend(const std::string &key, Value data) {
+    return Concat(key, 0, data, true);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Prepend(const std::string &key, uint64_t hash, Value data) {
+    return Concat(key, hash, data, true);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::DeletePrefix(const std::string &prefix, std::size_t &deleted) {
+    // Index entries refer to the nodes, so nodes are removed once the walk is over
+    std::vector<lru_node *> found;
+    Index::ForEachPrefix(_lru_index, KeyRef(prefix),
+                         [&found](typename lru_map::value_type &entry) { found.push_back(&entry.second.get()); });
+    for (lru_node *node : found) {
+        _counters.Add(Counters::kDeleteHits);
+        RemoveNode(*node);
+    }
+    deleted = found.size();
+    return true;
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::PutTagged(const std::string &key, const std::string &value,
+                                            const std::string &tag) {
+    return PutTagged(key, 0, value, tag);
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::PutTagged(const std::string &key, uint64_t hash, const std::string &value,
+                                            const std::string &tag) {
+    // Generation is taken before the put, so invalidation racing with it leaves item stale
+    ItemTag current = _tags->Resolve(tag);
+    if (!DoPut(key, hash, value)) {
+        return false;
+    }
+
+    // Both insert and update leave the item the freshest one
+    _lru_head->prev->tag = current;
+    return true;
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::InvalidateTag(const std::string &tag) {
+    _tags->Invalidate(tag);
+    return true;
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::FlushAll(uint32_t delay) {
+    _tags->Flush(std::chrono::seconds(delay));
+    return true;
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::DropStale(std::size_t max_items, std::size_t &dropped) {
+    // Delayed flush makes every check read the clock, so that it is done once per batch
+    const uint32_t flushes = _tags->Flushes();
+    dropped = 0;
+    if (_sweep == nullptr) {
+        _sweep = _lru_head.get();
+    }
+    for (std::size_t i = 0; i < max_items && _sweep != nullptr; i++) {
+        lru_node &node = *_sweep;
+        _sweep = node.next.get();
+        if (_tags->Stale(node.tag, flushes)) {
+            RemoveNode(node);
+            dropped++;
+        }
+    }
+    return _sweep != nullptr;
+}
+
+template <typename Index, typename Accounting>
+template <typename V>
+bool BasicLRU<Index, Accounting>::DoPut(const std::string &key, uint64_t hash, V &&value) {
+    _counters.Add(Counters::kCmdSet);
+    Track(key, false);
+    std::size_t put_size = key.size() + value.size();
+    if (put_size > _max_size) {
+        return false;
+    }
+    lru_node *node = Find(key, hash);
+    if (node != nullptr) {
+        UpdateNode(*node, std::forward<V>(value));
+        return true;
+    }
+    else {
+        InsertNode(key, hash, std::forward<V>(value));
+        return true;
+    }
+}
+
+template <typename Index, typename Accounting>
+template <typename V>
+bool BasicLRU<Index, Accounting>::DoGet(const std::string &key, uint64_t hash, V &value) {
+    Track(key, true);
+    lru_node *node = Find(key, hash);
+    if (node == nullptr) {
+        _counters.Add(Counters::kGetMisses);
+        Sample(key.data(), key.size(), hash, 0, true);
+        return false;
+    }
+    _counters.Add(Counters::kGetHits);
+    Sample(key.data(), key.size(), node->hash, key.size() + ValueSize(*node), true);
+    auto& found_node = *node;
+    MoveNodeToTail(found_node);
+    CopyValue(found_node, value);
+    return true;
+}
+
+template <typename Index, typename Accounting>
+typename BasicLRU<Index, Accounting>::lru_node *BasicLRU<Index, Accounting>::Find(const std::string &key,
+                                                                                  uint64_t hash) {
+    auto it = _lru_index.find(KeyRef(key, hash));
+    if (it == _lru_index.end()) {
+        return nullptr;
+    }
+    lru_node &node = it->second.get();
+    if (_tags->Stale(node.tag)) {
+        RemoveNode(node);
+        return nullptr;
+    }
+    return &node;
+}
+
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::FreeSpace(std::size_t put_size) {
+    assert(put_size > 0);
+    assert(put_size <= _max_size);
+
+    // Remove the oldest elements until there is enough space.
+    while(_current_size + put_size > _max_size) {
+        EvictHead();
+    }
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+std::size_t BasicLRU<Index, Accounting>::Evict(std::size_t target_size, std::size_t max_items) {
+    std::size_t evicted = 0;
+    while (_current_size > target_size && evicted < max_items && _lru_head) {
+        EvictHead();
+        evicted++;
+    }
+    return evicted;
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Adopt(const std::string &key, const Value &value, bool as_oldest,
+                                        const ItemTag *item_tag, uint64_t hash) {
+    const ItemTag tag = item_tag != nullptr ? *item_tag : _tags->Untagged();
+    std::size_t put_size = key.size() + value.size();
+    if (put_size > _max_size || _tags->Stale(tag) || Find(key, hash) != nullptr) {
+        return false;
+    }
+    if (!as_oldest) {
+        InsertNode(key, hash, value);
+        _lru_head->prev->tag = tag;
+        return true;
+    }
+
+    std::size_t charge;
+    ValueTable::Entry *shared = Share(value, charge);
+    put_size = key.size() + charge;
+    if (_current_size + put_size > _max_size) {
+        if (shared != nullptr) {
+            _values->Release(shared);
+        }
+        return false;
+    }
+
+    auto new_node = NewNode(key, hash, value, shared);
+    new_node->tag = tag;
+    if (_lru_head) {
+        new_node->prev = _lru_head->prev;
+        _lru_head->prev = new_node;
+        new_node->next = std::move(_lru_head);
+    } else {
+        new_node->prev = new_node;
+    }
+    _lru_head.reset(new_node);
+
+    _lru_index.emplace(KeyRef(new_node->key, new_node->hash), *new_node);
+    _current_size += put_size;
+    return true;
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Extract(const std::string &key, Value &value, ItemTag *tag, uint64_t hash) {
+    lru_node *found = Find(key, hash);
+    if (found == nullptr) {
+        return false;
+    }
+    auto &node = *found;
+    CopyValue(node, value);
+    if (tag != nullptr) {
+        *tag = node.tag;
+    }
+    RemoveNode(node);
+    return true;
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::Stats(const std::string &group,
+                                        std::vector<std::pair<std::string, std::string>> &stats) {
+    if (group.empty()) {
+        StorageStats snapshot;
+        Snapshot(snapshot);
+        snapshot.Report("", stats);
+    } else if (group == "hotkeys" && _hot) {
+        // Summary is thread safe on its own, no lock is needed
+        std::vector<HeavyHitters::Hitter> top;
+        _hot->Top(top);
+        for (std::size_t rank = 0; rank < top.size(); rank++) {
+            HeavyHitters::Report(rank, top[rank], stats);
+        }
+    }
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::Snapshot(StorageStats &stats) {
+    _counters.Collect(stats);
+    stats.evictions += _evictions;
+    stats.curr_items += count();
+    stats.bytes += _current_size;
+    stats.limit_maxbytes += _max_size;
+    if (_values) {
+        stats.dedup_values += _values->size();
+        stats.dedup_items += _values->refs();
+        stats.dedup_saved_bytes += _values->logical_bytes() - _values->bytes();
+    }
+    if (_mrc) {
+        _mrc->Collect(stats);
+    }
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::FreshestKey(std::string &key) const {
+    if (!_lru_head) {
+        return false;
+    }
+    key.assign(_lru_head->prev->key.data(), _lru_head->prev->key.size());
+    return true;
+}
+
+// See SimpleLRU.h
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::AttachFilter(CuckooFilter *filter) {
+    if (filter != nullptr) {
+        for (lru_node *node = _lru_head.get(); node != nullptr; node = node->next.get()) {
+            filter->Insert(node->hash);
+        }
+    }
+    _filter = filter;
+}
+
+template <typename Index, typename Accounting>
+template <typename V>
+typename BasicLRU<Index, Accounting>::lru_node *BasicLRU<Index, Accounting>::NewNode(const std::string &key,
+                                                                                     uint64_t hash, V &&value,
+                                                                                     ValueTable::Entry *shared) {
+    if (hash == 0) {
+        hash = HashKey(key.data(), key.size());
+    }
+    if (_filter != nullptr) {
+        _filter->Insert(hash);
+    }
+
+    Arena *arena = _arena.get();
+    auto node = new (arena) lru_node{arena_string(key.data(), key.size(), arena), hash, arena_string(arena), 0,
+                                     nullptr, nullptr, nullptr, nullptr, _tags->Untagged()};
+    AssignValue(*node, std::forward<V>(value), shared);
+    return node;
+}
+
+template <typename Index, typename Accounting>
+template <typename V>
+ValueTable::Entry *BasicLRU<Index, Accounting>::Share(const V &value, std::size_t &charge) {
+    charge = value.size();
+    if (!_values || value.size() < _values->threshold()) {
+        return nullptr;
+    }
+
+    bool created;
+    ValueTable::Entry *entry = _values->Acquire(value, created);
+    if (!created) {
+        // Bytes are counted already
+        charge = 0;
+    }
+    return entry;
+}
+
+template <typename Index, typename Accounting>
+std::size_t BasicLRU<Index, Accounting>::DropValue(lru_node &node) {
+    std::size_t freed = ValueSize(node);
+    if (node.shared != nullptr) {
+        if (!_values->Release(node.shared)) {
+            freed = 0;
+        }
+        node.shared = nullptr;
+    }
+    node.chunks.reset();
+    return freed;
+}
+
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::AssignValue(lru_node &node, const std::string &value,
+                                              ValueTable::Entry *shared) {
+    node.shared = shared;
+    if (shared != nullptr) {
+        node.chunks.reset(new Value(shared->value));
+        arena_string(node.wire.get_allocator()).swap(node.wire);
+    } else if (value.size() > Value::kChunkSize) {
+        node.chunks.reset(new Value(value));
+        arena_string(node.wire.get_allocator()).swap(node.wire);
+    } else {
+        node.chunks.reset();
+        BeginWire(node, value.size());
+        node.wire.append(value.data(), value.size());
+        node.wire.append("\r\n", 2);
+    }
+}
+
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::AssignValue(lru_node &node, const Value &value, ValueTable::Entry *shared) {
+    node.shared = shared;
+    if (shared != nullptr) {
+        node.chunks.reset(new Value(shared->value));
+        arena_string(node.wire.get_allocator()).swap(node.wire);
+    } else if (value.size() > Value::kChunkSize) {
+        // Chunks are shared, not copied
+        node.chunks.reset(new Value(value));
+        arena_string(node.wire.get_allocator()).swap(node.wire);
+    } else {
+        node.chunks.reset();
+        BeginWire(node, value.size());
+        for (std::size_t i = 0; i < value.chunks(); i++) {
+            node.wire.append(value.chunk(i).data(), value.chunk(i).size());
+        }
+        node.wire.append("\r\n", 2);
+    }
+}
+
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::AssignValue(lru_node &node, Value &&value, ValueTable::Entry *shared) {
+    if (shared == nullptr && value.size() > Value::kChunkSize) {
+        // Chunks are moved along with their array
+        node.shared = nullptr;
+        node.chunks.reset(new Value(std::move(value)));
+        arena_string(node.wire.get_allocator()).swap(node.wire);
+    } else {
+        AssignValue(node, static_cast<const Value &>(value), shared);
+    }
+}
+
+template <typename Index, typename Accounting>
+bool BasicLRU<Index, Accounting>::Concat(const std::string &key, uint64_t hash, const Value &data, bool prepend) {
+    _counters.Add(Counters::kCmdSet);
+    Track(key, false);
+    lru_node *node = Find(key, hash);
+    if (node == nullptr) {
+        return false;
+    }
+    std::size_t old_size = ValueSize(*node);
+    if (key.size() + old_size + data.size() > _max_size) {
+        return false;
+    }
+
+    if (node->shared != nullptr) {
+        // Shared value is never modified, item moves to the other one as on update, but keeps its tag
+        ItemTag tag = node->tag;
+        UpdateNode(*node, Joined(*node, data, prepend));
+        node->tag = tag;
+        return true;
+    }
+
+    // Item is the freshest one, so that it is the last to be evicted and is never evicted for its own bytes
+    MoveNodeToTail(*node);
+    if (data.size() > 0) {
+        FreeSpace(data.size());
+    }
+    _current_size += data.size();
+
+    if (node->chunks) {
+        Value &chunks = *node->chunks;
+        if (prepend) {
+            for (std::size_t i = data.chunks(); i > 0; i--) {
+                chunks.Prepend(data.chunk(i - 1).data(), data.chunk(i - 1).size());
+            }
+        } else {
+            for (std::size_t i = 0; i < data.chunks(); i++) {
+                chunks.Append(data.chunk(i).data(), data.chunk(i).size());
+            }
+        }
+
+        // Chunks readers still refer to are never written, pieces put next to them are glued once they pile up
+        if (chunks.fragmented()) {
+            chunks.Compact();
+        }
+    } else if (old_size + data.size() > Value::kChunkSize) {
+        // Value outgrows the response form once, from now on it is kept as chunks
+        AssignValue(*node, Joined(*node, data, prepend), nullptr);
+    } else {
+        // Header goes first, so that data offset is final
+        SetWireSize(*node, old_size + data.size());
+        std::size_t at = prepend ? node->data_offset : node->wire.size() - 2;
+        for (std::size_t i = 0; i < data.chunks(); i++) {
+            node->wire.insert(at, data.chunk(i).data(), data.chunk(i).size());
+            at += data.chunk(i).size();
+        }
+    }
+    Sample(key.data(), key.size(), node->hash, key.size() + ValueSize(*node), false);
+    return true;
+}
+
+template <typename Index, typename Accounting>
+Value BasicLRU<Index, Accounting>::Joined(const lru_node &node, const Value &data, bool prepend) {
+    Value value;
+    CopyValue(node, value);
+    if (!prepend) {
+        value.Append(data);
+        return value;
+    }
+
+    Value joined(data);
+    joined.Append(value);
+    return joined;
+}
+
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::BeginWire(lru_node &node, std::size_t size) {
+    const std::string bytes = std::to_string(size);
+    node.wire.clear();
+    node.wire.reserve(sizeof("VALUE  0 \r\n\r\n") - 1 + node.key.size() + bytes.size() + size);
+    node.wire.append("VALUE ", 6);
+    node.wire.append(node.key.data(), node.key.size());
+    node.wire.append(" 0 ", 3);
+    node.wire.append(bytes.data(), bytes.size());
+    node.wire.append("\r\n", 2);
+    node.data_offset = node.wire.size();
+}
+
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::SetWireSize(lru_node &node, std::size_t size) {
+    const std::string bytes = std::to_string(size);
+
+    // Size is the last field of the header, right before its CRLF
+    std::size_t end = node.data_offset - 2;
+    std::size_t begin = node.wire.rfind(' ', end) + 1;
+    node.wire.replace(begin, end - begin, bytes.data(), bytes.size());
+    node.data_offset = begin + bytes.size() + 2;
+}
+
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::CopyValue(const lru_node &node, std::string &out) {
+    if (node.chunks) {
+        node.chunks->CopyTo(out);
+    } else {
+        out.assign(node.wire.data() + node.data_offset, ValueSize(node));
+    }
+}
+
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::CopyValue(const lru_node &node, Value &out) {
+    if (node.chunks) {
+        out = *node.chunks;
+    } else {
+        out.clear();
+        out.Append(node.wire.data() + node.data_offset, ValueSize(node));
+    }
+}
+
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::EvictHead() {
+    _evictions++;
+    if (_sweep == _lru_head.get()) {
+        _sweep = _lru_head->next.get();
+    }
+    if (_filter != nullptr) {
+        _filter->Erase(_lru_head->hash);
+    }
+    _current_size -= _lru_head->key.size() + DropValue(*_lru_head);
+    lru_node* new_head = _lru_head->next.get();
+    if (new_head) {
+        new_head->prev = _lru_head->prev;
+    }
+    _lru_head->next.release();
+    _lru_index.erase(KeyRef(_lru_head->key, _lru_head->hash));
+    _lru_head.reset(new_head);
+}
+
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::RemoveNode(lru_node &node) {
+    if (_filter != nullptr) {
+        _filter->Erase(node.hash);
+    }
+    if (_mrc && _mrc->Sampled(node.hash)) {
+        // Item is gone from cache of any size, unlike the evicted one
+        _mrc->Erase(node.hash);
+    }
+    _current_size -= node.key.size() + DropValue(node);
+    auto prev = node.prev;
+    auto next = node.next.get();
+    if (_sweep == &node) {
+        _sweep = next;
+    }
+    if (next) {
+        next->prev = prev;
+    }
+    else {
+        _lru_head->prev = prev;
+    }
+
+    // Index refers to the node key, so it goes first
+    _lru_index.erase(KeyRef(node.key, node.hash));
+    if (_lru_head.get() == &node) {
+        _lru_head->next.release();
+        _lru_head.reset(next);
+    }
+    else {
+        // Node must not take the rest of the list with it
+        node.next.release();
+        prev->next.reset(next);
+    }
+}
+
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::SampleAccess(uint64_t hash, std::size_t item_size, bool get) {
+    if (_mrc->Sampled(hash)) {
+        _mrc->Access(hash, item_size, get);
+    }
+}
+
+template <typename Index, typename Accounting>
+void BasicLRU<Index, Accounting>::MoveNodeToTail(lru_node& node) {
+    if (_lru_head->prev == &node) {
+        return;
+    }
+    if (_sweep == &node) {
+        _sweep = node.next.get();
+    }
+
+    auto* lru_tail = _lru_head->prev;
+    // Left node exists, 
+    // and we can link left and right nodes
+    // to exclude middle node.
+    if (_lru_head.get() != &node) {
+        auto* right_node = node.next.get();
+        auto* left_node = node.prev;
+        right_node->prev = left_node;
+        left_node->next.release();
+        std::swap(left_node->next, node.next);
+    }
+    // Node is head, move _lru_head to the right node
+    else {
+        _lru_head.release();
+        std::swap(_lru_head, node.next);
+    }
+
+    lru_tail->next.reset(&node);
+    node.prev = lru_tail;
+    
+    _lru_head->prev = &node;
+}
+
+template <typename Index, typename Accounting>
+template <typename V>
+void BasicLRU<Index, Accounting>::InsertNode(const std::string &key, uint64_t hash, V &&value) {
+    assert(key.size() + value.size() <= _max_size);
+
+    // Reference is taken first, so that eviction of other items sharing the value can't free it
+    std::size_t charge;
+    ValueTable::Entry *shared = Share(value, charge);
+    std::size_t put_size = key.size() + charge;
+    if (put_size > 0) {
+        FreeSpace(put_size);
+    }
+
+    auto new_node = NewNode(key, hash, std::forward<V>(value), shared);
+    if (_lru_head) {
+        auto freshest = _lru_head->prev;
+        freshest->next.reset(new_node);
+        new_node->prev = freshest;
+        _lru_head->prev = new_node;
+    }
+    else {
+        _lru_head.reset(new_node);
+        _lru_head->prev = _lru_head.get();
+    }
+    // Add to index
+    _lru_index.emplace(KeyRef(new_node->key, new_node->hash), *new_node);
+    // Update the current size of cache
+    _current_size += put_size;
+    Sample(key.data(), key.size(), new_node->hash, key.size() + ValueSize(*new_node), false);
+}
+
+template <typename Index, typename Accounting>
+template <typename V>
+void BasicLRU<Index, Accounting>::UpdateNode(lru_node& node, V &&new_value) {
+    assert(node.key.size() + new_value.size() <=_max_size);
+    
+    MoveNodeToTail(node);
+
+    // New value is shared before the old one is dropped, so that rewrite of the same bytes keeps the entry.
+    // Shared entry is never modified: item just moves to the other one, or to its own copy
+    std::size_t charge;
+    ValueTable::Entry *shared = Share(new_value, charge);
+    _current_size -= DropValue(node);
+    if (charge > 0) {
+        FreeSpace(charge);
+    }
+
+    _current_size += charge;
+    AssignValue(node, std::forward<V>(new_value), shared);
+    node.tag = _tags->Untagged();
+    Sample(node.key.data(), node.key.size(), node.hash, node.key.size() + ValueSize(node), false);
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,532 @@
+#include "StripedLockLRU.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// Stripe must be able to hold at least that many bytes
+const std::size_t kMinStripeSize = 1024 * 1024UL;
+
+// Background thread wakes up at least that often, and checks lock contention of stripes as often
+const std::chrono::milliseconds kContentionPeriod(100);
+
+// Stripes are split once more than one of that many lock acquisitions had to wait...
+const uint64_t kContentionRatio = 16;
+
+// ...and there were at least that many of them during the period
+const uint64_t kContentionMinLocks = 1024;
+
+// Share of the memory limit previous table keeps once resize starts, the rest is room for writes into the new one
+const double kMovingShare = 7.0 / 8;
+
+} // namespace
+
+// See StripedLockLRU.h
+StripedLockLRU::Table::Table(std::size_t n_stripes, std::size_t stripe_max_size, const Config &config,
+                             BackgroundWorker *worker, const std::shared_ptr<TagRegistry> &tags,
+                             const std::shared_ptr<HeavyHitters> &hot, Table *prev)
+    : stripes(n_stripes), previous(prev) {
+    // Stripes count keys in the summary of the whole storage instead of their own ones
+    Config stripe_config = config;
+    stripe_config.hot_keys = 0;
+    for (auto &stripe : stripes) {
+        stripe.reset(new ThreadSafeSimplLRU(stripe_max_size, stripe_config));
+        stripe->SetBackgroundWorker(worker);
+        stripe->SetTagRegistry(tags);
+        stripe->SetHeavyHitters(hot);
+    }
+}
+
+// See StripedLockLRU.h
+StripedLockLRU::StripedLockLRU(size_t memory_limit, size_t n_stripes, const Config &config)
+    : _memory_limit(memory_limit), _config(config), _resizable(config.max_stripes > n_stripes),
+      _worker([this]() { return Maintain(); },
+              config.write_behind ? std::chrono::milliseconds(1) : kContentionPeriod),
+      _sweep_stripe(0), _limit_scale(1), _tags(new TagRegistry()),
+      _hot(config.hot_keys > 0 ? new HeavyHitters(config.hot_keys) : nullptr), _checked_table(nullptr),
+      _checked_acquired(0), _checked_contended(0) {
+    assert(n_stripes > 0);
+    assert(memory_limit > 0);
+
+    size_t stripe_max_size = memory_limit / n_stripes;
+    if (stripe_max_size < kMinStripeSize) {
+        throw std::runtime_error("parameters are set incorrectly");
+    }
+    _table.store(new Table(n_stripes, stripe_max_size, _config, &_worker, _tags, _hot, nullptr));
+}
+
+// See StripedLockLRU.h
+StripedLockLRU::~StripedLockLRU() {
+    Stop();
+
+    Table *table = _table.load();
+    delete table->previous.load();
+    delete table;
+}
+
+// See StripedLockLRU.h
+void StripedLockLRU::Start() {
+    for (auto &stripe : _table.load()->stripes) {
+        stripe->SimpleLRU::Start();
+    }
+    _worker.Start();
+}
+
+// See StripedLockLRU.h
+void StripedLockLRU::Stop() { _worker.Stop(); }
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Put(const std::string &key, const std::string &value) {
+    return Put(key, HashKey(key.data(), key.size()), value);
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Put(const std::string &key, std::string &&value) {
+    uint64_t hash = HashKey(key.data(), key.size());
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.Put(key, hash, std::move(value)); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Put(const std::string &key, uint64_t hash, const std::string &value) {
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.Put(key, hash, value); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::PutIfAbsent(const std::string &key, const std::string &value) {
+    return PutIfAbsent(key, HashKey(key.data(), key.size()), value);
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) {
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.PutIfAbsent(key, hash, value); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Set(const std::string &key, const std::string &value) {
+    return Set(key, HashKey(key.data(), key.size()), value);
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Set(const std::string &key, uint64_t hash, const std::string &value) {
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.Set(key, hash, value); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Delete(const std::string &key) { return Delete(key, HashKey(key.data(), key.size())); }
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Delete(const std::string &key, uint64_t hash) {
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.Delete(key, hash); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Get(const std::string &key, std::string &value) {
+    return Get(key, HashKey(key.data(), key.size()), value);
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Get(const std::string &key, uint64_t hash, std::string &value) {
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.Get(key, hash, value); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::PutValue(const std::string &key, Value value) {
+    return PutValue(key, HashKey(key.data(), key.size()), std::move(value));
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::PutValue(const std::string &key, uint64_t hash, Value value) {
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.PutValue(key, hash, std::move(value)); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::GetValue(const std::string &key, Value &value) {
+    return GetValue(key, HashKey(key.data(), key.size()), value);
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::GetValue(const std::string &key, uint64_t hash, Value &value) {
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.GetValue(key, hash, value); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::GetItem(const std::string &key, Value &out) {
+    return GetItem(key, HashKey(key.data(), key.size()), out);
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::GetItem(const std::string &key, uint64_t hash, Value &out) {
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.GetItem(key, hash, out); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Compute(const std::string &key, const Mutation &mutation) {
+    return Compute(key, HashKey(key.data(), key.size()), mutation);
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Compute(const std::string &key, uint64_t hash, const Mutation &mutation) {
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.Compute(key, hash, mutation); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Append(const std::string &key, Value data) {
+    return Append(key, HashKey(key.data(), key.size()), std::move(data));
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Append(const std::string &key, uint64_t hash, Value data) {
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.Append(key, hash, std::move(data)); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Prepend(const std::string &key, Value data) {
+    return Prepend(key, HashKey(key.data(), key.size()), std::move(data));
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Prepend(const std::string &key, uint64_t hash, Value data) {
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.Prepend(key, hash, std::move(data)); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::DeletePrefix(const std::string &prefix, std::size_t &deleted) {
+    Concurrency::EpochManager::Guard guard(_epoch);
+    Table *table = _table.load(std::memory_order_acquire);
+
+    // Items only move from the previous table into the current one, so that order doesn't miss any
+    deleted = 0;
+    Table *previous = table->previous.load(std::memory_order_acquire);
+    for (Table *t : {previous, table}) {
+        if (t == nullptr) {
+            continue;
+        }
+        for (auto &stripe : t->stripes) {
+            std::size_t n = 0;
+            stripe->DeletePrefix(prefix, n);
+            deleted += n;
+        }
+    }
+    return true;
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::PutTagged(const std::string &key, const std::string &value, const std::string &tag) {
+    return PutTagged(key, HashKey(key.data(), key.size()), value, tag);
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::PutTagged(const std::string &key, uint64_t hash, const std::string &value,
+                               const std::string &tag) {
+    return Apply(key, hash, [&](ThreadSafeSimplLRU &stripe) { return stripe.PutTagged(key, hash, value, tag); });
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::InvalidateTag(const std::string &tag) {
+    _tags->Invalidate(tag);
+    return true;
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::FlushAll(uint32_t delay) {
+    Concurrency::EpochManager::Guard guard(_epoch);
+    Table *table = _table.load(std::memory_order_acquire);
+
+    // Queued puts are applied first, so that they are flushed as well
+    for (Table *t : {table->previous.load(std::memory_order_acquire), table}) {
+        if (t == nullptr) {
+            continue;
+        }
+        for (auto &stripe : t->stripes) {
+            stripe->ApplyPending();
+        }
+    }
+
+    _tags->Flush(std::chrono::seconds(delay));
+    _worker.Wakeup();
+    return true;
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::SetLimitScale(double scale) {
+    if (!(scale > 0 && scale <= 1)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lk(_resize_mtx);
+    _limit_scale = scale;
+
+    Concurrency::EpochManager::Guard guard(_epoch);
+    Table *table = _table.load(std::memory_order_acquire);
+    Table *previous = table->previous.load(std::memory_order_acquire);
+    if (previous == nullptr) {
+        for (auto &stripe : table->stripes) {
+            stripe->SetLimitScale(scale);
+        }
+        return true;
+    }
+
+    for (auto &stripe : previous->stripes) {
+        stripe->SetLimitScale(scale * kMovingShare);
+    }
+    Rebalance(table, previous);
+    return true;
+}
+
+// See StripedLockLRU.h
+void StripedLockLRU::Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) {
+    if (group == "hotkeys") {
+        // Keys are listed along with their stripes, so that overloaded stripe could be told
+        std::vector<HeavyHitters::Hitter> top;
+        if (_hot) {
+            _hot->Top(top);
+        }
+        Concurrency::EpochManager::Guard guard(_epoch);
+        Table *table = _table.load(std::memory_order_acquire);
+        for (std::size_t rank = 0; rank < top.size(); rank++) {
+            HeavyHitters::Report(rank, top[rank], stats);
+            stats.emplace_back("hotkey:" + std::to_string(rank) + ":stripe",
+                               std::to_string(table->index(HashKey(top[rank].key.data(), top[rank].key.size()))));
+        }
+        return;
+    }
+    if (!group.empty() && group != "stripes") {
+        return;
+    }
+
+    // Sweep holds the lock while waiting for guards to go, so it must be taken out of the guard
+    std::lock_guard<std::mutex> lk(_resize_mtx);
+    Concurrency::EpochManager::Guard guard(_epoch);
+
+    StorageStats total = _retired_stats;
+    Table *table = _table.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < table->stripes.size(); i++) {
+        StorageStats stripe;
+        table->stripes[i]->Snapshot(stripe);
+        if (!group.empty()) {
+            stripe.Report("stripe:" + std::to_string(i) + ":", stats);
+        }
+        total += stripe;
+    }
+
+    // Items that are not moved yet, along with the part of memory limit they hold
+    Table *previous = table->previous.load(std::memory_order_acquire);
+    if (previous != nullptr) {
+        for (auto &stripe : previous->stripes) {
+            stripe->Snapshot(total);
+        }
+    }
+
+    if (group.empty()) {
+        total.Report("", stats);
+        stats.emplace_back("stripes", std::to_string(table->stripes.size()));
+    }
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Resize(std::size_t n_stripes) {
+    assert(n_stripes > 0);
+    std::size_t stripe_max_size = _memory_limit / n_stripes;
+    if (stripe_max_size < kMinStripeSize) {
+        throw std::runtime_error("parameters are set incorrectly");
+    }
+
+    std::lock_guard<std::mutex> lk(_resize_mtx);
+    Table *current = _table.load();
+    if (!_resizable || n_stripes > _config.max_stripes || current->previous.load() != nullptr ||
+        current->stripes.size() == n_stripes) {
+        return false;
+    }
+
+    // Items of the current table are moved into the new one, both of them together must fit into the limit
+    for (auto &stripe : current->stripes) {
+        stripe->SetLimitScale(_limit_scale * kMovingShare);
+    }
+    Table *table = new Table(n_stripes, stripe_max_size, _config, &_worker, _tags, _hot, current);
+    for (auto &stripe : table->stripes) {
+        stripe->SimpleLRU::Start();
+        stripe->SetLimitScale(_limit_scale * (1 - kMovingShare));
+    }
+
+    _sweep_stripe = 0;
+    _table.store(table, std::memory_order_release);
+    Rebalance(table, current);
+    _worker.Wakeup();
+    return true;
+}
+
+// See StripedLockLRU.h
+void StripedLockLRU::Rebalance(Table *table, Table *previous) {
+    std::size_t moving = 0;
+    for (auto &stripe : previous->stripes) {
+        moving += stripe->Freeze();
+    }
+
+    // Previous table keeps at most kMovingShare of the limit, so there is always some left
+    const double scale = _limit_scale - double(moving) / _memory_limit;
+    for (auto &stripe : table->stripes) {
+        stripe->SetLimitScale(scale);
+    }
+}
+
+// See StripedLockLRU.h
+std::size_t StripedLockLRU::stripes() {
+    Concurrency::EpochManager::Guard guard(_epoch);
+    return _table.load(std::memory_order_acquire)->stripes.size();
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Resizing() {
+    Concurrency::EpochManager::Guard guard(_epoch);
+    return _table.load(std::memory_order_acquire)->previous.load(std::memory_order_acquire) != nullptr;
+}
+
+// See StripedLockLRU.h
+ThreadSafeSimplLRU &StripedLockLRU::Route(const std::string &key, uint64_t hash) {
+    Table *table = _table.load(std::memory_order_acquire);
+    ThreadSafeSimplLRU &stripe = table->stripe(hash);
+
+    Table *previous = table->previous.load(std::memory_order_acquire);
+    if (previous != nullptr) {
+        Migrate(key, hash, stripe, previous->stripe(hash), false);
+    }
+    return stripe;
+}
+
+// See StripedLockLRU.h
+void StripedLockLRU::Migrate(const std::string &key, uint64_t hash, ThreadSafeSimplLRU &to, ThreadSafeSimplLRU &from,
+                             bool as_oldest) {
+    // Locks are always taken new stripe first, so that concurrent migrations never deadlock
+    auto to_lock = to.Lock();
+    auto from_lock = from.Lock();
+
+    // Key could be written into the new table already, that value is newer. Large values move without copy
+    Value value;
+    ItemTag tag;
+    if (from.Extract(key, value, &tag, hash)) {
+        to.Adopt(key, value, as_oldest, &tag, hash);
+    }
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Sweep() {
+    std::lock_guard<std::mutex> lk(_resize_mtx);
+    Table *table = _table.load(std::memory_order_acquire);
+    Table *previous = table->previous.load(std::memory_order_acquire);
+    if (previous == nullptr) {
+        return false;
+    }
+
+    // Take the freshest items first: each one is inserted as the oldest, so the order is kept
+    std::string key;
+    for (std::size_t moved = 0; _sweep_stripe < previous->stripes.size(); _sweep_stripe++) {
+        ThreadSafeSimplLRU &from = *previous->stripes[_sweep_stripe];
+        for (;; moved++) {
+            if (moved == kSweepBatch) {
+                Rebalance(table, previous);
+                return true;
+            }
+
+            {
+                auto from_lock = from.Lock();
+                if (!from.SimpleLRU::FreshestKey(key)) {
+                    break;
+                }
+            }
+            uint64_t hash = HashKey(key.data(), key.size());
+            Migrate(key, hash, table->stripe(hash), from, true);
+        }
+    }
+
+    // Requests that picked previous table as the current one before resize could still write into it,
+    // wait for them to finish and sweep once again
+    _epoch.Synchronize();
+    for (auto &stripe : previous->stripes) {
+        auto from_lock = stripe->Lock();
+        if (stripe->size() > 0) {
+            _sweep_stripe = 0;
+            return true;
+        }
+    }
+
+    // Now nobody could reach previous table except requests that are routing their keys right now
+    table->previous.store(nullptr, std::memory_order_release);
+    _epoch.Synchronize();
+    for (auto &stripe : table->stripes) {
+        stripe->SetLimitScale(_limit_scale);
+    }
+
+    // Keep operation counters, so that totals never go back
+    StorageStats retired;
+    for (auto &stripe : previous->stripes) {
+        stripe->Snapshot(retired);
+    }
+    retired.curr_items = retired.bytes = retired.limit_maxbytes = 0;
+    retired.dedup_values = retired.dedup_items = retired.dedup_saved_bytes = 0;
+    retired.mrc_gets = retired.mrc_hits_half = retired.mrc_hits_1x = retired.mrc_hits_2x = retired.mrc_hits_4x = 0;
+    _retired_stats += retired;
+    delete previous;
+    return false;
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::CheckContention() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - _checked_at < kContentionPeriod) {
+        return false;
+    }
+    _checked_at = now;
+
+    // Only this thread frees tables, so current one could be used without guard
+    Table *table = _table.load(std::memory_order_acquire);
+    if (table->previous.load(std::memory_order_acquire) != nullptr) {
+        return false;
+    }
+
+    uint64_t acquired = 0, contended = 0;
+    for (auto &stripe : table->stripes) {
+        uint64_t stripe_acquired, stripe_contended;
+        stripe->Contention(stripe_acquired, stripe_contended);
+        acquired += stripe_acquired;
+        contended += stripe_contended;
+    }
+
+    // Stripes of the new table count from zero
+    if (table != _checked_table) {
+        _checked_table = table;
+        _checked_acquired = _checked_contended = 0;
+    }
+    uint64_t period_acquired = acquired - _checked_acquired;
+    uint64_t period_contended = contended - _checked_contended;
+    _checked_acquired = acquired;
+    _checked_contended = contended;
+    if (period_acquired < kContentionMinLocks || period_contended * kContentionRatio <= period_acquired) {
+        return false;
+    }
+
+    std::size_t n_stripes = 2 * table->stripes.size();
+    if (n_stripes > _config.max_stripes || _memory_limit / n_stripes < kMinStripeSize) {
+        return false;
+    }
+    return Resize(n_stripes);
+}
+
+// See StripedLockLRU.h
+bool StripedLockLRU::Maintain() {
+    bool more = false;
+    Table *table = _table.load(std::memory_order_acquire);
+    for (auto &stripe : table->stripes) {
+        more = stripe->Maintain() || more;
+    }
+    if (!_resizable) {
+        return more;
+    }
+    return Sweep() || CheckContention() || more;
+}
+
+} // namespace Backend
+} // namespace Afina
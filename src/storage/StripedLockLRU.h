@@ -1,68 +1,229 @@
 #ifndef AFINA_STORAGE_STRIPED_LOCK_LRU_H
 #define AFINA_STORAGE_STRIPED_LOCK_LRU_H
 
-#include <cassert>
-#include <map>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
+#include <afina/concurrency/Epoch.h>
+
+#include "BackgroundWorker.h"
+#include "Config.h"
 #include "SimpleLRU.h"
 #include "ThreadSafeSimpleLRU.h"
 
 namespace Afina {
 namespace Backend {
 
+/**
+ * # Storage split into independently locked stripes
+ *
+ * Number of stripes could be changed online by Resize: new stripe table is published right away and items
+ * move there incrementally, the same way Redis rehashes its dictionaries. While resize is in progress every
+ * operation first moves its own key from the previous table, and background thread sweeps the rest in small
+ * batches, so no request ever waits for more than a couple of stripe locks. Swept items are inserted as the
+ * oldest ones, so that recently used items don't get evicted in favour of the cold tail. Memory limit is split
+ * between the tables: the previous one never grows, and the new one gets what the previous one gives up.
+ *
+ * Tables are accessed under epoch guard, the previous table is freed once the sweep is done and no request
+ * could reach it anymore. Background thread doubles number of stripes, up to Config::max_stripes, once more than
+ * one of 16 lock acquisitions had to wait. Storage that is not allowed to grow has a single table for its whole
+ * life, so requests pick stripes with no guard and no previous table check at all.
+ *
+ * Key is hashed once per request, see afina/KeyHash.h: hashed variants of operations take the hash parser
+ * computed, and the same hash picks the stripe and goes down to its filter and index.
+ */
 class StripedLockLRU : public Afina::Storage {
+private:
+    struct Table {
+        Table(std::size_t n_stripes, std::size_t stripe_max_size, const Config &config, BackgroundWorker *worker,
+              const std::shared_ptr<TagRegistry> &tags, const std::shared_ptr<HeavyHitters> &hot, Table *prev);
+
+        // Stripe is picked by bits 32-47 of the key hash, see afina/KeyHash.h
+        inline std::size_t index(uint64_t hash) const { return ((hash >> 32) & 0xffff) % stripes.size(); }
+        inline ThreadSafeSimplLRU &stripe(uint64_t hash) { return *stripes[index(hash)]; }
+
+        std::vector<std::unique_ptr<ThreadSafeSimplLRU>> stripes;
+
+        // Table being migrated into this one, nullptr once resize is complete
+        std::atomic<Table *> previous;
+    };
+
 public:
-    StripedLockLRU(size_t memory_limit = 1024, size_t n_stripes = 4) : _n_stripes(n_stripes) {
-        assert(_n_stripes > 0);
-        assert(memory_limit > 0);
+    StripedLockLRU(size_t memory_limit = 1024, size_t n_stripes = 4, const Config &config = Config());
+    ~StripedLockLRU();
 
-        size_t stripe_max_size = memory_limit / n_stripes;
-        if (stripe_max_size < 1024 * 1024UL) {
-            throw std::runtime_error("parameters are set incorrectly");
-        }
+    // Each stripe owns its own arena, but background work of all stripes is done by the single thread
+    // of the striped storage itself, so stripes are started bypassing ThreadSafeSimplLRU::Start
+    void Start() override;
 
-        _stripes.resize(_n_stripes);
-        for (std::size_t i = 0 ; i < _n_stripes; i++) {
-            _stripes[i].reset(new ThreadSafeSimplLRU(stripe_max_size));
-        }
-    }
+    // see SimpleLRU.h
+    void Stop() override;
 
-    ~StripedLockLRU() {}
+    // see SimpleLRU.h
+    bool Put(const std::string &key, const std::string &value) override;
+    bool Put(const std::string &key, std::string &&value) override;
+    bool Put(const std::string &key, uint64_t hash, const std::string &value) override;
 
     // see SimpleLRU.h
-    bool Put(const std::string &key, const std::string &value) override {
-        return _stripes[_hash(key) % _n_stripes]->Put(key, value);
-    }
+    bool PutIfAbsent(const std::string &key, const std::string &value) override;
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) override;
 
     // see SimpleLRU.h
-    bool PutIfAbsent(const std::string &key, const std::string &value) override {
-        return _stripes[_hash(key) % _n_stripes]->PutIfAbsent(key, value);
-    }
+    bool Set(const std::string &key, const std::string &value) override;
+    bool Set(const std::string &key, uint64_t hash, const std::string &value) override;
 
     // see SimpleLRU.h
-    bool Set(const std::string &key, const std::string &value) override {
-        return _stripes[_hash(key) % _n_stripes]->Set(key, value);
-    }
+    bool Delete(const std::string &key) override;
+    bool Delete(const std::string &key, uint64_t hash) override;
 
     // see SimpleLRU.h
-    bool Delete(const std::string &key) override {
-        return _stripes[_hash(key) % _n_stripes]->Delete(key);
-    }
+    bool Get(const std::string &key, std::string &value) override;
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override;
 
     // see SimpleLRU.h
-    bool Get(const std::string &key, std::string &value) override {
-        return _stripes[_hash(key) % _n_stripes]->Get(key, value);
-    }
+    bool PutValue(const std::string &key, Value value) override;
+    bool PutValue(const std::string &key, uint64_t hash, Value value) override;
+
+    // see SimpleLRU.h
+    bool GetValue(const std::string &key, Value &value) override;
+    bool GetValue(const std::string &key, uint64_t hash, Value &value) override;
+
+    // see SimpleLRU.h
+    bool GetItem(const std::string &key, Value &out) override;
+    bool GetItem(const std::string &key, uint64_t hash, Value &out) override;
+
+    // see SimpleLRU.h, mutation runs under the lock of the key's stripe
+    bool Compute(const std::string &key, const Mutation &mutation) override;
+    bool Compute(const std::string &key, uint64_t hash, const Mutation &mutation) override;
+
+    // see SimpleLRU.h
+    bool Append(const std::string &key, Value data) override;
+    bool Append(const std::string &key, uint64_t hash, Value data) override;
+
+    // see SimpleLRU.h
+    bool Prepend(const std::string &key, Value data) override;
+    bool Prepend(const std::string &key, uint64_t hash, Value data) override;
+
+    // Walks stripes of both tables one by one, so that only a single stripe is locked at a time
+    bool DeletePrefix(const std::string &prefix, std::size_t &deleted) override;
+
+    // see SimpleLRU.h
+    bool PutTagged(const std::string &key, const std::string &value, const std::string &tag) override;
+    bool PutTagged(const std::string &key, uint64_t hash, const std::string &value, const std::string &tag) override;
+
+    // All stripes share the single registry of tags, so that is O(1) regardless of number of stripes
+    bool InvalidateTag(const std::string &tag) override;
+
+    // Flushes the shared registry, so that it doesn't depend on number of stripes either. Background thread
+    // removes flushed items stripe by stripe
+    bool FlushAll(uint32_t delay) override;
+
+    // Scales stripes of both tables one by one, stripes of the table created by Resize get the same scale
+    bool SetLimitScale(double scale) override;
+
+    // Totals of all stripes, "stripes" group gives the same statistics of each stripe as stripe:<n>:<name>, and
+    // "hotkeys" lists the most accessed keys with stripes they belong to
+    void Stats(const std::string &group, std::vector<std::pair<std::string, std::string>> &stats) override;
+
+    /**
+     * Starts migration into the table of n_stripes stripes. Returns false if storage is not resizable or n_stripes
+     * is above Config::max_stripes, if previous resize isn't finished yet or table has that size already, throws
+     * if stripes would become too small
+     */
+    bool Resize(std::size_t n_stripes);
+
+    /**
+     * Number of stripes in the current table
+     */
+    std::size_t stripes();
+
+    /**
+     * True while items of the previous table are still being moved
+     */
+    bool Resizing();
 
 private:
-    std::hash<std::string> _hash;
-    std::size_t _n_stripes;
-    std::vector<std::unique_ptr<ThreadSafeSimplLRU>> _stripes;
+    StripedLockLRU(const StripedLockLRU &);            // = delete;
+    StripedLockLRU &operator=(const StripedLockLRU &); // = delete;
+
+    // Number of items moved by background thread between checks for other work
+    static const std::size_t kSweepBatch = 64;
+
+    // Returns stripe of the current table that owns the key, moving the key there if resize is in progress.
+    // Must be called under epoch guard
+    ThreadSafeSimplLRU &Route(const std::string &key, uint64_t hash);
+
+    // Applies operation to the stripe that owns the key, guard is taken only if table could be replaced
+    template <typename F> inline bool Apply(const std::string &key, uint64_t hash, F operation) {
+        if (!_resizable) {
+            return operation(_table.load(std::memory_order_relaxed)->stripe(hash));
+        }
+        Concurrency::EpochManager::Guard guard(_epoch);
+        return operation(Route(key, hash));
+    }
+
+    // Moves key between stripes if it is still in the old one
+    void Migrate(const std::string &key, uint64_t hash, ThreadSafeSimplLRU &to, ThreadSafeSimplLRU &from,
+                 bool as_oldest);
+
+    // Moves a single batch of items from the previous table, returns true if there is more to do
+    bool Sweep();
+
+    // Limits each stripe of the previous table to the bytes it still holds and gives the rest of memory limit to
+    // stripes of the new one, so that items being moved never take more memory than the limit. Must be called
+    // under _resize_mtx
+    void Rebalance(Table *table, Table *previous);
+
+    // Starts resize once stripe locks got contended during the last period, returns true if it did
+    bool CheckContention();
+
+    // Background work of all stripes
+    bool Maintain();
+
+    const std::size_t _memory_limit;
+    const Config _config;
+
+    // Number of stripes could change, see Config::max_stripes
+    const bool _resizable;
+
+    // Applies queued mutations, reclaims memory and sweeps previous table for all stripes
+    BackgroundWorker _worker;
+
+    // Serializes Resize, Sweep and SetLimitScale
+    std::mutex _resize_mtx;
+
+    // Stripe of the previous table that is being swept
+    std::size_t _sweep_stripe;
+
+    // Fraction of memory limit stripes are allowed to use, see SetLimitScale
+    double _limit_scale;
+
+    // Shared by stripes of all tables, so that tag of the migrated item stays valid
+    std::shared_ptr<TagRegistry> _tags;
+
+    // Most accessed keys of all stripes, nullptr if they are not tracked
+    std::shared_ptr<HeavyHitters> _hot;
+
+    // Operation counters of the tables freed already
+    StorageStats _retired_stats;
+
+    // Every request is routed under its guard, so the previous table is freed only after requests
+    // that could see it are complete
+    Concurrency::EpochManager _epoch;
+    std::atomic<Table *> _table;
+
+    // Lock counters of the table as of the last contention check, accessed by background thread only
+    std::chrono::steady_clock::time_point _checked_at;
+    Table *_checked_table;
+    uint64_t _checked_acquired;
+    uint64_t _checked_contended;
 };
 
-}
-}
-#endif // AFINA_STORAGE_STRIPED_LOCK_LRU_H
\ No newline at end of file
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_STRIPED_LOCK_LRU_H
@@ -0,0 +1,124 @@
+#include "TagRegistry.h"
+
+#include <stdexcept>
+
+#include <afina/KeyHash.h>
+
+namespace Afina {
+namespace Backend {
+
+// See TagRegistry.h
+TagRegistry::TagRegistry(std::size_t max_tags)
+    : _shard_size(max_tags / kShards), _flushes(0), _flush_at(0) {
+    if (_shard_size == 0 || max_tags > kMaxTags) {
+        throw std::runtime_error("parameters are set incorrectly");
+    }
+    for (std::size_t i = 0; i < kShards; i++) {
+        _shards[i].oldest = 0;
+    }
+    for (std::size_t i = 0; i < kSegments; i++) {
+        _segments[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+// See TagRegistry.h
+TagRegistry::~TagRegistry() {
+    for (std::size_t i = 0; i < kSegments; i++) {
+        delete[] _segments[i].load(std::memory_order_relaxed);
+    }
+}
+
+// See TagRegistry.h
+ItemTag TagRegistry::Resolve(const std::string &tag) {
+    const std::size_t shard_id = HashKey(tag.data(), tag.size()) % kShards;
+    Shard &shard = _shards[shard_id];
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.ids.find(tag);
+    if (it != shard.ids.end()) {
+        return ItemTag(it->second, Counter(it->second).load(std::memory_order_acquire), Flushes());
+    }
+
+    std::size_t slot = shard.names.size();
+    if (slot < _shard_size) {
+        shard.names.push_back(tag);
+    } else {
+        // Forgotten tag is invalidated, new one starts from the generation after, so that its items can't be
+        // confused with items of the old one
+        slot = shard.oldest;
+        shard.oldest = (shard.oldest + 1) % _shard_size;
+        auto old = shard.ids.find(shard.names[slot]);
+        Counter(old->second).fetch_add(1, std::memory_order_acq_rel);
+        shard.ids.erase(old);
+        shard.names[slot] = tag;
+    }
+
+    uint32_t id = shard_id + kShards * (slot + 1);
+    Allocate(id);
+    shard.ids.emplace(tag, id);
+    return ItemTag(id, Counter(id).load(std::memory_order_acquire), Flushes());
+}
+
+void TagRegistry::Allocate(uint32_t id) {
+    std::atomic<uint32_t> *expected = nullptr;
+    std::size_t segment = id >> kSegmentBits;
+    if (_segments[segment].load(std::memory_order_acquire) != nullptr) {
+        return;
+    }
+
+    // Shards share segments, the one that loses the race frees its copy
+    std::atomic<uint32_t> *counters = new std::atomic<uint32_t>[kSegmentSize];
+    for (std::size_t i = 0; i < kSegmentSize; i++) {
+        counters[i].store(0, std::memory_order_relaxed);
+    }
+    if (!_segments[segment].compare_exchange_strong(expected, counters, std::memory_order_acq_rel)) {
+        delete[] counters;
+    }
+}
+
+// See TagRegistry.h
+void TagRegistry::Invalidate(const std::string &tag) {
+    Shard &shard = _shards[HashKey(tag.data(), tag.size()) % kShards];
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.ids.find(tag);
+    if (it != shard.ids.end()) {
+        Counter(it->second).fetch_add(1, std::memory_order_acq_rel);
+    }
+}
+
+// See TagRegistry.h
+void TagRegistry::Flush(std::chrono::steady_clock::duration delay) {
+    if (delay.count() <= 0) {
+        _flush_at.store(0, std::memory_order_relaxed);
+        _flushes.fetch_add(1, std::memory_order_acq_rel);
+        return;
+    }
+
+    // 0 means there is no pending flush
+    int64_t at = (std::chrono::steady_clock::now() + delay).time_since_epoch().count();
+    _flush_at.store(at != 0 ? at : 1, std::memory_order_relaxed);
+}
+
+void TagRegistry::ApplyDelayedFlush() const {
+    int64_t at = _flush_at.load(std::memory_order_relaxed);
+    if (at == 0 || std::chrono::steady_clock::now().time_since_epoch().count() < at) {
+        return;
+    }
+
+    // Only the one who clears the deadline counts the flush
+    if (_flush_at.compare_exchange_strong(at, 0, std::memory_order_relaxed)) {
+        _flushes.fetch_add(1, std::memory_order_acq_rel);
+    }
+}
+
+// See TagRegistry.h
+std::size_t TagRegistry::size() {
+    std::size_t result = 0;
+    for (std::size_t i = 0; i < kShards; i++) {
+        std::lock_guard<std::mutex> lock(_shards[i].mtx);
+        result += _shards[i].ids.size();
+    }
+    return result;
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,151 @@
+#ifndef AFINA_STORAGE_TAG_REGISTRY_H
+#define AFINA_STORAGE_TAG_REGISTRY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Afina {
+namespace Backend {
+
+// Tag of the item: id of the tag and its generation at the moment item was stored, id 0 means no tag. Number
+// of flushes is remembered the same way for every item
+struct ItemTag {
+    ItemTag() : id(0), generation(0), flushes(0) {}
+    ItemTag(uint32_t id, uint32_t generation, uint32_t flushes) : id(id), generation(generation), flushes(flushes) {}
+
+    uint32_t id;
+    uint32_t generation;
+    uint32_t flushes;
+};
+
+/**
+ * # Generation counters of item tags
+ * Every tag name gets an id on the first use, and every id has a generation counter. Item remembers generation
+ * of its tag when it is stored, invalidation of the tag just increments the counter, so it costs O(1) regardless
+ * of how many items carry the tag. Items whose generation is behind are treated as absent by the next access
+ * and dropped by it.
+ *
+ * Flush of the whole storage works the same way: there is the global counter of flushes, and every item is stale
+ * once it is behind. Delayed flush just remembers its deadline, the first access after it increments the counter.
+ *
+ * Registry is shared by all stripes of the storage. Names are split into shards by hash, each one resolved under
+ * its own mutex and owning its own ids, so that puts of different tags rarely meet. Generations are read lock
+ * free: counters live in segments that are allocated once and never moved, so the array of segments only grows.
+ *
+ * Number of ids is bounded. Once shard runs out of them, it recycles ids of its tags in the order they were
+ * registered: the oldest tag is forgotten, its counter is incremented, so items still carrying it are stale, and
+ * the id goes to the new tag. Cache is free to drop items, so the registry never fails.
+ */
+class TagRegistry {
+public:
+    // Counters per segment, maximum number of segments and number of shards of names. Ids 0..kShards-1 are never
+    // given out, 0 is reserved for items without tag, so that registry keeps ids for kMaxTags tags at most
+    enum : std::size_t {
+        kSegmentBits = 12,
+        kSegmentSize = std::size_t(1) << kSegmentBits,
+        kSegments = 256,
+        kShards = 16,
+        kMaxTags = kSegments * kSegmentSize - kShards
+    };
+
+    /**
+     * @param max_tags number of tags registry keeps ids for, at least one per shard and no more than kMaxTags
+     */
+    explicit TagRegistry(std::size_t max_tags = kMaxTags);
+    ~TagRegistry();
+
+    /**
+     * Current tag of the item stored with the given tag, registering it on the first use. If there are too many
+     * tags, the oldest tag of the same shard is forgotten and its items get stale. Generation is read along with
+     * the id, so that item racing with recycling of the id is stale rather than taken by the new tag
+     */
+    ItemTag Resolve(const std::string &tag);
+
+    /**
+     * Current tag of the item stored without tag
+     */
+    inline ItemTag Untagged() const { return ItemTag(0, 0, Flushes()); }
+
+    /**
+     * True if tag of the item was invalidated or storage was flushed since it was stored
+     */
+    inline bool Stale(const ItemTag &tag) const { return Stale(tag, Flushes()); }
+
+    /**
+     * Same as above for the number of flushes caller got from Flushes, so that checks of a batch of items don't
+     * look at the clock each time delayed flush is pending
+     */
+    inline bool Stale(const ItemTag &tag, uint32_t flushes) const {
+        return tag.flushes != flushes ||
+               (tag.id != 0 && Counter(tag.id).load(std::memory_order_acquire) != tag.generation);
+    }
+
+    /**
+     * Makes all items carrying the tag so far stale. Tag that was never used has no items to invalidate
+     */
+    void Invalidate(const std::string &tag);
+
+    /**
+     * Makes all items stored so far stale, once delay is over. Delayed flush replaces the one that is still
+     * pending, zero delay flushes right now
+     */
+    void Flush(std::chrono::steady_clock::duration delay);
+
+    /**
+     * Number of flushes so far, delayed flush is counted once its deadline passes
+     */
+    inline uint32_t Flushes() const {
+        if (_flush_at.load(std::memory_order_relaxed) != 0) {
+            ApplyDelayedFlush();
+        }
+        return _flushes.load(std::memory_order_acquire);
+    }
+
+    // Number of tags known right now
+    std::size_t size();
+
+private:
+    TagRegistry(const TagRegistry &);            // = delete;
+    TagRegistry &operator=(const TagRegistry &); // = delete;
+
+    // Names of the shard, shard s owns ids s + kShards * (k + 1), where k is the slot of the name
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, uint32_t> ids;
+
+        // Name by slot, in the order slots were taken, and the slot to recycle next once all are taken
+        std::vector<std::string> names;
+        std::size_t oldest;
+    };
+
+    void ApplyDelayedFlush() const;
+
+    inline std::atomic<uint32_t> &Counter(uint32_t id) const {
+        return _segments[id >> kSegmentBits].load(std::memory_order_acquire)[id & (kSegmentSize - 1)];
+    }
+
+    // Makes sure counter of the id is allocated
+    void Allocate(uint32_t id);
+
+    // Number of slots each shard has
+    const std::size_t _shard_size;
+    Shard _shards[kShards];
+
+    std::atomic<std::atomic<uint32_t> *> _segments[kSegments];
+
+    // Counter of flushes and the deadline of the pending one in steady clock ticks, 0 if there is none. Deadline
+    // is applied by whoever notices it has passed, so both are mutable
+    mutable std::atomic<uint32_t> _flushes;
+    mutable std::atomic<int64_t> _flush_at;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_TAG_REGISTRY_H
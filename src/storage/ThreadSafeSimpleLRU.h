@@ -1,10 +1,17 @@
 #ifndef AFINA_STORAGE_THREAD_SAFE_SIMPLE_LRU_H
 #define AFINA_STORAGE_THREAD_SAFE_SIMPLE_LRU_H
 
+#include <atomic>
+#include <chrono>
 #include <map>
 #include <mutex>
 #include <string>
+#include <vector>
 
+#include "BackgroundWorker.h"
+#include "Config.h"
+#include "CuckooFilter.h"
+#include "Policies.h"
 #include "SimpleLRU.h"
 
 namespace Afina {
@@ -13,53 +20,543 @@ namespace Backend {
 /**
  * # SimpleLRU thread safe version
  *
+ * In write behind mode Put doesn't wait for the lock: mutation is pushed into lock free queue and
+ * applied in batch by whoever takes the lock next, or by the background thread. Every locked
+ * operation drains the queue first, so reads always observe all completed Puts. Set, PutIfAbsent and
+ * Delete results depend on the current state, so those are applied under the lock as usual. Queued Put is
+ * best effort: it succeeds once the item fits into the capacity storage was created with, but it is dropped
+ * if the limit shrinks below the item size before the queue is applied.
  *
+ * With watermarks configured background thread keeps storage below the low watermark, evicting the oldest
+ * items in small batches and releasing lock in between, so that large Put doesn't have to evict thousands
+ * of items inline while every other client waits for the lock.
+ *
+ * With filter enabled Get, Set and Delete of the absent key are answered by the lock free cuckoo filter
+ * lookup. Once filter overflows it is replaced by the twice larger one by the background thread, old
+ * filters are kept until storage is destroyed since readers may still be looking at them.
+ *
+ * Lock type and the underlying cache are template parameters, class is final so that calls made on the concrete
+ * type, i.e. by StripedLockLRU on its stripes, are direct. ThreadSafeSimplLRU is the mutex based one.
  */
-class ThreadSafeSimplLRU : public SimpleLRU {
+template <typename Mutex = std::mutex, typename Base = SimpleLRU> class ThreadSafeLRU final : public Base {
+private:
+    // Queued Put, hash is 0 if it isn't known
+    struct Mutation {
+        std::string key;
+        uint64_t hash;
+        Value value;
+        Mutation *next;
+    };
+
 public:
-    ThreadSafeSimplLRU(size_t max_size = 1024) : SimpleLRU(max_size) {}
-    ~ThreadSafeSimplLRU() {}
+    ThreadSafeLRU(size_t max_size = 1024, const Config &config = Config())
+        : Base(max_size, config.arena), _write_behind(config.write_behind),
+          _capacity(max_size), _low_fraction(config.low_watermark), _high_fraction(config.high_watermark),
+          _low_watermark(config.low_watermark * max_size), _high_watermark(config.high_watermark * max_size),
+          _pending(nullptr), _reclaim(false), _swept(0), _sweeping(false), _sweep_flushes(0),
+          _worker([this]() { return Maintain(); }, std::chrono::milliseconds(1)),
+          _notify(&_worker), _filter(nullptr) {
+        if (config.filter && !config.write_behind) {
+            // Assume items are not smaller than that on average, filter grows if they are
+            const std::size_t item_size = 64;
+            InstallFilter(new CuckooFilter(max_size / item_size));
+        }
+        if (config.dedup_threshold > 0) {
+            this->EnableDedup(config.dedup_threshold);
+        }
+        if (config.mrc_sample_rate > 0) {
+            this->EnableMissRatioCurve(config.mrc_sample_rate);
+        }
+        if (config.hot_keys > 0) {
+            this->SetHeavyHitters(std::make_shared<HeavyHitters>(config.hot_keys));
+        }
+    }
+
+    ~ThreadSafeLRU() {
+        Stop();
+        ApplyPending();
+    }
 
     // see SimpleLRU.h
-    bool Put(const std::string &key, const std::string &value) override {
-        // Sinchronization
-        std::lock_guard<std::mutex> lk(_mtx);
-        return SimpleLRU::Put(key, value);
+    void Start() override {
+        Base::Start();
+        if (_write_behind || _high_fraction > 0 || _filter.load() != nullptr) {
+            _worker.Start();
+        }
     }
 
+    // see SimpleLRU.h
+    void Stop() override { _worker.Stop(); }
+
+    // see SimpleLRU.h. In write behind mode buffer of the moved in value goes into the queue as it is
+    bool Put(const std::string &key, const std::string &value) override { return DoPut(key, 0, value); }
+    bool Put(const std::string &key, std::string &&value) override { return DoPut(key, 0, std::move(value)); }
+
+    // see SimpleLRU.h
+    bool Put(const std::string &key, uint64_t hash, const std::string &value) override {
+        return DoPut(key, hash, value);
+    }
+    bool Put(const std::string &key, uint64_t hash, std::string &&value) { return DoPut(key, hash, std::move(value)); }
+
     // see SimpleLRU.h
     bool PutIfAbsent(const std::string &key, const std::string &value) override {
+        return PutIfAbsent(key, 0, value);
+    }
+
+    // see SimpleLRU.h
+    bool PutIfAbsent(const std::string &key, uint64_t hash, const std::string &value) override {
         // Sinchronization
-        std::lock_guard<std::mutex> lk(_mtx);
-        return SimpleLRU::PutIfAbsent(key, value);
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        bool result = Base::PutIfAbsent(key, hash, value);
+        CheckPressure();
+        return result;
     }
 
     // see SimpleLRU.h
-    bool Set(const std::string &key, const std::string &value) override {
+    bool Set(const std::string &key, const std::string &value) override { return Set(key, 0, value); }
+
+    // see SimpleLRU.h
+    bool Set(const std::string &key, uint64_t hash, const std::string &value) override {
+        if (!MayContain(key, hash)) {
+            this->counters().Add(Counters::kCmdSet);
+            this->counters().Add(Counters::kFilterMisses);
+            return false;
+        }
+
         // Sinchronization
-        std::lock_guard<std::mutex> lk(_mtx);
-        return SimpleLRU::Set(key, value);
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        bool result = Base::Set(key, hash, value);
+        CheckPressure();
+        return result;
     }
 
     // see SimpleLRU.h
-    bool Delete(const std::string &key) override {
+    bool Delete(const std::string &key) override { return Delete(key, 0); }
+
+    // see SimpleLRU.h
+    bool Delete(const std::string &key, uint64_t hash) override {
+        if (!MayContain(key, hash)) {
+            this->counters().Add(Counters::kDeleteMisses);
+            this->counters().Add(Counters::kFilterMisses);
+            return false;
+        }
+
         // Sinchronization
-        std::lock_guard<std::mutex> lk(_mtx);
-        return SimpleLRU::Delete(key);
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        return Base::Delete(key, hash);
     }
 
     // see SimpleLRU.h
-    bool Get(const std::string &key, std::string &value) override {
+    bool Get(const std::string &key, std::string &value) override { return Get(key, 0, value); }
+
+    // see SimpleLRU.h
+    bool Get(const std::string &key, uint64_t hash, std::string &value) override {
+        if (!MayContain(key, hash)) {
+            this->counters().Add(Counters::kGetMisses);
+            this->counters().Add(Counters::kFilterMisses);
+            return false;
+        }
+
         // Sinchronization
-        std::lock_guard<std::mutex> lk(_mtx);
-        return SimpleLRU::Get(key, value);
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        return Base::Get(key, hash, value);
+    }
+
+    // see SimpleLRU.h, in write behind mode value is queued the same way Put does, chunks are moved into the queue
+    bool PutValue(const std::string &key, Value value) override { return PutValue(key, 0, std::move(value)); }
+
+    // see SimpleLRU.h
+    bool PutValue(const std::string &key, uint64_t hash, Value value) override {
+        if (_write_behind) {
+            return Enqueue(key, hash, std::move(value));
+        }
+
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        bool result = Base::PutValue(key, hash, std::move(value));
+        CheckPressure();
+        return result;
+    }
+
+    // see SimpleLRU.h
+    bool GetValue(const std::string &key, Value &value) override { return GetValue(key, 0, value); }
+
+    // see SimpleLRU.h
+    bool GetValue(const std::string &key, uint64_t hash, Value &value) override {
+        if (!MayContain(key, hash)) {
+            this->counters().Add(Counters::kGetMisses);
+            this->counters().Add(Counters::kFilterMisses);
+            return false;
+        }
+
+        // Sinchronization
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        return Base::GetValue(key, hash, value);
+    }
+
+    // see SimpleLRU.h
+    bool GetItem(const std::string &key, Value &out) override { return GetItem(key, 0, out); }
+
+    // see SimpleLRU.h
+    bool GetItem(const std::string &key, uint64_t hash, Value &out) override {
+        if (!MayContain(key, hash)) {
+            this->counters().Add(Counters::kGetMisses);
+            this->counters().Add(Counters::kFilterMisses);
+            return false;
+        }
+
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        return Base::GetItem(key, hash, out);
+    }
+
+    // see SimpleLRU.h, mutation runs under the lock, so that concurrent read-modify-writes never lose updates
+    bool Compute(const std::string &key, const Afina::Storage::Mutation &mutation) override {
+        return Compute(key, 0, mutation);
+    }
+
+    // see SimpleLRU.h
+    bool Compute(const std::string &key, uint64_t hash, const Afina::Storage::Mutation &mutation) override {
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        bool result = Base::Compute(key, hash, mutation);
+        CheckPressure();
+        return result;
+    }
+
+    // see SimpleLRU.h
+    bool Append(const std::string &key, Value data) override { return Append(key, 0, std::move(data)); }
+
+    // see SimpleLRU.h
+    bool Append(const std::string &key, uint64_t hash, Value data) override {
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        bool result = Base::Append(key, hash, std::move(data));
+        CheckPressure();
+        return result;
+    }
+
+    // see SimpleLRU.h
+    bool Prepend(const std::string &key, Value data) override { return Prepend(key, 0, std::move(data)); }
+
+    // see SimpleLRU.h
+    bool Prepend(const std::string &key, uint64_t hash, Value data) override {
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        bool result = Base::Prepend(key, hash, std::move(data));
+        CheckPressure();
+        return result;
+    }
+
+    // see SimpleLRU.h, queued puts are applied first, so that they are flushed as well
+    bool FlushAll(uint32_t delay) override {
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        bool result = Base::FlushAll(delay);
+        _notify->Wakeup();
+        return result;
+    }
+
+    // see SimpleLRU.h
+    bool DeletePrefix(const std::string &prefix, std::size_t &deleted) override {
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        return Base::DeletePrefix(prefix, deleted);
+    }
+
+    // see SimpleLRU.h, tagged items are never queued in write behind mode, the same way large values are not
+    bool PutTagged(const std::string &key, const std::string &value, const std::string &tag) override {
+        return PutTagged(key, 0, value, tag);
+    }
+
+    // see SimpleLRU.h
+    bool PutTagged(const std::string &key, uint64_t hash, const std::string &value, const std::string &tag) override {
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        bool result = Base::PutTagged(key, hash, value, tag);
+        CheckPressure();
+        return result;
+    }
+
+    // Implements Afina::Storage interface. Items above the new limit are evicted by the calling thread in small
+    // batches, lock is released in between so that requests go on. Watermarks follow the limit. Scale outside
+    // of (0, 1] is rejected
+    bool SetLimitScale(double scale) override {
+        if (!(scale > 0 && scale <= 1)) {
+            return false;
+        }
+
+        {
+            std::lock_guard<Mutex> lk(_mtx);
+            ApplyPendingLocked();
+            const std::size_t limit = scale * _capacity;
+            this->SetMaxSize(limit);
+            _low_watermark = _low_fraction * limit;
+            _high_watermark = _high_fraction * limit;
+        }
+
+        for (;;) {
+            std::lock_guard<Mutex> lk(_mtx);
+            if (this->size() <= this->max_size() || Base::Evict(this->max_size(), kEvictBatch) == 0) {
+                CheckPressure();
+                return true;
+            }
+        }
+    }
+
+    /**
+     * Limits the cache to the bytes it holds right now, so that it never grows anymore. Returns that size
+     */
+    std::size_t Freeze() {
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        this->SetMaxSize(this->size());
+        return this->size();
+    }
+
+    // see SimpleLRU.h
+    void Snapshot(StorageStats &stats) override {
+        std::lock_guard<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        Base::Snapshot(stats);
+    }
+
+    /**
+     * Applies queued mutations if there are any, returns true if something was applied
+     */
+    bool ApplyPending() {
+        if (_pending.load(std::memory_order_relaxed) == nullptr) {
+            return false;
+        }
+        std::lock_guard<Mutex> lk(_mtx);
+        return ApplyPendingLocked();
+    }
+
+    /**
+     * Evicts a single batch of items if storage is above watermarks, returns true if more work left
+     */
+    bool Reclaim() {
+        if (!_reclaim.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        std::lock_guard<Mutex> lk(_mtx);
+        Base::Evict(_low_watermark, kEvictBatch);
+        if (this->size() <= _low_watermark) {
+            _reclaim.store(false, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Removes a single batch of flushed items, returns true if more work left
+     */
+    bool DropFlushed() {
+        uint32_t flushes = this->flushes();
+        if (!_sweeping.load(std::memory_order_relaxed) && _swept.load(std::memory_order_relaxed) == flushes) {
+            return false;
+        }
+
+        // Pass covers flushes made before it started only, the later ones need another one
+        std::lock_guard<Mutex> lk(_mtx);
+        if (!_sweeping.load(std::memory_order_relaxed)) {
+            _sweeping.store(true, std::memory_order_relaxed);
+            _sweep_flushes = flushes;
+        }
+        std::size_t dropped;
+        if (Base::DropStale(kEvictBatch, dropped)) {
+            return true;
+        }
+        _sweeping.store(false, std::memory_order_relaxed);
+        _swept.store(_sweep_flushes, std::memory_order_relaxed);
+        return _sweep_flushes != flushes;
+    }
+
+    /**
+     * Single step of the background work, returns true if there is more to do
+     */
+    bool Maintain() {
+        bool applied = ApplyPending();
+        bool evicted = Reclaim();
+        bool dropped = DropFlushed();
+        RebuildFilter();
+        return applied || evicted || dropped;
+    }
+
+    /**
+     * Replaces overflown filter with the larger one, returns true if filter was rebuilt
+     */
+    bool RebuildFilter() {
+        CuckooFilter *filter = _filter.load(std::memory_order_relaxed);
+        if (filter == nullptr || !filter->overflow()) {
+            return false;
+        }
+
+        std::lock_guard<Mutex> lk(_mtx);
+        InstallFilter(new CuckooFilter(2 * std::max(this->count(), filter->capacity())));
+        return true;
+    }
+
+    /**
+     * Takes the lock with all queued mutations applied. While it is held plain SimpleLRU methods could be
+     * called directly, i.e. to move items between stripes atomically
+     */
+    std::unique_lock<Mutex> Lock() {
+        std::unique_lock<Mutex> lk(_mtx);
+        ApplyPendingLocked();
+        return lk;
+    }
+
+    /**
+     * Background work of the stripe is done by the given worker, it is woken up once watermark is crossed
+     */
+    void SetBackgroundWorker(BackgroundWorker *worker) { _notify = worker; }
+
+    /**
+     * Number of times the lock was taken and how many of them had to wait, only for CountingLock
+     */
+    void Contention(uint64_t &acquired, uint64_t &contended) const {
+        acquired = _mtx.acquired();
+        contended = _mtx.contended();
     }
 
 private:
+    // Number of items evicted by background thread in one lock hold
+    static const std::size_t kEvictBatch = 64;
+
+    // False if key is definitely absent, called without lock. Hash 0 means it is unknown
+    bool MayContain(const std::string &key, uint64_t hash = 0) const {
+        CuckooFilter *filter = _filter.load(std::memory_order_acquire);
+        return filter == nullptr ||
+               filter->MayContain(hash != 0 ? hash : CuckooFilter::Hash(key.data(), key.size()));
+    }
+
+    // Must be called under _mtx or before storage is shared
+    void InstallFilter(CuckooFilter *filter) {
+        _filters.emplace_back(filter);
+        this->AttachFilter(filter);
+        _filter.store(filter, std::memory_order_release);
+    }
+
+    // Must be called under _mtx after storage grows
+    void CheckPressure() {
+        CuckooFilter *filter = _filter.load(std::memory_order_relaxed);
+        if (filter != nullptr && filter->overflow()) {
+            _notify->Wakeup();
+        }
+
+        if (_high_watermark > 0 && this->size() > _high_watermark && !_reclaim.load(std::memory_order_relaxed)) {
+            _reclaim.store(true, std::memory_order_relaxed);
+            _notify->Wakeup();
+        }
+    }
+
+    // Value is forwarded as it came, so that moved in one is moved into the queue
+    template <typename S> bool DoPut(const std::string &key, uint64_t hash, S &&value) {
+        if (!_write_behind) {
+            std::lock_guard<Mutex> lk(_mtx);
+            bool result = Base::Put(key, hash, value);
+            CheckPressure();
+            return result;
+        }
+
+        return Enqueue(key, hash, Value(std::forward<S>(value)));
+    }
+
+    // Queues put in write behind mode, queue is applied right away if the lock is free. Current limit could be
+    // changed under the lock only, so the item is checked against the capacity
+    bool Enqueue(const std::string &key, uint64_t hash, Value value) {
+        if (key.size() + value.size() > _capacity) {
+            return false;
+        }
+
+        Mutation *mutation = new Mutation{key, hash, std::move(value), _pending.load(std::memory_order_relaxed)};
+        while (!_pending.compare_exchange_weak(mutation->next, mutation, std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+        }
+
+        // Lock is busy: its owner or background thread will apply the mutation
+        std::unique_lock<Mutex> lk(_mtx, std::try_to_lock);
+        if (lk.owns_lock()) {
+            ApplyPendingLocked();
+        }
+        return true;
+    }
+
+    // Must be called under _mtx
+    bool ApplyPendingLocked() {
+        Mutation *batch = _pending.exchange(nullptr, std::memory_order_acquire);
+        if (batch == nullptr) {
+            return false;
+        }
+
+        // Queue is a stack, restore order in which mutations were issued
+        Mutation *ordered = nullptr;
+        while (batch != nullptr) {
+            Mutation *next = batch->next;
+            batch->next = ordered;
+            ordered = batch;
+            batch = next;
+        }
+
+        while (ordered != nullptr) {
+            Mutation *next = ordered->next;
+            // Put fails only if the limit shrank below the item size since it was queued
+            Base::PutValue(ordered->key, ordered->hash, std::move(ordered->value));
+            delete ordered;
+            ordered = next;
+        }
+        CheckPressure();
+        return true;
+    }
+
     // Sinchronization primitives
-    std::mutex _mtx;
+    Mutex _mtx;
+
+    const bool _write_behind;
+
+    // Limit storage was created with, and watermarks as fractions of the current limit
+    const std::size_t _capacity;
+    const double _low_fraction;
+    const double _high_fraction;
+
+    // Background eviction thresholds in bytes, 0 if disabled. Change along with the limit under _mtx
+    std::size_t _low_watermark;
+    std::size_t _high_watermark;
+
+    // Queued mutations, newest first
+    std::atomic<Mutation *> _pending;
+
+    // Storage crossed high watermark and didn't get down to the low one yet
+    std::atomic<bool> _reclaim;
+
+    // Number of flushes whose items are all removed by background thread
+    std::atomic<uint32_t> _swept;
+
+    // Pass of DropStale is in progress, and number of flushes when it started. The latter is guarded by _mtx
+    std::atomic<bool> _sweeping;
+    uint32_t _sweep_flushes;
+
+    // Background applier of the queued mutations and reclaimer
+    BackgroundWorker _worker;
+
+    // Worker to wake up once watermark is crossed or filter overflows
+    BackgroundWorker *_notify;
+
+    // Current filter, nullptr if disabled. All filters ever installed are owned by _filters
+    std::atomic<CuckooFilter *> _filter;
+    std::vector<std::unique_ptr<CuckooFilter>> _filters;
 };
 
+// Stripes of StripedLockLRU count lock contention, so that it knows when to split them further
+using ThreadSafeSimplLRU = ThreadSafeLRU<CountingLock<std::mutex>, SimpleLRU>;
+
 } // namespace Backend
 } // namespace Afina
 
@@ -0,0 +1,166 @@
+#include "ValueTable.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "CuckooFilter.h"
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// Hash of the bytes is combined from hashes of kChunkSize blocks, so that it doesn't depend on whether bytes
+// came as a string or as a value split into chunks
+uint64_t Combine(uint64_t h, const char *data, std::size_t size) {
+    return (h ^ CuckooFilter::Hash(data, size)) * 0x9e3779b97f4a7c15ULL;
+}
+
+uint64_t HashBytes(const char *data, std::size_t size) {
+    uint64_t h = size;
+    do {
+        std::size_t block = size < Value::kChunkSize ? size : Value::kChunkSize;
+        h = Combine(h, data, block);
+        data += block;
+        size -= block;
+    } while (size > 0);
+    return h;
+}
+
+// True if every chunk but the last one is full, i.e. chunks are the same blocks HashBytes splits bytes into
+bool Aligned(const Value &value) {
+    for (std::size_t i = 0; i + 1 < value.chunks(); i++) {
+        if (value.chunk(i).size() != Value::kChunkSize) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SameBytes(const Value &value, const char *data, std::size_t size) {
+    if (value.size() != size) {
+        return false;
+    }
+    for (std::size_t i = 0; i < value.chunks(); i++) {
+        const std::string &chunk = value.chunk(i);
+        if (std::memcmp(chunk.data(), data, chunk.size()) != 0) {
+            return false;
+        }
+        data += chunk.size();
+    }
+    return true;
+}
+
+bool SameBytes(const Value &a, const Value &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    std::size_t ia = 0, oa = 0, ib = 0, ob = 0;
+    while (ia < a.chunks() && ib < b.chunks()) {
+        const std::string &ca = a.chunk(ia);
+        const std::string &cb = b.chunk(ib);
+        std::size_t n = std::min(ca.size() - oa, cb.size() - ob);
+        if (std::memcmp(ca.data() + oa, cb.data() + ob, n) != 0) {
+            return false;
+        }
+        oa += n;
+        ob += n;
+        if (oa == ca.size()) {
+            ia++;
+            oa = 0;
+        }
+        if (ob == cb.size()) {
+            ib++;
+            ob = 0;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// See ValueTable.h
+ValueTable::~ValueTable() {
+    for (auto &entry : _entries) {
+        delete entry.second;
+    }
+}
+
+// See ValueTable.h
+ValueTable::Entry *ValueTable::Acquire(const std::string &value, bool &created) {
+    uint64_t hash = HashBytes(value.data(), value.size());
+    auto range = _entries.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (SameBytes(it->second->value, value.data(), value.size())) {
+            created = false;
+            return Reference(it->second);
+        }
+    }
+
+    created = true;
+    return Insert(hash, Value(value));
+}
+
+// See ValueTable.h
+ValueTable::Entry *ValueTable::Acquire(const Value &value, bool &created) {
+    if (!Aligned(value)) {
+        return Acquire(value.str(), created);
+    }
+
+    uint64_t hash = value.size();
+    for (std::size_t i = 0; i < value.chunks(); i++) {
+        hash = Combine(hash, value.chunk(i).data(), value.chunk(i).size());
+    }
+    if (value.empty()) {
+        hash = Combine(hash, "", 0);
+    }
+
+    auto range = _entries.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (SameBytes(it->second->value, value)) {
+            created = false;
+            return Reference(it->second);
+        }
+    }
+
+    // Chunks are shared with the value that is put
+    created = true;
+    return Insert(hash, value);
+}
+
+// See ValueTable.h
+bool ValueTable::Release(Entry *entry) {
+    _refs--;
+    _logical_bytes -= entry->value.size();
+    if (--entry->refs > 0) {
+        return false;
+    }
+
+    auto range = _entries.equal_range(entry->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == entry) {
+            _entries.erase(it);
+            break;
+        }
+    }
+    _bytes -= entry->value.size();
+    delete entry;
+    return true;
+}
+
+ValueTable::Entry *ValueTable::Insert(uint64_t hash, const Value &value) {
+    Entry *entry = new Entry{hash, value, 0};
+    _entries.emplace(hash, entry);
+    _bytes += value.size();
+    return Reference(entry);
+}
+
+ValueTable::Entry *ValueTable::Reference(Entry *entry) {
+    entry->refs++;
+    _refs++;
+    _logical_bytes += entry->value.size();
+    return entry;
+}
+
+} // namespace Backend
+} // namespace Afina
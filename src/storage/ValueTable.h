@@ -0,0 +1,79 @@
+#ifndef AFINA_STORAGE_VALUE_TABLE_H
+#define AFINA_STORAGE_VALUE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include <afina/Value.h>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Content addressed table of shared values
+ * Values that are at least threshold bytes long are looked up by hash of their bytes, items storing the same
+ * bytes refer to the single entry instead of keeping copies. Entry counts items referring to it and is freed
+ * with the last of them. Bytes of the entry are immutable chunks of the Value, so item gets its own copy of
+ * the value sharing those chunks, and replacing value of the item never touches other items: it just drops
+ * its reference, i.e. updates are copy on write.
+ *
+ * NOT thread safe, owner guards the table along with its items.
+ */
+class ValueTable {
+public:
+    struct Entry {
+        uint64_t hash;
+        Value value;
+
+        // Items referring to the entry
+        std::size_t refs;
+    };
+
+    explicit ValueTable(std::size_t threshold) : _threshold(threshold), _bytes(0), _logical_bytes(0), _refs(0) {}
+    ~ValueTable();
+
+    // Values shorter than that are never shared
+    inline std::size_t threshold() const { return _threshold; }
+
+    /**
+     * Returns entry holding the same bytes with one more reference to it, entry is created if there is
+     * none yet
+     */
+    Entry *Acquire(const std::string &value, bool &created);
+    Entry *Acquire(const Value &value, bool &created);
+
+    /**
+     * Drops the reference taken by Acquire, returns true if that was the last one and entry is freed
+     */
+    bool Release(Entry *entry);
+
+    // Number of distinct shared values, and number of references to them
+    inline std::size_t size() const { return _entries.size(); }
+    inline std::size_t refs() const { return _refs; }
+
+    // Bytes of distinct shared values, and bytes that all references would take if each had its own copy
+    inline std::size_t bytes() const { return _bytes; }
+    inline std::size_t logical_bytes() const { return _logical_bytes; }
+
+private:
+    ValueTable(const ValueTable &);            // = delete;
+    ValueTable &operator=(const ValueTable &); // = delete;
+
+    Entry *Insert(uint64_t hash, const Value &value);
+
+    Entry *Reference(Entry *entry);
+
+    const std::size_t _threshold;
+
+    std::unordered_multimap<uint64_t, Entry *> _entries;
+    std::size_t _bytes;
+    std::size_t _logical_bytes;
+    std::size_t _refs;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_VALUE_TABLE_H
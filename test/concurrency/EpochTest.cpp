@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <afina/concurrency/Epoch.h>
+#include <afina/concurrency/ThreadLocal.h>
+
+using namespace Afina::Concurrency;
+
+TEST(ThreadLocalTest, InstancePerThread) {
+    ThreadLocal<int> local;
+    local.get() = 1;
+
+    std::thread([&local]() {
+        EXPECT_EQ(0, local.get());
+        local.get() = 2;
+    }).join();
+
+    EXPECT_EQ(1, local.get());
+
+    int sum = 0;
+    local.for_each([&sum](int &v) { sum += v; });
+    EXPECT_EQ(3, sum);
+}
+
+TEST(ThreadLocalTest, ReuseAfterThreadExit) {
+    ThreadLocal<int> local;
+    for (int i = 0; i < 10; i++) {
+        std::thread([&local]() { local.get()++; }).join();
+    }
+
+    // Dead threads hand their instances over, values are kept
+    int count = 0, sum = 0;
+    local.for_each([&count, &sum](int &v) {
+        count++;
+        sum += v;
+    });
+    EXPECT_EQ(1, count);
+    EXPECT_EQ(10, sum);
+}
+
+namespace {
+
+struct Tracked {
+    explicit Tracked(std::atomic<int> &c) : counter(c) {}
+    ~Tracked() { counter++; }
+    std::atomic<int> &counter;
+};
+
+} // namespace
+
+TEST(EpochTest, RetireWaitsForReaders) {
+    EpochManager epoch;
+    std::atomic<int> deleted(0);
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool entered = false, release = false;
+
+    std::thread reader([&]() {
+        EpochManager::Guard guard(epoch);
+        std::unique_lock<std::mutex> lk(mtx);
+        entered = true;
+        cv.notify_all();
+        cv.wait(lk, [&release]() { return release; });
+    });
+
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk, [&entered]() { return entered; });
+    }
+
+    epoch.Retire(new Tracked(deleted));
+    for (int i = 0; i < 10; i++) {
+        epoch.Collect();
+    }
+    EXPECT_EQ(0, deleted.load());
+    EXPECT_EQ(1, epoch.Pending());
+
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        release = true;
+        cv.notify_all();
+    }
+    reader.join();
+
+    for (int i = 0; i < 3; i++) {
+        epoch.Collect();
+    }
+    EXPECT_EQ(1, deleted.load());
+    EXPECT_EQ(0, epoch.Pending());
+}
+
+TEST(EpochTest, FreeOnDestroy) {
+    std::atomic<int> deleted(0);
+    {
+        EpochManager epoch;
+        for (int i = 0; i < 10; i++) {
+            epoch.Retire(new Tracked(deleted));
+        }
+    }
+    EXPECT_EQ(10, deleted.load());
+}
+
+TEST(EpochTest, SynchronizeWaitsForReaders) {
+    EpochManager epoch;
+    std::atomic<bool> entered(false);
+    std::atomic<bool> left(false);
+
+    std::thread reader([&]() {
+        EpochManager::Guard guard(epoch);
+        entered = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        left = true;
+    });
+
+    while (!entered) {
+        std::this_thread::yield();
+    }
+    epoch.Synchronize();
+    EXPECT_TRUE(left);
+    reader.join();
+
+    // Nothing to wait for
+    epoch.Synchronize();
+}
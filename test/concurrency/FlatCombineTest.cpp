@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <afina/concurrency/FlatCombine.h>
+
+using namespace Afina::Concurrency;
+
+namespace {
+
+struct Increment {
+    int delta;
+    long result;
+};
+
+} // namespace
+
+TEST(FlatCombineTest, SerializesOperations) {
+    // Plain counter, combiner lock is the only protection
+    long counter = 0;
+    FlatCombine<Increment> combiner([&counter](Increment &op) {
+        counter += op.delta;
+        op.result = counter;
+    });
+
+    const int n_threads = 4, n_ops = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; t++) {
+        threads.emplace_back([&combiner]() {
+            for (int i = 0; i < n_ops; i++) {
+                Increment op{1, 0};
+                combiner.Execute(op);
+                EXPECT_GT(op.result, 0);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(n_threads * n_ops, counter);
+}
+
+TEST(FlatCombineTest, RethrowsToCaller) {
+    FlatCombine<Increment> combiner([](Increment &op) {
+        if (op.delta < 0) {
+            throw std::runtime_error("negative");
+        }
+    });
+
+    Increment bad{-1, 0};
+    EXPECT_THROW(combiner.Execute(bad), std::runtime_error);
+
+    Increment good{1, 0};
+    EXPECT_NO_THROW(combiner.Execute(good));
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include <afina/Value.h>
+#include <afina/execute/Get.h>
+#include <afina/execute/Set.h>
+
+#include "storage/SimpleLRU.h"
+#include "storage/ThreadSafeSimpleLRU.h"
+
+namespace {
+
+// Allocations made by this binary since start
+std::atomic<std::size_t> allocations(0);
+std::atomic<std::size_t> allocated_bytes(0);
+
+} // namespace
+
+void *operator new(std::size_t size) {
+    allocations++;
+    allocated_bytes += size;
+    void *ptr = std::malloc(size > 0 ? size : 1);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+using namespace Afina;
+
+namespace {
+
+// Value received the way network layer does it: bytes arrive in pieces of the read buffer
+Value Receive(const std::string &data) {
+    const std::size_t read_size = 4096;
+    Value received;
+    received.Reserve(data.size());
+    for (std::size_t offset = 0; offset < data.size(); offset += read_size) {
+        received.Append(data.data() + offset, std::min(read_size, data.size() - offset));
+    }
+    return received;
+}
+
+} // namespace
+
+TEST(AllocationTest, ReceivedValueIsNotRegrown) {
+    const std::string data(3 * Value::kChunkSize + 100, 'r');
+
+    std::size_t bytes = allocated_bytes;
+    Value received = Receive(data);
+    bytes = allocated_bytes - bytes;
+
+    // Each chunk is allocated once at its final size, growing chunks would allocate about twice as much
+    EXPECT_EQ(data, received.str());
+    EXPECT_EQ(4, received.chunks());
+    EXPECT_LT(bytes, data.size() + 1024);
+}
+
+TEST(AllocationTest, SetMovesValueIntoStorage) {
+    Backend::SimpleLRU storage(16 * 1024 * 1024);
+    Value out;
+
+    // First operation of the thread sets up its counters
+    Execute::Set("WARMUP", 0, 0).ExecuteChunked(storage, Value(std::string("warmup")), out);
+
+    for (std::size_t n_chunks : {2, 20}) {
+        std::string key = "KEY" + std::to_string(n_chunks);
+        Value received = Receive(std::string(n_chunks * Value::kChunkSize, 'v'));
+        const char *first_chunk = received.chunk(0).data();
+        Execute::Set command(key, 0, 0);
+
+        std::size_t count = allocations, bytes = allocated_bytes;
+        command.ExecuteChunked(storage, std::move(received), out);
+        count = allocations - count;
+        bytes = allocated_bytes - bytes;
+
+        // Node, index entry, value holder and the reply, whatever the value size is
+        EXPECT_TRUE(received.empty());
+        EXPECT_EQ("STORED", out.str());
+        EXPECT_LE(count, 8);
+        EXPECT_LT(bytes, 1024);
+
+        // Bytes stored are the very bytes received
+        Value stored;
+        EXPECT_TRUE(storage.GetValue(key, stored));
+        EXPECT_EQ(first_chunk, stored.chunk(0).data());
+        EXPECT_EQ(n_chunks * Value::kChunkSize, stored.size());
+    }
+}
+
+TEST(AllocationTest, PutMovesStringIntoQueue) {
+    Backend::Config config;
+    config.write_behind = true;
+    Backend::ThreadSafeSimplLRU storage(16 * 1024 * 1024, config);
+    storage.Put("WARMUP", std::string("warmup"));
+
+    // Queued put takes the buffer of the moved in string, copied one makes its own copy first
+    const std::size_t size = Value::kChunkSize / 2;
+    std::string copied(size, 'c'), moved(size, 'm');
+    std::size_t copied_bytes = allocated_bytes;
+    EXPECT_TRUE(storage.Put("COPIED", copied));
+    copied_bytes = allocated_bytes - copied_bytes;
+
+    std::size_t moved_bytes = allocated_bytes;
+    EXPECT_TRUE(storage.Put("MOVED", std::move(moved)));
+    moved_bytes = allocated_bytes - moved_bytes;
+
+    EXPECT_GE(copied_bytes, 2 * size);
+    EXPECT_LT(moved_bytes, size + 1024);
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("MOVED", value));
+    EXPECT_EQ(std::string(size, 'm'), value);
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <afina/Value.h>
+#include <afina/execute/Add.h>
+#include <afina/execute/Append.h>
+#include <afina/execute/Get.h>
+#include <afina/execute/Prepend.h>
+#include <afina/execute/Replace.h>
+#include <afina/execute/Set.h>
+
+#include "storage/EpochLRU.h"
+#include "storage/SimpleLRU.h"
+#include "storage/StripedLockLRU.h"
+
+using namespace Afina;
+
+TEST(ChunkedTest, SetGet) {
+    Backend::StripedLockLRU storage(16 * 1024 * 1024, 4);
+    const std::string data(2 * Value::kChunkSize, 'z');
+
+    Value out;
+    Execute::Set("KEY1", 0, 0).ExecuteChunked(storage, Value(data), out);
+    EXPECT_EQ("STORED", out.str());
+
+    Execute::Get({"KEY1", "KEY2"}).ExecuteChunked(storage, Value(), out);
+    EXPECT_EQ("VALUE KEY1 0 " + std::to_string(data.size()) + "\r\n" + data + "\r\nEND", out.str());
+
+    // Flat execution gives the same response
+    std::string flat;
+    Execute::Get({"KEY1"}).Execute(storage, "", flat);
+    EXPECT_EQ(out.str(), flat);
+}
+
+TEST(ChunkedTest, PreformattedItems) {
+    // Items kept in the response form give the same response as formatted ones
+    Backend::SimpleLRU preformatted(1024);
+    Backend::EpochLRU formatted(1024);
+    for (Storage *storage : {static_cast<Storage *>(&preformatted), static_cast<Storage *>(&formatted)}) {
+        Value out;
+        Execute::Set("KEY1", 0, 0).ExecuteChunked(*storage, Value("value"), out);
+        Execute::Set("KEY2", 0, 0).ExecuteChunked(*storage, Value(""), out);
+        Execute::Get({"KEY1", "KEY3", "KEY2"}).ExecuteChunked(*storage, Value(), out);
+        EXPECT_EQ("VALUE KEY1 0 5\r\nvalue\r\nVALUE KEY2 0 0\r\n\r\nEND", out.str());
+
+        // Header follows the size of the new value
+        Execute::Set("KEY1", 0, 0).ExecuteChunked(*storage, Value("longer value"), out);
+        std::string flat;
+        Execute::Get({"KEY1"}).Execute(*storage, "", flat);
+        EXPECT_EQ("VALUE KEY1 0 12\r\nlonger value\r\nEND", flat);
+    }
+}
+
+TEST(ChunkedTest, ReadModifyWrite) {
+    Backend::StripedLockLRU storage(16 * 1024 * 1024, 4);
+    const std::string data(2 * Value::kChunkSize, 'z');
+
+    std::string out;
+    Execute::Replace("KEY1", 0, 0).Execute(storage, "value", out);
+    EXPECT_EQ("NOT_STORED", out);
+    Execute::Append("KEY1", 0, 0).Execute(storage, "value", out);
+    EXPECT_EQ("NOT_STORED", out);
+    Execute::Add("KEY1", 0, 0).Execute(storage, data, out);
+    EXPECT_EQ("STORED", out);
+    Execute::Add("KEY1", 0, 0).Execute(storage, "value", out);
+    EXPECT_EQ("NOT_STORED", out);
+
+    // Large value gets the appended bytes without being flattened
+    Execute::Append("KEY1", 0, 0).Execute(storage, "tail", out);
+    EXPECT_EQ("STORED", out);
+    Value value;
+    EXPECT_TRUE(storage.GetValue("KEY1", value));
+    EXPECT_EQ(data + "tail", value.str());
+    EXPECT_EQ(3, value.chunks());
+
+    Execute::Replace("KEY1", 0, 0).Execute(storage, "value", out);
+    EXPECT_EQ("STORED", out);
+    std::string flat;
+    EXPECT_TRUE(storage.Get("KEY1", flat));
+    EXPECT_EQ("value", flat);
+}
+
+TEST(ChunkedTest, AppendPrepend) {
+    Backend::StripedLockLRU storage(16 * 1024 * 1024, 4);
+    const std::string data(2 * Value::kChunkSize, 'z');
+
+    Value out;
+    Execute::Prepend("KEY1", 0, 0).ExecuteChunked(storage, Value("head"), out);
+    EXPECT_EQ("NOT_STORED", out.str());
+    Execute::Set("KEY1", 0, 0).ExecuteChunked(storage, Value("body"), out);
+    Execute::Prepend("KEY1", 0, 0).ExecuteChunked(storage, Value("head"), out);
+    EXPECT_EQ("STORED", out.str());
+    Execute::Append("KEY1", 0, 0).ExecuteChunked(storage, Value(data), out);
+    EXPECT_EQ("STORED", out.str());
+
+    Execute::Get({"KEY1"}).ExecuteChunked(storage, Value(), out);
+    EXPECT_EQ("VALUE KEY1 0 " + std::to_string(8 + data.size()) + "\r\nheadbody" + data + "\r\nEND", out.str());
+}
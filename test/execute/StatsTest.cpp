@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <afina/execute/Stats.h>
+
+#include "storage/SimpleLRU.h"
+#include "storage/StripedLockLRU.h"
+
+using namespace Afina;
+
+TEST(StatsTest, Counters) {
+    Backend::SimpleLRU storage(100);
+    std::string value;
+    storage.Put("KEY1", "val1");
+    storage.Get("KEY1", value);
+    storage.Get("KEY2", value);
+    storage.Delete("KEY2");
+    storage.Put("KEY2", std::string(90, 'x'));
+
+    std::string out;
+    Execute::Stats().Execute(storage, "", out);
+    EXPECT_NE(std::string::npos, out.find("STAT cmd_get 2\r\n"));
+    EXPECT_NE(std::string::npos, out.find("STAT get_hits 1\r\n"));
+    EXPECT_NE(std::string::npos, out.find("STAT get_misses 1\r\n"));
+    EXPECT_NE(std::string::npos, out.find("STAT cmd_set 2\r\n"));
+    EXPECT_NE(std::string::npos, out.find("STAT delete_misses 1\r\n"));
+    EXPECT_NE(std::string::npos, out.find("STAT evictions 1\r\n"));
+    EXPECT_NE(std::string::npos, out.find("STAT curr_items 1\r\n"));
+    EXPECT_NE(std::string::npos, out.find("STAT bytes 94\r\n"));
+    EXPECT_NE(std::string::npos, out.find("STAT limit_maxbytes 100\r\n"));
+    EXPECT_EQ("END", out.substr(out.size() - 3));
+
+    // Unknown group
+    Execute::Stats("slabs").Execute(storage, "", out);
+    EXPECT_EQ("END", out);
+}
+
+TEST(StatsTest, Stripes) {
+    Backend::Config config;
+    config.max_stripes = 4;
+    Backend::StripedLockLRU storage(4 * 1024 * 1024, 4, config);
+    std::string value;
+    for (int i = 0; i < 100; i++) {
+        storage.Put(std::to_string(i), "v");
+        storage.Get(std::to_string(i), value);
+    }
+
+    std::string out;
+    Execute::Stats().Execute(storage, "", out);
+    EXPECT_NE(std::string::npos, out.find("STAT get_hits 100\r\n"));
+    EXPECT_NE(std::string::npos, out.find("STAT curr_items 100\r\n"));
+    EXPECT_NE(std::string::npos, out.find("STAT stripes 4\r\n"));
+
+    Execute::Stats("stripes").Execute(storage, "", out);
+    EXPECT_NE(std::string::npos, out.find("STAT stripe:0:get_hits "));
+    EXPECT_NE(std::string::npos, out.find("STAT stripe:3:curr_items "));
+    EXPECT_EQ(std::string::npos, out.find("STAT stripe:4:"));
+
+    // Counters survive resharding
+    storage.Resize(2);
+    for (int i = 0; i < 100; i++) {
+        storage.Get(std::to_string(i), value);
+    }
+    Execute::Stats().Execute(storage, "", out);
+    EXPECT_NE(std::string::npos, out.find("STAT get_hits 200\r\n"));
+    EXPECT_NE(std::string::npos, out.find("STAT curr_items 100\r\n"));
+}
@@ -3,8 +3,15 @@
 #include <memory>
 #include <string>
 
+#include <afina/KeyHash.h>
 #include <afina/execute/Add.h>
+#include <afina/execute/ClientError.h>
+#include <afina/execute/Delete.h>
+#include <afina/execute/FlushAll.h>
 #include <afina/execute/Get.h>
+#include <afina/execute/Prepend.h>
+#include <afina/execute/Invalidate.h>
+#include <afina/execute/InvalidateTag.h>
 #include <afina/execute/Set.h>
 #include <afina/execute/Stats.h>
 
@@ -58,6 +65,24 @@ TEST(MemcachedParserTest, SimpleAdd) {
     ASSERT_EQ(-1, tmp->expire());
 }
 
+// Verify prepend command, that is parsed as other storage commands
+TEST(MemcachedParserTest, SimplePrepend) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    bool cmd_avail = parser.Parse("prepend baz 0 0 3\r\nval\r\n", consumed);
+    ASSERT_TRUE(cmd_avail);
+    ASSERT_EQ(19, consumed);
+    ASSERT_EQ("prepend", parser.Name());
+
+    size_t value_size;
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(3, value_size);
+    ASSERT_FALSE(dynamic_cast<Execute::Prepend *>(cmd.get()) == nullptr);
+    ASSERT_EQ("baz", static_cast<Execute::Prepend *>(cmd.get())->key());
+}
+
 // Verify simple get command passed in a single string
 TEST(MemcachedParserTest, SimpleGet) {
     Protocol::Parser parser;
@@ -98,3 +123,170 @@ TEST(MemcachedParserTest, Stats) {
     Execute::Stats *tmp = reinterpret_cast<Execute::Stats *>(cmd.get());
     ASSERT_FALSE(tmp == nullptr);
 }
+
+TEST(MemcachedParserTest, StatsGroup) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    bool cmd_avail = parser.Parse("stats stripes\r\n", consumed);
+    ASSERT_TRUE(cmd_avail);
+    ASSERT_EQ(15, consumed);
+    ASSERT_EQ("stats", parser.Name());
+
+    size_t value_size;
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+
+    Execute::Stats *tmp = reinterpret_cast<Execute::Stats *>(cmd.get());
+    ASSERT_EQ("stripes", tmp->group());
+}
+
+TEST(MemcachedParserTest, TaggedSet) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    bool cmd_avail = parser.Parse("set foo 0 0 6 tag:user:42 noreply\r\nfooval\r\n", consumed);
+    ASSERT_TRUE(cmd_avail);
+    ASSERT_EQ(35, consumed);
+
+    size_t value_size;
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(6, value_size);
+
+    Execute::Set *tmp = reinterpret_cast<Execute::Set *>(cmd.get());
+    ASSERT_EQ("foo", tmp->key());
+    ASSERT_EQ("user:42", tmp->tag());
+
+    // Tag doesn't leak into the next command
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("set foo 0 0 6\r\n", consumed));
+    cmd = parser.Build(value_size);
+    ASSERT_EQ("", reinterpret_cast<Execute::Set *>(cmd.get())->tag());
+
+    // Other storage commands don't keep tags, body is still read, so that connection goes on
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("add foo 0 0 6 tag:user:42\r\n", consumed));
+    cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(6, value_size);
+    ASSERT_EQ("only set stores tags", reinterpret_cast<Execute::ClientError *>(cmd.get())->message());
+}
+
+TEST(MemcachedParserTest, Invalidate) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    ASSERT_TRUE(parser.Parse("invalidate user:1: user:2:\r\n", consumed));
+    ASSERT_EQ(28, consumed);
+    ASSERT_EQ("invalidate", parser.Name());
+
+    size_t value_size;
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(0, value_size);
+
+    Execute::Invalidate *tmp = reinterpret_cast<Execute::Invalidate *>(cmd.get());
+    ASSERT_EQ(2, tmp->prefixes().size());
+    ASSERT_EQ("user:1:", tmp->prefixes()[0]);
+    ASSERT_EQ("user:2:", tmp->prefixes()[1]);
+
+    // Extra spaces give no empty prefix, that one would match every key
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("invalidate a \r\n", consumed));
+    cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    tmp = reinterpret_cast<Execute::Invalidate *>(cmd.get());
+    ASSERT_EQ(1, tmp->prefixes().size());
+    ASSERT_EQ("a", tmp->prefixes()[0]);
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("invalidate  a  b\r\n", consumed));
+    cmd = parser.Build(value_size);
+    tmp = reinterpret_cast<Execute::Invalidate *>(cmd.get());
+    ASSERT_EQ(2, tmp->prefixes().size());
+    ASSERT_EQ("b", tmp->prefixes()[1]);
+
+    parser.Reset();
+    ASSERT_THROW(parser.Parse("invalidate  \r\n", consumed), std::runtime_error);
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("invalidate_tag user:42\r\n", consumed));
+    cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ("user:42", reinterpret_cast<Execute::InvalidateTag *>(cmd.get())->tag());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("invalidate_tag a b\r\n", consumed));
+    cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ("invalidate_tag takes one tag", reinterpret_cast<Execute::ClientError *>(cmd.get())->message());
+}
+
+TEST(MemcachedParserTest, Delete) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    ASSERT_TRUE(parser.Parse("delete foo\r\n", consumed));
+    ASSERT_EQ(12, consumed);
+    ASSERT_EQ("delete", parser.Name());
+
+    size_t value_size;
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(0, value_size);
+    ASSERT_EQ("foo", reinterpret_cast<Execute::Delete *>(cmd.get())->key());
+
+    parser.Reset();
+    ASSERT_THROW(parser.Parse("delete\r\n", consumed), std::runtime_error);
+}
+
+TEST(MemcachedParserTest, FlushAll) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    ASSERT_TRUE(parser.Parse("flush_all\r\n", consumed));
+    ASSERT_EQ(11, consumed);
+
+    size_t value_size;
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(0, reinterpret_cast<Execute::FlushAll *>(cmd.get())->delay());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("flush_all 30\r\n", consumed));
+    cmd = parser.Build(value_size);
+    ASSERT_EQ(30, reinterpret_cast<Execute::FlushAll *>(cmd.get())->delay());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("flush_all soon\r\n", consumed));
+    ASSERT_THROW(parser.Build(value_size), std::runtime_error);
+}
+
+// Keys are hashed while they are read, however input is split
+TEST(MemcachedParserTest, KeyHashes) {
+    Protocol::Parser parser;
+
+    const std::string input = "get a very_long_key_of_many_words\r\n";
+    size_t consumed = 0;
+    for (size_t pos = 0; pos < input.size(); pos += consumed) {
+        parser.Parse(input.substr(pos, 1), consumed);
+    }
+
+    size_t value_size;
+    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    Execute::Get *get = static_cast<Execute::Get *>(cmd.get());
+    ASSERT_EQ(2, get->hashes().size());
+    EXPECT_EQ(HashKey("a", 1), get->hashes()[0]);
+    EXPECT_EQ(HashKey("very_long_key_of_many_words", 27), get->hashes()[1]);
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("set foo 0 0 6\r\n", consumed));
+    cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    EXPECT_EQ(HashKey("foo", 3), static_cast<Execute::Set *>(cmd.get())->hash());
+
+    // Command built without parser hashes the key itself
+    EXPECT_EQ(HashKey("bar", 3), Execute::Delete("bar").hash());
+}
@@ -0,0 +1,677 @@
+// Storage micro benchmarks. Those are not part of the test suite since numbers make sense
+// only on a quiet box, run them by hand:
+//
+//   ./test/storage/runStorageBenchmark [benchmark name ...]
+//
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <malloc.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "storage/EpochLRU.h"
+#include "storage/FixedWidthLRU.h"
+#include "storage/FlatCombinedLRU.h"
+#include "storage/LogStructuredLRU.h"
+#include "storage/SimpleLRU.h"
+#include "storage/StripedLockLRU.h"
+#include "storage/ThreadSafeSimpleLRU.h"
+
+using namespace Afina::Backend;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Latency distribution of the single operation, in nanoseconds
+class Histogram {
+public:
+    void Add(Clock::duration d) { _samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()); }
+
+    void Report(const std::string &name) {
+        std::sort(_samples.begin(), _samples.end());
+        std::printf("  %-28s p50=%6lldns p99=%6lldns p99.9=%7lldns max=%8lldns\n", name.c_str(), Percentile(0.5),
+                    Percentile(0.99), Percentile(0.999), _samples.empty() ? 0LL : (long long)_samples.back());
+        _samples.clear();
+    }
+
+private:
+    long long Percentile(double p) const {
+        if (_samples.empty()) {
+            return 0;
+        }
+        return _samples[std::min(_samples.size() - 1, std::size_t(p * _samples.size()))];
+    }
+
+    std::vector<long long> _samples;
+};
+
+std::string make_key(std::size_t i) { return "user:" + std::to_string(i) + ":profile:settings"; }
+
+// Many small items: p99 of lookups is dominated by TLB misses and page faults
+void ArenaLatency() {
+    const std::size_t n_items = 1000000;
+    const std::string value(64, 'v');
+    const std::size_t max_size = n_items * (make_key(n_items).size() + value.size());
+
+    std::vector<std::size_t> order(n_items);
+    for (std::size_t i = 0; i < n_items; i++) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    std::vector<std::pair<std::string, ArenaConfig>> configs(3);
+    configs[0].first = "heap";
+    configs[1].first = "arena";
+    configs[1].second.enabled = true;
+    configs[2].first = "arena+prefault+mlock";
+    configs[2].second.enabled = true;
+    configs[2].second.prefault = true;
+    configs[2].second.mlock = true;
+
+    for (auto &config : configs) {
+        std::unique_ptr<SimpleLRU> storage(new SimpleLRU(max_size, config.second));
+        try {
+            storage->Start();
+        } catch (std::runtime_error &ex) {
+            std::printf("  %-28s skipped: %s\n", config.first.c_str(), ex.what());
+            continue;
+        }
+
+        Histogram hist;
+        for (std::size_t i = 0; i < n_items; i++) {
+            std::string key = make_key(i);
+            auto start = Clock::now();
+            storage->Put(key, value);
+            hist.Add(Clock::now() - start);
+        }
+        hist.Report(config.first + " put");
+
+        std::string out;
+        for (std::size_t i : order) {
+            std::string key = make_key(i);
+            auto start = Clock::now();
+            storage->Get(key, out);
+            hist.Add(Clock::now() - start);
+        }
+        hist.Report(config.first + " get");
+    }
+}
+
+// Throughput of the thread safe engines when all threads hammer the same small key set
+void Contention() {
+    const std::size_t n_threads = std::max(4u, std::thread::hardware_concurrency());
+    const std::size_t n_ops = 200000;
+    const std::size_t n_keys = 10000;
+    const std::size_t max_size = 64 * 1024 * 1024;
+
+    Config write_behind;
+    write_behind.write_behind = true;
+
+    std::vector<std::pair<std::string, std::function<Afina::Storage *()>>> engines = {
+        {"mt_lru", [=]() { return new ThreadSafeSimplLRU(max_size); }},
+        {"mt_lru+wb", [=]() { return new ThreadSafeSimplLRU(max_size, write_behind); }},
+        {"mt_slru", [=]() { return new StripedLockLRU(max_size, 16); }},
+        {"mt_slru+wb", [=]() { return new StripedLockLRU(max_size, 16, write_behind); }},
+        {"mt_fc", [=]() { return new FlatCombinedLRU(max_size); }},
+        {"mt_epoch", [=]() { return new EpochLRU(max_size); }},
+    };
+
+    // Every n-th operation is a write
+    for (std::size_t write_every : {10, 2}) {
+        std::printf(" 1/%zu writes\n", write_every);
+        for (auto &engine : engines) {
+            std::unique_ptr<Afina::Storage> storage(engine.second());
+            storage->Start();
+            for (std::size_t i = 0; i < n_keys; i++) {
+                storage->Put(make_key(i), std::string(64, 'v'));
+            }
+
+            auto start = Clock::now();
+            std::vector<std::thread> threads;
+            for (std::size_t t = 0; t < n_threads; t++) {
+                threads.emplace_back([&storage, t, write_every]() {
+                    std::mt19937 rnd(t);
+                    std::string out;
+                    for (std::size_t i = 0; i < n_ops; i++) {
+                        std::string key = make_key(rnd() % n_keys);
+                        if (i % write_every == 0) {
+                            storage->Put(key, std::string(64, 'w'));
+                        } else {
+                            storage->Get(key, out);
+                        }
+                    }
+                });
+            }
+            for (auto &t : threads) {
+                t.join();
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::printf("  %-12s %zu threads: %8.0f ops/s\n", engine.first.c_str(), n_threads,
+                        n_threads * n_ops / seconds);
+            storage->Stop();
+        }
+    }
+}
+
+// Lookups of keys that were never stored, while some threads keep updating existing ones
+void Misses() {
+    const std::size_t n_threads = std::max(4u, std::thread::hardware_concurrency());
+    const std::size_t n_ops = 200000;
+    const std::size_t n_keys = 100000;
+    const std::size_t max_size = 64 * 1024 * 1024;
+
+    Config filter;
+    filter.filter = true;
+
+    std::vector<std::pair<std::string, std::function<Afina::Storage *()>>> engines = {
+        {"mt_lru", [=]() { return new ThreadSafeSimplLRU(max_size); }},
+        {"mt_lru+filter", [=]() { return new ThreadSafeSimplLRU(max_size, filter); }},
+        {"mt_slru", [=]() { return new StripedLockLRU(max_size, 16); }},
+        {"mt_slru+filter", [=]() { return new StripedLockLRU(max_size, 16, filter); }},
+    };
+
+    for (auto &engine : engines) {
+        std::unique_ptr<Afina::Storage> storage(engine.second());
+        storage->Start();
+        for (std::size_t i = 0; i < n_keys; i++) {
+            storage->Put(make_key(i), std::string(64, 'v'));
+        }
+
+        // 9 of 10 operations look for absent key
+        auto start = Clock::now();
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < n_threads; t++) {
+            threads.emplace_back([&storage, t]() {
+                std::mt19937 rnd(t);
+                std::string out;
+                for (std::size_t i = 0; i < n_ops; i++) {
+                    if (i % 10 == 0) {
+                        storage->Put(make_key(rnd() % n_keys), std::string(64, 'w'));
+                    } else {
+                        storage->Get(make_key(n_keys + rnd()), out);
+                    }
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::printf("  %-16s %zu threads: %8.0f ops/s\n", engine.first.c_str(), n_threads, n_threads * n_ops / seconds);
+        storage->Stop();
+    }
+}
+
+// Heap allocator that keeps track of allocated bytes
+template <typename T> class CountingAllocator {
+public:
+    using value_type = T;
+
+    CountingAllocator(std::size_t *bytes) : _bytes(bytes) {}
+    template <typename U> CountingAllocator(const CountingAllocator<U> &other) : _bytes(other.bytes()) {}
+
+    T *allocate(std::size_t n) {
+        *_bytes += n * sizeof(T);
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *ptr, std::size_t n) {
+        *_bytes -= n * sizeof(T);
+        ::operator delete(ptr);
+    }
+
+    std::size_t *bytes() const { return _bytes; }
+
+private:
+    std::size_t *_bytes;
+};
+
+template <typename T, typename U> bool operator==(const CountingAllocator<T> &a, const CountingAllocator<U> &b) {
+    return a.bytes() == b.bytes();
+}
+
+template <typename T, typename U> bool operator!=(const CountingAllocator<T> &a, const CountingAllocator<U> &b) {
+    return a.bytes() != b.bytes();
+}
+
+template <typename Index> void IndexFootprint(const std::string &name, const std::vector<std::string> &keys) {
+    using entry = std::pair<const KeyRef, void *>;
+    using map = typename Index::template map<void *, CountingAllocator<entry>>;
+
+    std::size_t bytes = 0;
+    {
+        map index{CountingAllocator<entry>(&bytes)};
+        for (auto &key : keys) {
+            index.emplace(KeyRef(key), nullptr);
+        }
+        std::size_t footprint = bytes;
+
+        std::mt19937 rnd(1);
+        const std::size_t n_ops = 2000000;
+        std::size_t found = 0;
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < n_ops; i++) {
+            found += index.find(KeyRef(keys[rnd() % keys.size()])) != index.end();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::printf("  %-10s %6.1f bytes/key %6.0f ns/lookup (%zu found)\n", name.c_str(),
+                    double(footprint) / keys.size(), 1e9 * seconds / n_ops, found);
+    }
+}
+
+// Memory and lookup cost of the index alone, for keys sharing long prefixes
+void Index() {
+    std::vector<std::string> keys;
+    for (std::size_t i = 0; i < 1000000; i++) {
+        keys.push_back(make_key(i));
+    }
+
+    IndexFootprint<OrderedIndex>("ordered", keys);
+    IndexFootprint<HashIndex>("hash", keys);
+    IndexFootprint<ArtIndex>("art", keys);
+}
+
+// Single thread get/put loop over storage of the static type S. With S = Afina::Storage every call is virtual,
+// with the final storage type calls are direct
+template <typename S> double SingleThreadOps(S &storage, const std::vector<std::string> &keys, std::size_t n_ops) {
+    const std::string value(32, 'v');
+    std::mt19937 rnd(1);
+    std::string out;
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < n_ops; i++) {
+        const std::string &key = keys[rnd() % keys.size()];
+        if (i % 10 == 0) {
+            storage.Put(key, value);
+        } else {
+            storage.Get(key, out);
+        }
+    }
+    return n_ops / std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename S> void CompareCalls(const std::string &name) {
+    const std::size_t max_size = 64 * 1024 * 1024;
+    const std::size_t n_ops = 2000000;
+
+    std::vector<std::string> keys;
+    for (std::size_t i = 0; i < 10000; i++) {
+        keys.push_back(make_key(i));
+    }
+
+    // Network layer sees nothing but Afina::Storage, so does the compiler here
+    std::function<Afina::Storage *()> factory = [=]() { return new S(max_size); };
+    std::unique_ptr<Afina::Storage> storage(factory());
+    for (auto &key : keys) {
+        storage->Put(key, std::string(32, 'v'));
+    }
+
+    double virtual_ops = SingleThreadOps<Afina::Storage>(*storage, keys, n_ops);
+    double direct_ops = SingleThreadOps<S>(static_cast<S &>(*storage), keys, n_ops);
+    std::printf("  %-32s virtual: %9.0f ops/s direct: %9.0f ops/s (%+.1f%%)\n", name.c_str(), virtual_ops, direct_ops,
+                100 * (direct_ops / virtual_ops - 1));
+}
+
+// Cost of virtual calls and of each policy of the LRU template
+void Devirtualization() {
+    CompareCalls<ThreadSafeLRU<std::mutex, SimpleLRU>>("lru<mutex, ordered, counters>");
+    CompareCalls<ThreadSafeLRU<SpinLock, SimpleLRU>>("lru<spin, ordered, counters>");
+    CompareCalls<SimpleLRU>("lru<none, ordered, counters>");
+    CompareCalls<BasicLRU<HashIndex, Counters>>("lru<none, hash, counters>");
+    CompareCalls<BasicLRU<HashIndex, NullCounters>>("lru<none, hash, none>");
+}
+
+// Readers latency while writer periodically puts large values, each one evicts thousands of small items
+void EvictionSpike() {
+    const std::size_t max_size = 64 * 1024 * 1024;
+    const std::size_t n_small = max_size / 128;
+    const std::string small(100, 's');
+    const std::string large(4 * 1024 * 1024, 'l');
+
+    Config background;
+    background.low_watermark = 0.8;
+    background.high_watermark = 0.9;
+
+    std::vector<std::pair<std::string, Config>> configs = {{"inline", Config()}, {"background", background}};
+    for (auto &config : configs) {
+        ThreadSafeSimplLRU storage(max_size, config.second);
+        storage.Start();
+        for (std::size_t i = 0; i < n_small; i++) {
+            storage.Put(make_key(i), small);
+        }
+
+        std::atomic<bool> stop(false);
+        std::thread writer([&]() {
+            std::size_t i = n_small;
+            while (!stop.load()) {
+                // Refill with small items, then spike
+                for (std::size_t j = 0; j < 40000 && !stop.load(); j++, i++) {
+                    storage.Put(make_key(i), small);
+                }
+                storage.Put("large:" + std::to_string(i), large);
+            }
+        });
+
+        Histogram hist;
+        std::mt19937 rnd(1);
+        std::string out;
+        auto until = Clock::now() + std::chrono::seconds(3);
+        while (Clock::now() < until) {
+            std::string key = make_key(rnd() % n_small);
+            auto start = Clock::now();
+            storage.Get(key, out);
+            hist.Add(Clock::now() - start);
+        }
+        stop.store(true);
+        writer.join();
+        storage.Stop();
+        hist.Report(config.first + " get");
+    }
+}
+
+// Bytes malloc got from the system, both heap and mmapped chunks
+std::size_t HeapFootprint() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+#else
+    struct mallinfo info = mallinfo();
+#endif
+    return std::size_t(info.arena) + std::size_t(info.hblkhd);
+}
+
+// Puts of values of varied sizes into the full storage: heap footprint against bytes actually stored
+void Churn() {
+    const std::size_t max_size = 64 * 1024 * 1024;
+    const std::size_t n_ops = 2000000;
+    const std::size_t n_keys = 200000;
+
+    std::vector<std::pair<std::string, std::function<Afina::Storage *()>>> engines = {
+        {"mt_lru", [=]() { return new ThreadSafeSimplLRU(max_size); }},
+        {"mt_log", [=]() { return new LogStructuredLRU(max_size); }},
+    };
+    for (auto &engine : engines) {
+        // Each engine starts from the pristine heap of its own process
+        std::fflush(stdout);
+        pid_t child = fork();
+        if (child != 0) {
+            waitpid(child, nullptr, 0);
+            continue;
+        }
+
+        std::size_t base = HeapFootprint();
+        std::unique_ptr<Afina::Storage> storage(engine.second());
+        storage->Start();
+
+        std::mt19937 rnd(1);
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < n_ops; i++) {
+            // Sizes drift over time, so freed blocks rarely suit the next values
+            std::size_t phase = i * 4 / n_ops;
+            std::size_t size = 16 + rnd() % (256 << phase);
+            storage->Put(make_key(rnd() % n_keys), std::string(size, 'v'));
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::vector<std::pair<std::string, std::string>> stats;
+        storage->Stats("", stats);
+        std::size_t bytes = 0;
+        for (auto &stat : stats) {
+            if (stat.first == "bytes") {
+                bytes = std::stoull(stat.second);
+            }
+        }
+        std::size_t footprint = HeapFootprint() - base;
+        std::printf("  %-8s %8.0f puts/s, %6.1f MB stored, %6.1f MB of heap, %3.0f%% utilization\n",
+                    engine.first.c_str(), n_ops / seconds, bytes / 1048576.0, footprint / 1048576.0,
+                    100.0 * bytes / footprint);
+        storage->Stop();
+        std::fflush(stdout);
+        _exit(0);
+    }
+}
+
+// Heap spent per 8 byte counter: node and strings of SimpleLRU against slots of the fixed width store
+void Density() {
+    const std::size_t n_items = 900000;
+    const std::string value(8, 'c');
+    auto counter_key = [](std::size_t i) { return "ctr:" + std::to_string(i); };
+
+    // Limits leave room for every item, so nothing is evicted. Table of 2^20 slots is 7/8 full at 917504 items
+    std::vector<std::pair<std::string, std::function<Afina::Storage *()>>> engines = {
+        {"mt_lru", [=]() { return new ThreadSafeSimplLRU(n_items * 32); }},
+        {"mt_fixed8", [=]() { return new FixedWidthLRU<8>((1 << 20) * (1 + 24 + 8)); }},
+    };
+    for (auto &engine : engines) {
+        std::fflush(stdout);
+        pid_t child = fork();
+        if (child != 0) {
+            waitpid(child, nullptr, 0);
+            continue;
+        }
+
+        std::size_t base = HeapFootprint();
+        std::unique_ptr<Afina::Storage> storage(engine.second());
+        for (std::size_t i = 0; i < n_items; i++) {
+            storage->Put(counter_key(i), value);
+        }
+        std::size_t footprint = HeapFootprint() - base;
+
+        std::vector<std::string> keys;
+        std::mt19937 rnd(1);
+        for (std::size_t i = 0; i < n_items; i++) {
+            keys.push_back(counter_key(rnd() % n_items));
+        }
+        std::string out;
+        std::size_t hits = 0;
+        auto start = Clock::now();
+        for (auto &key : keys) {
+            hits += storage->Get(key, out);
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n_items;
+
+        std::printf("  %-10s %6.1f bytes/item, %6.1fM items/GB, %5.0f ns/get, %zu hits\n", engine.first.c_str(),
+                    double(footprint) / n_items, 1024.0 * n_items / footprint, ns, hits);
+        std::fflush(stdout);
+        _exit(0);
+    }
+}
+
+// Get hits of small values: response formatted on every hit against the one kept next to the value
+void GetResponse() {
+    const std::size_t n_items = 100000;
+    const std::size_t n_gets = 2000000;
+    SimpleLRU storage(64 * 1024 * 1024);
+    for (std::size_t i = 0; i < n_items; i++) {
+        storage.Put(make_key(i), std::string(32, 'v'));
+    }
+
+    std::vector<std::string> keys;
+    std::mt19937 rnd(1);
+    for (std::size_t i = 0; i < n_gets; i++) {
+        keys.push_back(make_key(rnd() % n_items));
+    }
+
+    std::size_t bytes = 0;
+    auto start = Clock::now();
+    std::string value;
+    for (auto &key : keys) {
+        std::stringstream out;
+        storage.Get(key, value);
+        out << "VALUE " << key << " 0 " << value.size() << "\r\n" << value << "\r\n";
+        bytes += out.str().size();
+    }
+    double formatted = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n_gets;
+
+    start = Clock::now();
+    for (auto &key : keys) {
+        Afina::Value out;
+        storage.GetItem(key, out);
+        bytes -= out.size();
+    }
+    double preformatted = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n_gets;
+
+    std::printf("  formatted    %6.0f ns/hit\n", formatted);
+    std::printf("  preformatted %6.0f ns/hit (%zu bytes of difference)\n", preformatted, bytes);
+}
+
+// Appends of small pieces to the log-style value: copy of the whole value against append in place
+void Append() {
+    const std::size_t n_appends = 2000;
+    const std::string piece(100, 'a');
+    for (std::size_t initial : {std::size_t(16 * 1024), std::size_t(1024 * 1024)}) {
+        SimpleLRU copied(64 * 1024 * 1024), in_place(64 * 1024 * 1024);
+        copied.Put("log", std::string(initial, 'l'));
+        in_place.Put("log", std::string(initial, 'l'));
+
+        auto start = Clock::now();
+        std::string value;
+        for (std::size_t i = 0; i < n_appends; i++) {
+            copied.Get("log", value);
+            copied.Put("log", value + piece);
+        }
+        double copy = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n_appends;
+
+        start = Clock::now();
+        for (std::size_t i = 0; i < n_appends; i++) {
+            in_place.Append("log", Afina::Value(piece));
+        }
+        double append = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n_appends;
+
+        std::printf("  %7zu bytes: get+put %9.0f ns/append, in place %6.0f ns/append\n", initial, copy, append);
+    }
+}
+
+// Cost of miss ratio curve estimation on cache aside workload with skewed keys, and how close estimated hit
+// ratios are to the ones of caches of that size
+void MissRatio() {
+    const std::size_t max_size = 16 * 1024 * 1024;
+    const std::size_t n_keys = 2 * max_size / 64;
+    const std::size_t n_ops = 4000000;
+
+    std::vector<std::string> keys;
+    std::mt19937 rnd(1);
+    for (std::size_t i = 0; i < n_ops; i++) {
+        keys.push_back(make_key(uint64_t(rnd() % n_keys) * (rnd() % n_keys) / n_keys));
+    }
+
+    auto run = [&keys](SimpleLRU &storage) {
+        auto start = Clock::now();
+        std::string value;
+        for (auto &key : keys) {
+            if (!storage.Get(key, value)) {
+                storage.Put(key, std::string(64 - key.size(), 'v'));
+            }
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / keys.size();
+    };
+    auto ratio = [](SimpleLRU &storage) {
+        StorageStats stats;
+        storage.Snapshot(stats);
+        return double(stats.get_hits) / (stats.get_hits + stats.get_misses);
+    };
+
+    for (double rate : {0.0, 0.001, 0.01, 0.1}) {
+        SimpleLRU storage(max_size);
+        if (rate > 0) {
+            storage.EnableMissRatioCurve(rate);
+        }
+        double ns = run(storage);
+        StorageStats stats;
+        storage.Snapshot(stats);
+        std::printf("  rate %5.3f: %4.0f ns/op", rate, ns);
+        if (stats.mrc_gets > 0) {
+            std::printf(", estimated 0.5x %.3f 1x %.3f 2x %.3f 4x %.3f", double(stats.mrc_hits_half) / stats.mrc_gets,
+                        double(stats.mrc_hits_1x) / stats.mrc_gets, double(stats.mrc_hits_2x) / stats.mrc_gets,
+                        double(stats.mrc_hits_4x) / stats.mrc_gets);
+        }
+        std::printf("\n");
+    }
+
+    std::printf("  actual:                 ");
+    for (double scale : {0.5, 1.0, 2.0, 4.0}) {
+        SimpleLRU storage(scale * max_size);
+        run(storage);
+        std::printf(" %gx %.3f", scale, ratio(storage));
+    }
+    std::printf("\n");
+}
+
+// Cost of tracking the most accessed keys on hits of the small cache
+void HotKeys() {
+    const std::size_t n_items = 100000;
+    const std::size_t n_gets = 4000000;
+    std::vector<std::string> keys;
+    std::mt19937 rnd(1);
+    for (std::size_t i = 0; i < n_gets; i++) {
+        keys.push_back(make_key(rnd() % n_items));
+    }
+
+    for (uint32_t period : {0u, 1u, 16u, 64u}) {
+        SimpleLRU storage(64 * 1024 * 1024);
+        if (period > 0) {
+            storage.SetHeavyHitters(std::make_shared<HeavyHitters>(10, period));
+        }
+        for (std::size_t i = 0; i < n_items; i++) {
+            storage.Put(make_key(i), std::string(32, 'v'));
+        }
+
+        auto start = Clock::now();
+        std::string value;
+        for (auto &key : keys) {
+            storage.Get(key, value);
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n_gets;
+        std::printf("  sample period %2u: %5.0f ns/get\n", period, ns);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::map<std::string, std::function<void()>> benchmarks;
+    benchmarks["append"] = Append;
+    benchmarks["arena_latency"] = ArenaLatency;
+    benchmarks["churn"] = Churn;
+    benchmarks["contention"] = Contention;
+    benchmarks["density"] = Density;
+    benchmarks["devirtualization"] = Devirtualization;
+    benchmarks["get_response"] = GetResponse;
+    benchmarks["hotkeys"] = HotKeys;
+    benchmarks["index"] = Index;
+    benchmarks["eviction_spike"] = EvictionSpike;
+    benchmarks["misses"] = Misses;
+    benchmarks["mrc"] = MissRatio;
+
+    std::vector<std::string> to_run(argv + 1, argv + argc);
+    if (to_run.empty()) {
+        for (auto &b : benchmarks) {
+            to_run.push_back(b.first);
+        }
+    }
+
+    for (auto &name : to_run) {
+        auto it = benchmarks.find(name);
+        if (it == benchmarks.end()) {
+            std::cerr << "Unknown benchmark: " << name << std::endl;
+            return 1;
+        }
+        std::printf("%s:\n", name.c_str());
+        it->second();
+    }
+    return 0;
+}
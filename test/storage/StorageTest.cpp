@@ -1,19 +1,46 @@
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <random>
 #include <set>
+#include <thread>
 #include <vector>
 
+#include <unistd.h>
+
+#include <afina/KeyHash.h>
 #include <afina/execute/Add.h>
 #include <afina/execute/Append.h>
 #include <afina/execute/Delete.h>
 #include <afina/execute/Get.h>
 #include <afina/execute/Set.h>
 
+#include "storage/ArtMap.h"
+#include "storage/CuckooFilter.h"
+#include "storage/EpochLRU.h"
+#include "storage/FixedWidthLRU.h"
+#include "storage/FlatCombinedLRU.h"
+#include "storage/HeavyHitters.h"
+#include "storage/LogStructuredLRU.h"
+#include "storage/MemoryGovernor.h"
+#include "storage/MissRatioCurve.h"
+#include "storage/Namespaces.h"
 #include "storage/SimpleLRU.h"
+#include "storage/StripedLockLRU.h"
+#include "storage/ThreadSafeSimpleLRU.h"
 
 using namespace Afina::Backend;
 using namespace Afina::Execute;
+using Afina::HashKey;
+using Afina::KeyHasher;
+using Afina::Value;
+using Current = Afina::Storage::Current;
 using namespace std;
 
 
@@ -139,6 +166,21 @@ TEST(StorageTest, DeleteHeadAndTailNode)
     EXPECT_TRUE(storage.Delete("KEY1"));
 }
 
+TEST(StorageTest, DeleteMiddleNode) {
+    SimpleLRU storage;
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Put("KEY2", "val2"));
+    EXPECT_TRUE(storage.Put("KEY3", "val3"));
+    EXPECT_TRUE(storage.Delete("KEY2"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY3", value));
+    EXPECT_EQ("val3", value);
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val1", value);
+}
+
 std::string pad_space(const std::string &s, size_t length) {
     std::string result = s;
     result.resize(length, ' ');
@@ -195,3 +237,2053 @@ TEST(StorageTest, MaxTest) {
         EXPECT_FALSE(storage.Get(key, res));
     }
 }
+
+TEST(StorageTest, ArenaMaxTest) {
+    const size_t length = 20;
+    ArenaConfig arena;
+    arena.enabled = true;
+    arena.prefault = true;
+    SimpleLRU storage(2 * 1000 * length, arena);
+    storage.Start();
+
+    for (long i = 0; i < 1100; ++i) {
+        auto key = pad_space("Key " + std::to_string(i), length);
+        auto val = pad_space("Val " + std::to_string(i), length);
+        EXPECT_TRUE(storage.Put(key, val));
+    }
+
+    for (long i = 100; i < 1100; ++i) {
+        auto key = pad_space("Key " + std::to_string(i), length);
+        auto val = pad_space("Val " + std::to_string(i), length);
+
+        std::string res;
+        EXPECT_TRUE(storage.Get(key, res));
+
+        EXPECT_TRUE(val == res);
+    }
+
+    for (long i = 0; i < 100; ++i) {
+        auto key = pad_space("Key " + std::to_string(i), length);
+
+        std::string res;
+        EXPECT_FALSE(storage.Get(key, res));
+    }
+}
+
+TEST(StorageTest, ArenaReuse) {
+    ArenaConfig config;
+    Arena arena(1024, config);
+
+    void *p = arena.Allocate(100);
+    EXPECT_TRUE(arena.Contains(p));
+    arena.Deallocate(p, 100);
+
+    // Same size class gets the same block back
+    EXPECT_EQ(p, arena.Allocate(90));
+
+    // Too large blocks go to the heap
+    void *big = arena.Allocate(arena.size());
+    EXPECT_FALSE(arena.Contains(big));
+    arena.Deallocate(big, arena.size());
+}
+
+static std::string StorageStat(Afina::Storage &storage, const std::string &name) {
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.Stats("", stats);
+    for (auto &stat : stats) {
+        if (stat.first == name) {
+            return stat.second;
+        }
+    }
+    return "";
+}
+
+TEST(StorageTest, EpochPutGetDelete) {
+    EpochLRU storage;
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.PutIfAbsent("KEY2", "val2"));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY2", "val3"));
+    EXPECT_TRUE(storage.Set("KEY1", "val11"));
+    EXPECT_FALSE(storage.Set("KEY3", "val3"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val11", value);
+    EXPECT_TRUE(storage.Get("KEY2", value));
+    EXPECT_EQ("val2", value);
+
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+}
+
+TEST(StorageTest, EpochMaxTest) {
+    const size_t length = 20;
+    EpochLRU storage(2 * 1000 * length);
+
+    for (long i = 0; i < 1100; ++i) {
+        auto key = pad_space("Key " + std::to_string(i), length);
+        auto val = pad_space("Val " + std::to_string(i), length);
+        EXPECT_TRUE(storage.Put(key, val));
+    }
+
+    // Nobody was read, so CLOCK degrades to FIFO
+    for (long i = 100; i < 1100; ++i) {
+        auto key = pad_space("Key " + std::to_string(i), length);
+        auto val = pad_space("Val " + std::to_string(i), length);
+
+        std::string res;
+        EXPECT_TRUE(storage.Get(key, res));
+        EXPECT_TRUE(val == res);
+    }
+
+    for (long i = 0; i < 100; ++i) {
+        auto key = pad_space("Key " + std::to_string(i), length);
+
+        std::string res;
+        EXPECT_FALSE(storage.Get(key, res));
+    }
+}
+
+TEST(StorageTest, EpochConcurrentReaders) {
+    const long n_keys = 1000;
+    EpochLRU storage(n_keys * 16);
+    std::atomic<bool> stop(false);
+    std::atomic<long> errors(0);
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&]() {
+            std::string value;
+            while (!stop.load()) {
+                for (long i = 0; i < n_keys; i++) {
+                    std::string key = std::to_string(i);
+                    // Value always starts with its key, whatever version reader sees
+                    if (storage.Get(key, value) && value.compare(0, key.size(), key) != 0) {
+                        errors++;
+                    }
+                }
+            }
+        });
+    }
+
+    for (long round = 0; round < 20; round++) {
+        for (long i = 0; i < n_keys; i++) {
+            std::string key = std::to_string(i);
+            storage.Put(key, key + ":" + std::to_string(round));
+            if (i % 7 == round % 7) {
+                storage.Delete(key);
+            }
+        }
+    }
+    stop.store(true);
+    for (auto &t : readers) {
+        t.join();
+    }
+    EXPECT_EQ(0, errors.load());
+}
+
+TEST(StorageTest, EpochEvictReferenced) {
+    // Single item that was just read is still a victim
+    EpochLRU single(16);
+    std::string value;
+    EXPECT_TRUE(single.Put("a", "0123456789"));
+    EXPECT_TRUE(single.Get("a", value));
+    EXPECT_TRUE(single.Put("b", "0123456789"));
+    EXPECT_FALSE(single.Get("a", value));
+    EXPECT_TRUE(single.Get("b", value));
+    EXPECT_EQ("1", StorageStat(single, "curr_items"));
+
+    // Reader keeps referencing and copying items out while the cache is filled many times over
+    const std::size_t max_size = 64 * 16;
+    EpochLRU storage(max_size);
+    std::atomic<bool> stop(false);
+    std::thread reader([&]() {
+        std::string value;
+        while (!stop.load()) {
+            for (long i = 0; i < 64; i++) {
+                storage.Get(std::to_string(i), value);
+            }
+        }
+    });
+
+    for (long i = 0; i < 100000; i++) {
+        EXPECT_TRUE(storage.Put(std::to_string(i % 1000), "0123456789"));
+    }
+    stop.store(true);
+    reader.join();
+    EXPECT_LE(std::stoul(StorageStat(storage, "bytes")), max_size);
+}
+
+TEST(StorageTest, FlatCombinedConcurrent) {
+    const long n_keys = 1000;
+    FlatCombinedLRU storage(n_keys * 16);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&storage, t]() {
+            std::string value;
+            for (long i = t; i < n_keys; i += 4) {
+                std::string key = std::to_string(i);
+                EXPECT_TRUE(storage.Put(key, "v" + key));
+                EXPECT_TRUE(storage.Get(key, value));
+                EXPECT_EQ("v" + key, value);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    std::string value;
+    for (long i = 0; i < n_keys; i++) {
+        std::string key = std::to_string(i);
+        EXPECT_TRUE(storage.Get(key, value));
+        EXPECT_EQ("v" + key, value);
+    }
+    EXPECT_TRUE(storage.Delete("0"));
+    EXPECT_FALSE(storage.Get("0", value));
+}
+
+TEST(StorageTest, WriteBehindReadYourWrites) {
+    Config config;
+    config.write_behind = true;
+    ThreadSafeSimplLRU storage(1024, config);
+    storage.Start();
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Put("KEY1", "val2"));
+    EXPECT_FALSE(storage.Put("KEY2", std::string(2048, 'x')));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val2", value);
+
+    // Conditional operations see queued puts as well
+    EXPECT_TRUE(storage.Put("KEY3", "val3"));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY3", "val4"));
+    EXPECT_TRUE(storage.Put("KEY4", "val4"));
+    EXPECT_TRUE(storage.Delete("KEY4"));
+    EXPECT_FALSE(storage.Get("KEY4", value));
+
+    // Chunked puts don't wait for the lock either
+    {
+        auto lk = storage.Lock();
+        std::thread writer([&storage]() { EXPECT_TRUE(storage.PutValue("KEY5", Value("val5"))); });
+        writer.join();
+    }
+    EXPECT_TRUE(storage.Get("KEY5", value));
+    EXPECT_EQ("val5", value);
+    storage.Stop();
+}
+
+TEST(StorageTest, WriteBehindStriped) {
+    Config config;
+    config.write_behind = true;
+    StripedLockLRU storage(16 * 1024 * 1024, 4, config);
+    storage.Start();
+
+    const long n_keys = 4000;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; t++) {
+        writers.emplace_back([&storage, t]() {
+            std::string value;
+            for (long i = t; i < n_keys; i += 4) {
+                std::string key = std::to_string(i);
+                EXPECT_TRUE(storage.Put(key, "v" + key));
+                EXPECT_TRUE(storage.Get(key, value));
+                EXPECT_EQ("v" + key, value);
+            }
+        });
+    }
+    for (auto &t : writers) {
+        t.join();
+    }
+
+    std::string value;
+    for (long i = 0; i < n_keys; i++) {
+        std::string key = std::to_string(i);
+        EXPECT_TRUE(storage.Get(key, value));
+        EXPECT_EQ("v" + key, value);
+    }
+    storage.Stop();
+}
+
+TEST(StorageTest, EvictLastItem) {
+    SimpleLRU storage(100);
+
+    EXPECT_TRUE(storage.Put("KEY1", std::string(60, 'a')));
+    EXPECT_TRUE(storage.Put("KEY2", std::string(60, 'b')));
+
+    std::string value;
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_TRUE(storage.Get("KEY2", value));
+    EXPECT_EQ(64, storage.size());
+
+    EXPECT_EQ(1, storage.Evict(0, 10));
+    EXPECT_EQ(0, storage.size());
+    EXPECT_FALSE(storage.Get("KEY2", value));
+}
+
+TEST(StorageTest, BackgroundEviction) {
+    const size_t length = 20;
+    Config config;
+    config.low_watermark = 0.5;
+    config.high_watermark = 0.75;
+    ThreadSafeSimplLRU storage(2 * 1000 * length, config);
+
+    // Puts never evict inline until hard limit is reached, crossing the high watermark only schedules reclaim.
+    // Worker isn't running yet, so reclaim steps are driven here and must reach the low watermark
+    for (long i = 0; i < 800; ++i) {
+        auto key = pad_space("Key " + std::to_string(i), length);
+        auto val = pad_space("Val " + std::to_string(i), length);
+        EXPECT_TRUE(storage.Put(key, val));
+    }
+    EXPECT_EQ(800 * 2 * length, storage.size());
+    while (storage.Reclaim()) {
+    }
+    EXPECT_LE(storage.size(), 1000 * length);
+
+    // The oldest ones are gone, the freshest are still here
+    std::string res;
+    EXPECT_FALSE(storage.Get(pad_space("Key 0", length), res));
+    EXPECT_TRUE(storage.Get(pad_space("Key 799", length), res));
+
+    // Worker could reach the low watermark before the last puts and then storage stays between watermarks, so
+    // once it is idle only the high one is guaranteed
+    storage.Start();
+    for (long i = 800; i < 2000; ++i) {
+        auto key = pad_space("Key " + std::to_string(i), length);
+        auto val = pad_space("Val " + std::to_string(i), length);
+        EXPECT_TRUE(storage.Put(key, val));
+    }
+    for (int i = 0; i < 1000 && storage.Reclaim(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    storage.Stop();
+    EXPECT_LE(storage.size(), 1500 * length);
+    EXPECT_TRUE(storage.Get(pad_space("Key 1999", length), res));
+}
+
+TEST(StorageTest, AdoptOldest) {
+    SimpleLRU storage(100);
+
+    EXPECT_TRUE(storage.Put("KEY1", std::string(40, 'a')));
+    EXPECT_TRUE(storage.Adopt("KEY2", Value(std::string(40, 'b')), true));
+    EXPECT_FALSE(storage.Adopt("KEY1", Value("val"), false));
+    EXPECT_FALSE(storage.Adopt("KEY3", Value(std::string(40, 'c')), true));
+
+    std::string key;
+    EXPECT_TRUE(storage.FreshestKey(key));
+    EXPECT_EQ("KEY1", key);
+
+    // KEY2 is the oldest one, so it goes away first
+    EXPECT_TRUE(storage.Put("KEY3", std::string(40, 'c')));
+    std::string value;
+    EXPECT_FALSE(storage.Get("KEY2", value));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+}
+
+TEST(StorageTest, OnlineResize) {
+    Config config;
+    config.max_stripes = 16;
+    StripedLockLRU storage(16 * 1024 * 1024, 4, config);
+    storage.Start();
+
+    const long n_keys = 20000;
+    for (long i = 0; i < n_keys; i++) {
+        std::string key = std::to_string(i);
+        ASSERT_TRUE(storage.Put(key, "v" + key));
+    }
+
+    // Clients keep working while items are moved
+    EXPECT_TRUE(storage.Resize(8));
+    EXPECT_FALSE(storage.Resize(16));
+    EXPECT_EQ(8, storage.stripes());
+
+    std::vector<std::thread> clients;
+    for (int t = 0; t < 4; t++) {
+        clients.emplace_back([&storage, t]() {
+            std::string value;
+            for (long i = t; i < n_keys; i += 4) {
+                std::string key = std::to_string(i);
+                EXPECT_TRUE(storage.Get(key, value));
+                EXPECT_EQ("v" + key, value);
+                if (i % 3 == 0) {
+                    EXPECT_TRUE(storage.Set(key, "w" + key));
+                }
+            }
+        });
+    }
+    for (auto &t : clients) {
+        t.join();
+    }
+
+    for (int i = 0; i < 10000 && storage.Resizing(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_FALSE(storage.Resizing());
+
+    std::string value;
+    for (long i = 0; i < n_keys; i++) {
+        std::string key = std::to_string(i);
+        EXPECT_TRUE(storage.Get(key, value));
+        EXPECT_EQ((i % 3 == 0 ? "w" : "v") + key, value);
+    }
+
+    // Shrink works the same way
+    EXPECT_TRUE(storage.Resize(2));
+    storage.Stop();
+    for (long i = 0; i < n_keys; i += 7) {
+        std::string key = std::to_string(i);
+        EXPECT_TRUE(storage.Get(key, value));
+    }
+}
+
+TEST(StorageTest, ResizeWithinLimit) {
+    Config config;
+    config.max_stripes = 8;
+    StripedLockLRU storage(8 * 1024 * 1024, 4, config);
+    storage.Start();
+    const std::string value(1000, 'x');
+    for (int i = 0; i < 16000; i++) {
+        ASSERT_TRUE(storage.Put("old" + std::to_string(i), value));
+    }
+
+    // Writes go on while items are moved, but both tables together never take more than the limit
+    EXPECT_TRUE(storage.Resize(8));
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 2; t++) {
+        writers.emplace_back([&storage, &stop, &value, t]() {
+            for (int i = 0; !stop.load(); i++) {
+                EXPECT_TRUE(storage.Put("new" + std::to_string(t) + ":" + std::to_string(i % 10000), value));
+            }
+        });
+    }
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    std::map<std::string, std::string> by_name;
+    for (int i = 0; i < 10000 && storage.Resizing(); i++) {
+        stats.clear();
+        storage.Stats("", stats);
+        by_name = std::map<std::string, std::string>(stats.begin(), stats.end());
+        EXPECT_LE(std::stoull(by_name["bytes"]), std::stoull(by_name["limit_maxbytes"]));
+        EXPECT_LE(std::stoull(by_name["limit_maxbytes"]), 8 * 1024 * 1024);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    stop.store(true);
+    for (auto &t : writers) {
+        t.join();
+    }
+    storage.Stop();
+    EXPECT_FALSE(storage.Resizing());
+
+    stats.clear();
+    storage.Stats("", stats);
+    by_name = std::map<std::string, std::string>(stats.begin(), stats.end());
+    EXPECT_EQ(std::to_string(8 * 1024 * 1024), by_name["limit_maxbytes"]);
+    EXPECT_LE(std::stoull(by_name["bytes"]), 8 * 1024 * 1024);
+}
+
+TEST(StorageTest, ResizeOnContention) {
+    // Number of stripes is fixed unless storage is allowed to grow
+    StripedLockLRU fixed(16 * 1024 * 1024, 4);
+    EXPECT_FALSE(fixed.Resize(8));
+
+    Config config;
+    config.max_stripes = 8;
+    StripedLockLRU storage(16 * 1024 * 1024, 4, config);
+    storage.Start();
+
+    // Each round readers look the key up while mutation holds the lock of its stripe, so they find it busy
+    std::atomic<bool> stop(false);
+    std::atomic<int> round(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 8; t++) {
+        readers.emplace_back([&]() {
+            std::string value;
+            for (int seen = 0; !stop.load();) {
+                if (round.load() == seen) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                seen = round.load();
+                storage.Get("key", value);
+            }
+        });
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (storage.stripes() == 4 && std::chrono::steady_clock::now() < deadline) {
+        storage.Compute("key", [&round](bool found, const Current &current, Value &value) -> Afina::Storage::Action {
+            round++;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            value = Value("val");
+            return Afina::Storage::Action::kStore;
+        });
+    }
+    stop.store(true);
+    for (auto &t : readers) {
+        t.join();
+    }
+    storage.Stop();
+
+    EXPECT_EQ(8, storage.stripes());
+    EXPECT_FALSE(storage.Resize(16));
+    std::string value;
+    EXPECT_TRUE(storage.Get("key", value));
+    EXPECT_EQ("val", value);
+}
+
+TEST(StorageTest, CuckooFilter) {
+    CuckooFilter filter(1000);
+    for (long i = 0; i < 1000; i++) {
+        std::string key = std::to_string(i);
+        filter.Insert(CuckooFilter::Hash(key.data(), key.size()));
+    }
+    EXPECT_FALSE(filter.overflow());
+
+    // No false negatives, rare false positives
+    long positives = 0;
+    for (long i = 0; i < 2000; i++) {
+        std::string key = std::to_string(i);
+        bool found = filter.MayContain(CuckooFilter::Hash(key.data(), key.size()));
+        if (i < 1000) {
+            EXPECT_TRUE(found);
+        } else if (found) {
+            positives++;
+        }
+    }
+    EXPECT_LT(positives, 10);
+
+    for (long i = 0; i < 1000; i += 2) {
+        std::string key = std::to_string(i);
+        filter.Erase(CuckooFilter::Hash(key.data(), key.size()));
+    }
+    for (long i = 1; i < 1000; i += 2) {
+        std::string key = std::to_string(i);
+        EXPECT_TRUE(filter.MayContain(CuckooFilter::Hash(key.data(), key.size())));
+    }
+
+    // Too many keys: filter stops answering "absent"
+    for (long i = 0; i < 100000 && !filter.overflow(); i++) {
+        std::string key = "more" + std::to_string(i);
+        filter.Insert(CuckooFilter::Hash(key.data(), key.size()));
+    }
+    EXPECT_TRUE(filter.overflow());
+    EXPECT_TRUE(filter.MayContain(CuckooFilter::Hash("absent", 6)));
+}
+
+TEST(StorageTest, FilteredStripes) {
+    Config config;
+    config.filter = true;
+    StripedLockLRU storage(4 * 1024 * 1024, 4, config);
+    storage.Start();
+
+    // Way more items than filters are sized for initially, so they overflow and get rebuilt
+    const long n_keys = 200000;
+    std::vector<std::thread> clients;
+    for (int t = 0; t < 4; t++) {
+        clients.emplace_back([&storage, t]() {
+            std::string value;
+            for (long i = t; i < n_keys; i += 4) {
+                std::string key = std::to_string(i);
+                EXPECT_FALSE(storage.Get(key, value));
+                EXPECT_TRUE(storage.Put(key, "v"));
+                EXPECT_TRUE(storage.Get(key, value));
+                if (i % 5 == 0) {
+                    EXPECT_TRUE(storage.Delete(key));
+                    EXPECT_FALSE(storage.Delete(key));
+                    EXPECT_FALSE(storage.Set(key, "w"));
+                }
+            }
+        });
+    }
+    for (auto &t : clients) {
+        t.join();
+    }
+    storage.Stop();
+
+    std::string value;
+    for (long i = 0; i < n_keys; i++) {
+        EXPECT_EQ(i % 5 != 0, storage.Get(std::to_string(i), value));
+    }
+}
+
+TEST(StorageTest, ChunkedValue) {
+    Value value;
+    value.Append(std::string(Value::kChunkSize + 10, 'a'));
+    EXPECT_EQ(2, value.chunks());
+
+    // Shared chunk is never written again
+    Value copy = value;
+    copy.Append("bb");
+    EXPECT_EQ(3, copy.chunks());
+    EXPECT_EQ(Value::kChunkSize + 10, value.size());
+
+    copy.Truncate(Value::kChunkSize + 5);
+    EXPECT_EQ(2, copy.chunks());
+    EXPECT_EQ(std::string(Value::kChunkSize + 5, 'a'), copy.str());
+    EXPECT_EQ(std::string(Value::kChunkSize + 10, 'a'), value.str());
+}
+
+TEST(StorageTest, LargeValues) {
+    SimpleLRU storage(1024 * 1024);
+
+    Value large(std::string(3 * Value::kChunkSize, 'x'));
+    EXPECT_TRUE(storage.PutValue("KEY1", large));
+
+    // Chunks are shared with storage, not copied
+    Value out;
+    EXPECT_TRUE(storage.GetValue("KEY1", out));
+    EXPECT_EQ(large.chunks(), out.chunks());
+    EXPECT_EQ(large.chunk(0).data(), out.chunk(0).data());
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(large.str(), value);
+
+    // Large and small values replace each other
+    EXPECT_TRUE(storage.Put("KEY1", "small"));
+    EXPECT_TRUE(storage.GetValue("KEY1", out));
+    EXPECT_EQ("small", out.str());
+    EXPECT_EQ(4 + 5, storage.size());
+
+    EXPECT_TRUE(storage.Put("KEY1", std::string(2 * Value::kChunkSize, 'y')));
+    EXPECT_EQ(4 + 2 * Value::kChunkSize, storage.size());
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    EXPECT_EQ(0, storage.size());
+}
+
+TEST(StorageTest, HashIndexPolicies) {
+    ThreadSafeLRU<SpinLock, BasicLRU<HashIndex, NullCounters>> storage(100);
+
+    EXPECT_TRUE(storage.Put("KEY1", std::string(40, 'a')));
+    EXPECT_TRUE(storage.Put("KEY2", std::string(40, 'b')));
+    EXPECT_TRUE(storage.Set("KEY1", "val1"));
+    EXPECT_TRUE(storage.Put("KEY3", std::string(50, 'c')));
+
+    // KEY2 is the oldest one
+    std::string value;
+    EXPECT_FALSE(storage.Get("KEY2", value));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ("val1", value);
+    EXPECT_TRUE(storage.Delete("KEY3"));
+    EXPECT_EQ(8, storage.size());
+
+    // Nothing is counted
+    StorageStats stats;
+    storage.Snapshot(stats);
+    EXPECT_EQ(0, stats.get_hits + stats.get_misses + stats.cmd_set);
+    EXPECT_EQ(1, stats.curr_items);
+}
+
+TEST(StorageTest, ArtMap) {
+    // Keys share long prefixes, some of them are prefixes of the others
+    std::vector<std::string> keys = {""};
+    for (int i = 0; i < 3000; i++) {
+        keys.push_back("user:" + std::to_string(i % 700) + ":profile:settings:" + std::to_string(i));
+        keys.push_back("user:" + std::to_string(i));
+        keys.push_back(std::string(i % 40, 'x') + std::to_string(i % 256));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    ArtMap<KeyRef, std::size_t> art;
+    std::map<std::string, std::size_t> expected;
+    std::mt19937 rnd(1);
+    for (int round = 0; round < 100000; round++) {
+        std::size_t i = rnd() % keys.size();
+        if (rnd() % 3 == 0) {
+            EXPECT_EQ(expected.erase(keys[i]), art.erase(keys[i]));
+        } else {
+            EXPECT_EQ(expected.emplace(keys[i], i).second, art.emplace(keys[i], i).second);
+        }
+    }
+
+    EXPECT_EQ(expected.size(), art.size());
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        auto it = art.find(keys[i]);
+        ASSERT_EQ(expected.count(keys[i]) > 0, it != art.end()) << keys[i];
+        if (it != art.end()) {
+            EXPECT_EQ(i, it->second);
+        }
+    }
+
+    // Entries are visited in key order
+    auto next = expected.begin();
+    art.ForEach([&](std::pair<const KeyRef, std::size_t> &entry) {
+        ASSERT_TRUE(next != expected.end());
+        EXPECT_EQ(next->first, std::string(entry.first.data, entry.first.size));
+        next++;
+    });
+    EXPECT_TRUE(next == expected.end());
+
+    // Prefix walk gives the same entries as the range of ordered map
+    for (std::string prefix : {"", "u", "user:", "user:12", "user:123:profile:settings:", "xxxxxxxxxxxxxxxxx", "zz"}) {
+        std::vector<std::string> found;
+        art.ForEachPrefix(prefix, [&found](std::pair<const KeyRef, std::size_t> &entry) {
+            found.emplace_back(entry.first.data, entry.first.size);
+        });
+        std::vector<std::string> range;
+        for (auto it = expected.lower_bound(prefix); it != expected.end(); ++it) {
+            if (it->first.compare(0, prefix.size(), prefix) != 0) {
+                break;
+            }
+            range.push_back(it->first);
+        }
+        EXPECT_EQ(range, found) << prefix;
+    }
+
+    for (auto &key : keys) {
+        art.erase(key);
+    }
+    EXPECT_EQ(0, art.size());
+    EXPECT_EQ(0, art.memory());
+}
+
+TEST(StorageTest, ArtIndexStorage) {
+    BasicLRU<ArtIndex, Counters> storage(1000);
+
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(storage.Put("user:" + std::to_string(i), "val" + std::to_string(i)));
+    }
+
+    // The oldest ones are evicted
+    std::string value;
+    EXPECT_FALSE(storage.Get("user:0", value));
+    EXPECT_TRUE(storage.Get("user:99", value));
+    EXPECT_EQ("val99", value);
+    EXPECT_TRUE(storage.Delete("user:99"));
+    EXPECT_FALSE(storage.Get("user:99", value));
+    EXPECT_TRUE(storage.Set("user:98", "new"));
+    EXPECT_TRUE(storage.Get("user:98", value));
+    EXPECT_EQ("new", value);
+}
+
+template <typename Index> void CheckDeletePrefix() {
+    BasicLRU<Index, Counters> storage(100000);
+    for (int i = 0; i < 300; i++) {
+        EXPECT_TRUE(storage.Put("user:" + std::to_string(i % 30) + ":item:" + std::to_string(i), "val"));
+    }
+    EXPECT_TRUE(storage.Put("user:1", "val"));
+
+    // "user:1:" matches keys of the user 1 only, not 10..19 nor "user:1" itself
+    std::size_t deleted = 0;
+    EXPECT_TRUE(storage.DeletePrefix("user:1:", deleted));
+    EXPECT_EQ(10, deleted);
+    std::string value;
+    EXPECT_FALSE(storage.Get("user:1:item:31", value));
+    EXPECT_TRUE(storage.Get("user:11:item:41", value));
+    EXPECT_TRUE(storage.Get("user:1", value));
+
+    EXPECT_TRUE(storage.DeletePrefix("nobody:", deleted));
+    EXPECT_EQ(0, deleted);
+    EXPECT_TRUE(storage.DeletePrefix("", deleted));
+    EXPECT_EQ(291, deleted);
+    EXPECT_EQ(0, storage.count());
+    EXPECT_EQ(0, storage.size());
+}
+
+TEST(StorageTest, DeletePrefix) {
+    CheckDeletePrefix<OrderedIndex>();
+    CheckDeletePrefix<HashIndex>();
+    CheckDeletePrefix<ArtIndex>();
+
+    // Keys are found in both tables while resize is in progress
+    Config config;
+    config.max_stripes = 8;
+    StripedLockLRU striped(16 * 1024 * 1024, 4, config);
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_TRUE(striped.Put((i % 2 ? "a:" : "b:") + std::to_string(i), "val"));
+    }
+    EXPECT_TRUE(striped.Resize(8));
+    std::string value;
+    EXPECT_TRUE(striped.Get("a:1", value));
+
+    std::size_t deleted = 0;
+    EXPECT_TRUE(striped.DeletePrefix("a:", deleted));
+    EXPECT_EQ(500, deleted);
+    EXPECT_FALSE(striped.Get("a:1", value));
+    EXPECT_TRUE(striped.Get("b:0", value));
+
+    // Storage without support reports it
+    EpochLRU epoch(1000);
+    EXPECT_FALSE(epoch.DeletePrefix("a:", deleted));
+}
+
+TEST(StorageTest, TagInvalidation) {
+    SimpleLRU storage(1000);
+    EXPECT_TRUE(storage.PutTagged("user:1:name", "alice", "user:1"));
+    EXPECT_TRUE(storage.PutTagged("user:1:mail", "alice@", "user:1"));
+    EXPECT_TRUE(storage.PutTagged("user:2:name", "bob", "user:2"));
+    EXPECT_TRUE(storage.Put("plain", "val"));
+
+    // Invalidation costs nothing, items are dropped by the next access
+    EXPECT_TRUE(storage.InvalidateTag("user:1"));
+    EXPECT_TRUE(storage.InvalidateTag("unknown"));
+    EXPECT_EQ(4, storage.count());
+
+    std::string value;
+    EXPECT_FALSE(storage.Get("user:1:name", value));
+    EXPECT_FALSE(storage.Delete("user:1:mail"));
+    EXPECT_TRUE(storage.Get("user:2:name", value));
+    EXPECT_EQ("bob", value);
+    EXPECT_TRUE(storage.Get("plain", value));
+    EXPECT_EQ(2, storage.count());
+
+    // Items stored after invalidation are valid, plain Put drops the tag
+    EXPECT_TRUE(storage.PutTagged("user:1:name", "alice", "user:1"));
+    EXPECT_TRUE(storage.PutTagged("user:2:name", "bob", "user:2"));
+    EXPECT_TRUE(storage.Put("user:2:name", "robert"));
+    EXPECT_TRUE(storage.InvalidateTag("user:2"));
+    EXPECT_TRUE(storage.Get("user:1:name", value));
+    EXPECT_TRUE(storage.Get("user:2:name", value));
+    EXPECT_EQ("robert", value);
+    EXPECT_FALSE(storage.PutIfAbsent("user:2:name", "bob"));
+
+    // Stale item is gone for PutIfAbsent as well
+    EXPECT_TRUE(storage.InvalidateTag("user:1"));
+    EXPECT_TRUE(storage.PutIfAbsent("user:1:name", "alice"));
+}
+
+TEST(StorageTest, TagRecycling) {
+    EXPECT_THROW(TagRegistry(TagRegistry::kShards - 1), std::runtime_error);
+    EXPECT_THROW(TagRegistry(TagRegistry::kMaxTags + 1), std::runtime_error);
+
+    // Single id per shard, every new tag of the shard forgets the previous one and makes its items stale
+    auto tags = std::make_shared<TagRegistry>(TagRegistry::kShards);
+    SimpleLRU storage(100000);
+    storage.SetTagRegistry(tags);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(storage.PutTagged("key" + std::to_string(i), "val", "tag" + std::to_string(i)));
+    }
+    EXPECT_GE(TagRegistry::kShards, tags->size());
+
+    std::string value;
+    std::size_t alive = 0;
+    for (int i = 0; i < 100; i++) {
+        alive += storage.Get("key" + std::to_string(i), value);
+    }
+    EXPECT_EQ(tags->size(), alive);
+    EXPECT_TRUE(storage.Get("key99", value));
+
+    // Id of the forgotten tag goes to the new one, that doesn't bring old items back
+    EXPECT_TRUE(storage.PutTagged("key0", "val", "tag0"));
+    EXPECT_TRUE(storage.Get("key0", value));
+    EXPECT_TRUE(storage.InvalidateTag("tag0"));
+    EXPECT_FALSE(storage.Get("key0", value));
+}
+
+TEST(StorageTest, TagInvalidationStriped) {
+    Config config;
+    config.max_stripes = 8;
+    StripedLockLRU storage(16 * 1024 * 1024, 4, config);
+    for (int i = 0; i < 1000; i++) {
+        std::string key = std::to_string(i);
+        EXPECT_TRUE(storage.PutTagged(key, "v" + key, i % 2 ? "odd" : "even"));
+    }
+
+    // Tags survive migration between stripes, and invalidation reaches items of both tables
+    EXPECT_TRUE(storage.Resize(8));
+    std::string value;
+    EXPECT_TRUE(storage.Get("1", value));
+    EXPECT_TRUE(storage.InvalidateTag("odd"));
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(i % 2 == 0, storage.Get(std::to_string(i), value)) << i;
+    }
+
+    // Storage without support reports it
+    EpochLRU epoch(1000);
+    EXPECT_FALSE(epoch.PutTagged("key", "val", "tag"));
+    EXPECT_FALSE(epoch.InvalidateTag("tag"));
+}
+
+TEST(StorageTest, LogStructuredOperations) {
+    LogStructuredLRU storage(16 * 1024, 1024);
+    EXPECT_EQ(1024, storage.segment_size());
+    EXPECT_THROW(LogStructuredLRU(2048, 1024), std::runtime_error);
+
+    // Default segments are never tiny, limit too small for them is rejected
+    EXPECT_THROW(LogStructuredLRU(1024), std::runtime_error);
+    EXPECT_EQ(256 * 1024, LogStructuredLRU(1024 * 1024).segment_size());
+
+    std::string value;
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY1", "val2"));
+    EXPECT_TRUE(storage.PutIfAbsent("KEY2", "val2"));
+    EXPECT_FALSE(storage.Set("KEY3", "val3"));
+    EXPECT_TRUE(storage.Set("KEY2", "new2"));
+    EXPECT_TRUE(storage.Get("KEY2", value));
+    EXPECT_EQ("new2", value);
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+
+    // Item must fit into a segment
+    EXPECT_FALSE(storage.Put("KEY4", std::string(1024, 'a')));
+    EXPECT_TRUE(storage.Put("KEY4", std::string(1000, 'a')));
+    EXPECT_EQ("2", StorageStat(storage, "curr_items"));
+}
+
+TEST(StorageTest, LogStructuredChurn) {
+    // Values of varied sizes keep replacing each other, live data is a fraction of the limit
+    LogStructuredLRU storage(64 * 1024, 4 * 1024);
+    std::map<std::string, std::string> expected;
+    std::mt19937 rnd(1);
+    for (int i = 0; i < 20000; i++) {
+        std::string key = "key" + std::to_string(rnd() % 100);
+        std::string value(rnd() % 300, 'a' + i % 26);
+        if (rnd() % 10 == 0) {
+            storage.Delete(key);
+            expected.erase(key);
+        } else {
+            ASSERT_TRUE(storage.Put(key, value));
+            expected[key] = value;
+        }
+        if (i % 7 == 0) {
+            storage.Clean();
+        }
+    }
+
+    // Dead bytes were reclaimed by cleaning, nothing had to be evicted
+    std::string value;
+    for (auto &item : expected) {
+        ASSERT_TRUE(storage.Get(item.first, value)) << item.first;
+        EXPECT_EQ(item.second, value);
+    }
+    EXPECT_EQ(std::to_string(expected.size()), StorageStat(storage, "curr_items"));
+    EXPECT_EQ("0", StorageStat(storage, "evictions"));
+    EXPECT_NE("0", StorageStat(storage, "log_cleaned_segments"));
+}
+
+TEST(StorageTest, LogStructuredCleanBatches) {
+    LogStructuredLRU storage(1024 * 1024, 256 * 1024);
+    std::string value;
+    for (int i = 0; i < 50; i++) {
+        EXPECT_TRUE(storage.Put("live" + std::to_string(i), std::string(1000, 'l')));
+    }
+    for (int i = 0; i < 600; i++) {
+        EXPECT_TRUE(storage.Put("dead" + std::to_string(i % 10), std::string(1000, 'd')));
+    }
+
+    // Each call goes through a batch of the segment only, lock is released in between
+    EXPECT_TRUE(storage.Clean());
+    EXPECT_EQ("0", StorageStat(storage, "log_cleaned_segments"));
+    for (int i = 0; i < 50; i++) {
+        EXPECT_TRUE(storage.Get("live" + std::to_string(i), value));
+    }
+
+    // Put that runs out of segments finishes the cleaning that is in progress
+    for (int i = 0; i < 300; i++) {
+        EXPECT_TRUE(storage.Put("dead" + std::to_string(i % 10), std::string(1000, 'd')));
+    }
+    EXPECT_NE("0", StorageStat(storage, "log_cleaned_segments"));
+    while (storage.Clean()) {
+    }
+    for (int i = 0; i < 50; i++) {
+        EXPECT_TRUE(storage.Get("live" + std::to_string(i), value));
+        EXPECT_EQ(std::string(1000, 'l'), value);
+    }
+    EXPECT_EQ("0", StorageStat(storage, "evictions"));
+}
+
+TEST(StorageTest, LogStructuredEviction) {
+    LogStructuredLRU storage(16 * 1024, 1024);
+    std::string value;
+    EXPECT_TRUE(storage.Put("hot", "value"));
+    for (int i = 0; i < 2000; i++) {
+        EXPECT_TRUE(storage.Put("cold" + std::to_string(i), std::string(100, 'c')));
+
+        // Referenced item is moved out of the segment being evicted
+        EXPECT_TRUE(storage.Get("hot", value));
+    }
+
+    EXPECT_FALSE(storage.Get("cold0", value));
+    EXPECT_TRUE(storage.Get("cold1999", value));
+    EXPECT_NE("0", StorageStat(storage, "evictions"));
+    EXPECT_NE("0", StorageStat(storage, "log_evicted_segments"));
+}
+
+TEST(StorageTest, LogStructuredConcurrent) {
+    const long n_keys = 2000;
+    LogStructuredLRU storage(1024 * 1024, 16 * 1024);
+    storage.Start();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&storage, t]() {
+            std::string value;
+            for (int round = 0; round < 5; round++) {
+                for (long i = t; i < n_keys; i += 4) {
+                    std::string key = std::to_string(i);
+                    EXPECT_TRUE(storage.Put(key, std::string(i % 200, 'a' + round)));
+                    EXPECT_TRUE(storage.Get(key, value));
+                    EXPECT_EQ(std::string(i % 200, 'a' + round), value);
+                }
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    storage.Stop();
+
+    std::string value;
+    for (long i = 0; i < n_keys; i++) {
+        EXPECT_TRUE(storage.Get(std::to_string(i), value));
+        EXPECT_EQ(std::string(i % 200, 'e'), value);
+    }
+}
+
+TEST(StorageTest, FixedWidthOperations) {
+    FixedWidthLRU<8> storage(64 * 1024);
+    std::string value;
+    EXPECT_TRUE(storage.Put("counter", "00000001"));
+    EXPECT_TRUE(storage.Get("counter", value));
+    EXPECT_EQ("00000001", value);
+
+    EXPECT_FALSE(storage.PutIfAbsent("counter", "00000002"));
+    EXPECT_TRUE(storage.Set("counter", "00000003"));
+    EXPECT_FALSE(storage.Set("absent", "00000003"));
+    EXPECT_TRUE(storage.Get("counter", value));
+    EXPECT_EQ("00000003", value);
+
+    // Only values of the store width and short keys fit
+    EXPECT_FALSE(storage.Put("counter", "1"));
+    EXPECT_FALSE(storage.Put(std::string(FixedWidthLRU<8>::kMaxKey + 1, 'k'), "00000001"));
+    EXPECT_TRUE(storage.Put(std::string(FixedWidthLRU<8>::kMaxKey, 'k'), "00000001"));
+
+    EXPECT_TRUE(storage.Delete("counter"));
+    EXPECT_FALSE(storage.Delete("counter"));
+    EXPECT_FALSE(storage.Get("counter", value));
+
+    StorageStats stats;
+    storage.Snapshot(stats);
+    EXPECT_EQ(1, stats.curr_items);
+    EXPECT_EQ(FixedWidthLRU<8>::kMaxKey + 8, stats.bytes);
+}
+
+TEST(StorageTest, FixedWidthCapacity) {
+    // Table takes the whole limit, the number of groups needn't be a power of 2
+    const std::size_t slot_size = 1 + FixedWidthLRU<8>::kKeySlot + 8;
+    FixedWidthLRU<8> storage(3 * FixedWidthLRU<8>::kGroup * slot_size);
+    EXPECT_EQ(3 * FixedWidthLRU<8>::kGroup, storage.capacity());
+
+    std::string value;
+    for (std::size_t i = 0; i < storage.max_items(); i++) {
+        EXPECT_TRUE(storage.Put("key" + std::to_string(i), "00000000"));
+    }
+    for (std::size_t i = 0; i < storage.max_items(); i++) {
+        EXPECT_TRUE(storage.Get("key" + std::to_string(i), value));
+    }
+
+    StorageStats stats;
+    storage.Snapshot(stats);
+    EXPECT_EQ(storage.max_items(), stats.curr_items);
+    EXPECT_EQ(0, stats.evictions);
+}
+
+TEST(StorageTest, FixedWidthChurn) {
+    // Keys never exceed the limit, so deleted slots pile up and table gets rebuilt instead of evicting
+    FixedWidthLRU<16> storage(64 * 1024);
+    const int n_keys = storage.max_items() - 16;
+    std::map<std::string, std::string> model;
+    std::mt19937 gen(42);
+    std::string value;
+    for (int i = 0; i < 100000; i++) {
+        std::string key = "record:" + std::to_string(gen() % n_keys);
+        switch (gen() % 3) {
+        case 0: {
+            std::string record = std::to_string(i);
+            record.resize(16, '.');
+            EXPECT_TRUE(storage.Put(key, record));
+            model[key] = record;
+            break;
+        }
+        case 1:
+            EXPECT_EQ(model.erase(key) > 0, storage.Delete(key));
+            break;
+        default:
+            ASSERT_EQ(model.count(key) > 0, storage.Get(key, value));
+            if (model.count(key) > 0) {
+                EXPECT_EQ(model[key], value);
+            }
+        }
+    }
+
+    StorageStats stats;
+    storage.Snapshot(stats);
+    EXPECT_EQ(model.size(), stats.curr_items);
+    EXPECT_EQ(0, stats.evictions);
+}
+
+TEST(StorageTest, FixedWidthEviction) {
+    FixedWidthLRU<8> storage(16 * 1024);
+    std::string value;
+    EXPECT_TRUE(storage.Put("hot", "hotvalue"));
+    for (int i = 0; i < 10000; i++) {
+        EXPECT_TRUE(storage.Put("cold" + std::to_string(i), "coldcold"));
+
+        // Referenced item survives every pass of the CLOCK hand
+        EXPECT_TRUE(storage.Get("hot", value));
+    }
+
+    EXPECT_FALSE(storage.Get("cold0", value));
+    EXPECT_TRUE(storage.Get("cold9999", value));
+
+    StorageStats stats;
+    storage.Snapshot(stats);
+    // Evicted items may leave deleted slots behind until the table is rebuilt
+    EXPECT_GE(stats.curr_items, storage.max_items() - storage.max_items() / 16 - 1);
+    EXPECT_EQ(10001 - stats.curr_items, stats.evictions);
+}
+
+TEST(StorageTest, Dedup) {
+    SimpleLRU storage(1000);
+    storage.EnableDedup(16);
+    const std::string config(100, 'c');
+    EXPECT_TRUE(storage.Put("a", config));
+    EXPECT_TRUE(storage.Put("b", config));
+    EXPECT_TRUE(storage.PutIfAbsent("c", config));
+
+    // Shared bytes are charged once
+    EXPECT_EQ(3 + 100, storage.size());
+    StorageStats stats;
+    storage.Snapshot(stats);
+    EXPECT_EQ(1, stats.dedup_values);
+    EXPECT_EQ(3, stats.dedup_items);
+    EXPECT_EQ(200, stats.dedup_saved_bytes);
+
+    // Update moves the item away from the shared copy, others keep it
+    std::string value;
+    EXPECT_TRUE(storage.Set("b", std::string(100, 'x')));
+    EXPECT_TRUE(storage.Get("a", value));
+    EXPECT_EQ(config, value);
+    EXPECT_TRUE(storage.Get("b", value));
+    EXPECT_EQ(std::string(100, 'x'), value);
+    EXPECT_EQ(3 + 200, storage.size());
+
+    // Short values are never shared
+    EXPECT_TRUE(storage.Put("d", "short"));
+    EXPECT_TRUE(storage.Put("e", "short"));
+    EXPECT_EQ(5 + 200 + 10, storage.size());
+
+    EXPECT_TRUE(storage.Delete("a"));
+    EXPECT_EQ(4 + 200 + 10, storage.size());
+    EXPECT_TRUE(storage.Delete("c"));
+    EXPECT_EQ(3 + 100 + 10, storage.size());
+
+    stats = StorageStats();
+    storage.Snapshot(stats);
+    EXPECT_EQ(1, stats.dedup_values);
+    EXPECT_EQ(0, stats.dedup_saved_bytes);
+}
+
+TEST(StorageTest, DedupEviction) {
+    // Ten copies would never fit, shared one takes just its keys
+    SimpleLRU storage(300);
+    storage.EnableDedup(16);
+    const std::string config(200, 'c');
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(storage.Put("key" + std::to_string(i), config));
+    }
+    EXPECT_EQ(10, storage.count());
+    EXPECT_EQ(40 + 200, storage.size());
+
+    // Evicting items that share the value frees only their keys, until the last one goes
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(storage.Put("other" + std::to_string(i), std::string(200, 'a' + i)));
+        EXPECT_LE(storage.size(), 300);
+    }
+    std::string value;
+    EXPECT_FALSE(storage.Get("key9", value));
+    EXPECT_TRUE(storage.Get("other9", value));
+    EXPECT_EQ(std::string(200, 'a' + 9), value);
+
+    StorageStats stats;
+    storage.Snapshot(stats);
+    EXPECT_EQ(0, stats.dedup_saved_bytes);
+    EXPECT_EQ(storage.count(), stats.dedup_items);
+}
+
+TEST(StorageTest, DedupChunkedValues) {
+    SimpleLRU from(1024 * 1024), to(1024 * 1024);
+    from.EnableDedup(16);
+    to.EnableDedup(16);
+
+    Value large(std::string(3 * Value::kChunkSize / 2, 'l'));
+    EXPECT_TRUE(from.PutValue("first", large));
+    EXPECT_TRUE(from.Put("second", large.str()));
+    EXPECT_EQ(11 + large.size(), from.size());
+
+    // Value moved into the other cache is shared there as well
+    Value moved;
+    EXPECT_TRUE(from.Extract("first", moved));
+    EXPECT_TRUE(to.Adopt("first", moved, true));
+    EXPECT_TRUE(to.Adopt("again", moved, false));
+    EXPECT_EQ(10 + large.size(), to.size());
+    EXPECT_EQ(6 + large.size(), from.size());
+
+    Value out;
+    EXPECT_TRUE(to.GetValue("again", out));
+    EXPECT_EQ(large.str(), out.str());
+}
+
+TEST(StorageTest, DedupStriped) {
+    Config config;
+    config.dedup_threshold = 16;
+    StripedLockLRU storage(4 * 1024 * 1024, 4, config);
+    const std::string config_value(500, 'c');
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(storage.Put("key" + std::to_string(i), config_value));
+    }
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.Stats("", stats);
+    std::map<std::string, std::string> by_name(stats.begin(), stats.end());
+    EXPECT_EQ("100", by_name["dedup_items"]);
+
+    // Every stripe keeps its own copy
+    EXPECT_GE(4, std::stoi(by_name["dedup_values"]));
+    EXPECT_EQ(std::to_string((100 - std::stoi(by_name["dedup_values"])) * 500), by_name["dedup_saved_bytes"]);
+}
+
+TEST(StorageTest, GetItem) {
+    SimpleLRU storage(1024 * 1024);
+    EXPECT_TRUE(storage.Put("small", "value"));
+    Value large(std::string(Value::kChunkSize + 1, 'l'));
+    EXPECT_TRUE(storage.PutValue("large", large));
+
+    Value out;
+    EXPECT_TRUE(storage.GetItem("small", out));
+    EXPECT_FALSE(storage.GetItem("absent", out));
+    EXPECT_TRUE(storage.GetItem("large", out));
+    EXPECT_EQ("VALUE small 0 5\r\nvalue\r\nVALUE large 0 " + std::to_string(large.size()) + "\r\n" + large.str() +
+                  "\r\n",
+              out.str());
+
+    // Plain reads see only the value bytes, accounting isn't charged for the header
+    std::string value;
+    EXPECT_TRUE(storage.Get("small", value));
+    EXPECT_EQ("value", value);
+    EXPECT_TRUE(storage.Set("small", "v"));
+    EXPECT_TRUE(storage.Get("small", value));
+    EXPECT_EQ("v", value);
+    EXPECT_EQ(5 + 1 + 5 + large.size(), storage.size());
+
+    StorageStats stats;
+    storage.Snapshot(stats);
+    EXPECT_EQ(4, stats.get_hits);
+    EXPECT_EQ(1, stats.get_misses);
+}
+
+static void CheckCompute(Afina::Storage &storage) {
+    auto append = [](bool found, const Current &current, Value &value) -> Afina::Storage::Action {
+        if (!found) {
+            return Afina::Storage::Action::kKeep;
+        }
+        current.Read(value);
+        value.Append("+", 1);
+        return Afina::Storage::Action::kStore;
+    };
+
+    // Conditional update of the absent key changes nothing
+    EXPECT_FALSE(storage.Compute("key", append));
+    std::string value;
+    EXPECT_FALSE(storage.Get("key", value));
+
+    EXPECT_TRUE(storage.Compute("key", [](bool found, const Current &current, Value &value) -> Afina::Storage::Action {
+        EXPECT_FALSE(found);
+        EXPECT_TRUE(value.empty());
+        value = Value("12345678");
+        return Afina::Storage::Action::kStore;
+    }));
+    EXPECT_TRUE(storage.Get("key", value));
+    EXPECT_EQ("12345678", value);
+
+    EXPECT_FALSE(storage.Compute("key", [](bool found, const Current &current, Value &value) -> Afina::Storage::Action {
+        EXPECT_TRUE(found);
+        EXPECT_TRUE(value.empty());
+        current.Read(value);
+        EXPECT_EQ("12345678", value.str());
+        return Afina::Storage::Action::kKeep;
+    }));
+    EXPECT_TRUE(storage.Compute("key", [](bool found, const Current &current, Value &value) -> Afina::Storage::Action {
+        value = Value("87654321");
+        return Afina::Storage::Action::kStore;
+    }));
+    EXPECT_TRUE(storage.Get("key", value));
+    EXPECT_EQ("87654321", value);
+
+    auto erase = [](bool found, const Current &current, Value &value) -> Afina::Storage::Action {
+        return Afina::Storage::Action::kDelete;
+    };
+    EXPECT_TRUE(storage.Compute("key", erase));
+    EXPECT_FALSE(storage.Get("key", value));
+    EXPECT_FALSE(storage.Compute("key", erase));
+}
+
+TEST(StorageTest, Compute) {
+    SimpleLRU simple(1024 * 1024);
+    ThreadSafeSimplLRU thread_safe(1024 * 1024);
+    StripedLockLRU striped(16 * 1024 * 1024, 4);
+    FlatCombinedLRU combined(1024 * 1024);
+    EpochLRU epoch(1024 * 1024);
+    LogStructuredLRU log(1024 * 1024, 64 * 1024);
+    FixedWidthLRU<8> fixed(64 * 1024);
+    for (Afina::Storage *storage : std::initializer_list<Afina::Storage *>{
+             &simple, &thread_safe, &striped, &combined, &epoch, &log, &fixed}) {
+        CheckCompute(*storage);
+    }
+
+    // Value that doesn't fit isn't stored, the old one stays
+    SimpleLRU small(16);
+    EXPECT_TRUE(small.Put("k", "v"));
+    EXPECT_FALSE(small.Compute("k", [](bool found, const Current &current, Value &value) -> Afina::Storage::Action {
+        current.Read(value);
+        value.Append(std::string(16, 'x'));
+        return Afina::Storage::Action::kStore;
+    }));
+    std::string value;
+    EXPECT_TRUE(small.Get("k", value));
+    EXPECT_EQ("v", value);
+
+    // Append to the large value shares its chunks
+    Value large(std::string(Value::kChunkSize + 1, 'l'));
+    EXPECT_TRUE(simple.PutValue("large", large));
+    auto append_tail = [&large](bool found, const Current &current, Value &value) -> Afina::Storage::Action {
+        current.Read(value);
+        EXPECT_EQ(&large.chunk(0), &value.chunk(0));
+        value.Append("tail", 4);
+        return Afina::Storage::Action::kStore;
+    };
+    EXPECT_TRUE(simple.Compute("large", append_tail));
+    Value stored;
+    EXPECT_TRUE(simple.GetValue("large", stored));
+    EXPECT_EQ(large.str() + "tail", stored.str());
+    EXPECT_EQ(&large.chunk(0), &stored.chunk(0));
+}
+
+TEST(StorageTest, ComputeConcurrent) {
+    // Appends of concurrent threads to the same keys are never lost
+    const int n_threads = 4, n_appends = 500;
+    ThreadSafeSimplLRU thread_safe(1024 * 1024);
+    StripedLockLRU striped(16 * 1024 * 1024, 4);
+    FlatCombinedLRU combined(1024 * 1024);
+    for (Afina::Storage *storage :
+         std::initializer_list<Afina::Storage *>{&thread_safe, &striped, &combined}) {
+        EXPECT_TRUE(storage->Put("a", ""));
+        EXPECT_TRUE(storage->Put("b", ""));
+
+        auto append = [](bool found, const Current &current, Value &value) -> Afina::Storage::Action {
+            current.Read(value);
+            value.Append("x", 1);
+            return Afina::Storage::Action::kStore;
+        };
+        std::vector<std::thread> threads;
+        for (int t = 0; t < n_threads; t++) {
+            threads.emplace_back([storage, &append]() {
+                for (int i = 0; i < n_appends; i++) {
+                    EXPECT_TRUE(storage->Compute(i % 2 ? "a" : "b", append));
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+
+        std::string value;
+        EXPECT_TRUE(storage->Get("a", value));
+        EXPECT_EQ(n_threads * n_appends / 2, value.size());
+        EXPECT_TRUE(storage->Get("b", value));
+        EXPECT_EQ(n_threads * n_appends / 2, value.size());
+    }
+}
+
+TEST(StorageTest, AppendPrepend) {
+    SimpleLRU storage(1024 * 1024);
+    EXPECT_FALSE(storage.Append("key", Value("data")));
+    EXPECT_FALSE(storage.Prepend("key", Value("data")));
+
+    // Small value grows in its response form, header follows the size
+    EXPECT_TRUE(storage.Put("key", "12345678"));
+    EXPECT_TRUE(storage.Append("key", Value("9")));
+    EXPECT_TRUE(storage.Append("key", Value("0")));
+    EXPECT_TRUE(storage.Prepend("key", Value("<")));
+    Value out;
+    EXPECT_TRUE(storage.GetItem("key", out));
+    EXPECT_EQ("VALUE key 0 11\r\n<1234567890\r\n", out.str());
+    EXPECT_EQ(3 + 11, storage.size());
+
+    // Value outgrows the response form
+    std::string expected = "<1234567890";
+    while (expected.size() <= 2 * Value::kChunkSize) {
+        std::string piece(1000, 'a' + expected.size() % 26);
+        EXPECT_TRUE(storage.Append("key", Value(piece)));
+        expected += piece;
+    }
+    EXPECT_TRUE(storage.Prepend("key", Value(">")));
+    expected = ">" + expected;
+    std::string value;
+    EXPECT_TRUE(storage.Get("key", value));
+    EXPECT_EQ(expected, value);
+    EXPECT_EQ(3 + expected.size(), storage.size());
+
+    // Chunks readers hold are left intact, pieces written next to them are compacted once they pile up
+    Value held;
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(storage.GetValue("key", held));
+        std::string before = held.str();
+        EXPECT_TRUE(storage.Append("key", Value("x")));
+        EXPECT_TRUE(storage.Prepend("key", Value("y")));
+        expected = "y" + expected + "x";
+        EXPECT_EQ(before, held.str());
+    }
+    EXPECT_TRUE(storage.GetValue("key", held));
+    EXPECT_EQ(expected, held.str());
+    EXPECT_FALSE(held.fragmented());
+    EXPECT_EQ(3 + expected.size(), storage.size());
+
+    // Append evicts others, but never the item itself
+    SimpleLRU small(64);
+    EXPECT_TRUE(small.Put("a", std::string(20, 'a')));
+    EXPECT_TRUE(small.Put("b", std::string(20, 'b')));
+    EXPECT_TRUE(small.Append("a", Value(std::string(30, 'a'))));
+    EXPECT_FALSE(small.Get("b", value));
+    EXPECT_TRUE(small.Get("a", value));
+    EXPECT_EQ(std::string(50, 'a'), value);
+    EXPECT_FALSE(small.Append("a", Value(std::string(20, 'a'))));
+    EXPECT_EQ(51, small.size());
+
+    // Storages without native support append through Compute
+    EpochLRU epoch(1024);
+    EXPECT_FALSE(epoch.Append("key", Value("data")));
+    EXPECT_TRUE(epoch.Put("key", "b"));
+    EXPECT_TRUE(epoch.Append("key", Value("c")));
+    EXPECT_TRUE(epoch.Prepend("key", Value("a")));
+    EXPECT_TRUE(epoch.Get("key", value));
+    EXPECT_EQ("abc", value);
+}
+
+TEST(StorageTest, FlushAll) {
+    SimpleLRU storage(1000);
+    EXPECT_TRUE(storage.Put("a", "1"));
+    EXPECT_TRUE(storage.PutTagged("b", "2", "tag"));
+    EXPECT_TRUE(storage.Put("c", "3"));
+
+    // Flush costs nothing, items are dropped by the next access
+    EXPECT_TRUE(storage.FlushAll(0));
+    EXPECT_EQ(3, storage.count());
+    std::string value;
+    EXPECT_FALSE(storage.Get("a", value));
+    EXPECT_FALSE(storage.Delete("b"));
+    EXPECT_TRUE(storage.PutIfAbsent("c", "4"));
+    EXPECT_TRUE(storage.Get("c", value));
+    EXPECT_EQ("4", value);
+    EXPECT_EQ(1, storage.count());
+
+    // Flushed items are the oldest ones, but live item moved in as the oldest doesn't stop the pass
+    EXPECT_TRUE(storage.Put("d", "5"));
+    EXPECT_TRUE(storage.FlushAll(0));
+    EXPECT_TRUE(storage.Put("e", "6"));
+    EXPECT_TRUE(storage.PutTagged("f", "7", "tag"));
+    EXPECT_TRUE(storage.Adopt("g", Value("8"), true));
+    std::size_t dropped;
+    EXPECT_TRUE(storage.DropStale(1, dropped));
+    EXPECT_EQ(0, dropped);
+    EXPECT_TRUE(storage.DropStale(1, dropped));
+    EXPECT_EQ(1, dropped);
+    EXPECT_FALSE(storage.DropStale(100, dropped));
+    EXPECT_EQ(1, dropped);
+    EXPECT_FALSE(storage.DropStale(100, dropped));
+    EXPECT_EQ(0, dropped);
+    EXPECT_EQ(3, storage.count());
+    EXPECT_TRUE(storage.Get("g", value));
+    EXPECT_TRUE(storage.Get("e", value));
+    EXPECT_TRUE(storage.Get("f", value));
+
+    // Item the pass stopped at could be removed in between, pass goes on from the next one
+    EXPECT_TRUE(storage.FlushAll(0));
+    EXPECT_TRUE(storage.DropStale(1, dropped));
+    EXPECT_EQ(1, dropped);
+    EXPECT_FALSE(storage.Get("e", value));
+    EXPECT_FALSE(storage.DropStale(100, dropped));
+    EXPECT_EQ(1, dropped);
+    EXPECT_EQ(0, storage.count());
+
+    // Delayed flush invalidates items stored before the deadline only
+    auto tags = std::make_shared<TagRegistry>();
+    SimpleLRU delayed(1000);
+    delayed.SetTagRegistry(tags);
+    EXPECT_TRUE(delayed.Put("a", "1"));
+    tags->Flush(std::chrono::milliseconds(50));
+    EXPECT_TRUE(delayed.Put("b", "2"));
+    EXPECT_TRUE(delayed.Get("a", value));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    EXPECT_FALSE(delayed.Get("a", value));
+    EXPECT_FALSE(delayed.Get("b", value));
+    EXPECT_TRUE(delayed.Put("c", "3"));
+    EXPECT_TRUE(delayed.Get("c", value));
+    EXPECT_EQ(1, tags->Flushes());
+}
+
+TEST(StorageTest, FlushAllStriped) {
+    StripedLockLRU storage(16 * 1024 * 1024, 4);
+    storage.Start();
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_TRUE(storage.Put("key" + std::to_string(i), "val"));
+    }
+    EXPECT_TRUE(storage.FlushAll(0));
+    EXPECT_TRUE(storage.Put("fresh", "val"));
+
+    std::string value;
+    EXPECT_FALSE(storage.Get("key1", value));
+    EXPECT_TRUE(storage.Get("fresh", value));
+
+    // Background thread removes the rest
+    std::string items;
+    for (int i = 0; i < 1000 && items != "1"; i++) {
+        std::vector<std::pair<std::string, std::string>> stats;
+        storage.Stats("", stats);
+        for (auto &stat : stats) {
+            if (stat.first == "curr_items") {
+                items = stat.second;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ("1", items);
+    storage.Stop();
+
+    // Storage without generations reports it
+    EpochLRU epoch(1000);
+    EXPECT_FALSE(epoch.FlushAll(0));
+}
+
+// Cache aside over the working set of n items of 100 bytes each, read in cycles
+static void ReadInCycles(Afina::Storage &storage, int n, int rounds) {
+    std::string value;
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < n; i++) {
+            std::string key = "key" + std::to_string(100000 + i);
+            if (!storage.Get(key, value)) {
+                storage.Put(key, std::string(100 - key.size(), 'v'));
+            }
+        }
+    }
+}
+
+TEST(StorageTest, MissRatioCurve) {
+    // Working set is 1.5 times the storage: LRU misses every get, but would hit all repeated ones at 2x
+    SimpleLRU storage(10000);
+    storage.EnableMissRatioCurve(1.0);
+    ReadInCycles(storage, 150, 10);
+
+    StorageStats stats;
+    storage.Snapshot(stats);
+    EXPECT_EQ(0, stats.get_hits);
+    EXPECT_EQ(1500, stats.mrc_gets);
+    EXPECT_EQ(0, stats.mrc_hits_half);
+    EXPECT_EQ(0, stats.mrc_hits_1x);
+    EXPECT_EQ(1350, stats.mrc_hits_2x);
+    EXPECT_EQ(1350, stats.mrc_hits_4x);
+
+    // Deleted item misses at any size
+    MissRatioCurve curve(1000, 1.0);
+    curve.Access(1, 100, false);
+    curve.Access(1, 0, true);
+    curve.Erase(1);
+    curve.Access(1, 0, true);
+    EXPECT_EQ(0, curve.size());
+    StorageStats erased;
+    curve.Collect(erased);
+    EXPECT_EQ(2, erased.mrc_gets);
+    EXPECT_EQ(1, erased.mrc_hits_half);
+
+    // Key left behind by the others is accessed right when the tree is compacted, it is still tracked after that
+    MissRatioCurve compacted(1000, 1.0);
+    for (uint64_t hash = 1; hash <= MissRatioCurve::kMinTimes; hash++) {
+        compacted.Access(hash, 10, false);
+    }
+    compacted.Access(1, 0, true);
+    compacted.Access(1, 0, true);
+    StorageStats reaccessed;
+    compacted.Collect(reaccessed);
+    EXPECT_EQ(2, reaccessed.mrc_gets);
+    EXPECT_EQ(1, reaccessed.mrc_hits_half);
+}
+
+TEST(StorageTest, MissRatioCurveSampled) {
+    // Tenth of the keys is enough to tell hit ratio of the twice larger storage
+    Config config;
+    config.mrc_sample_rate = 0.1;
+    StripedLockLRU storage(4 * 1024 * 1024, 4, config);
+    ReadInCycles(storage, 63000, 4);
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.Stats("", stats);
+    std::map<std::string, std::string> by_name(stats.begin(), stats.end());
+    EXPECT_EQ("0", by_name["get_hits"]);
+    EXPECT_GT(std::stoi(by_name["mrc_gets"]), 4 * 63000 / 20);
+    EXPECT_LT(std::stod(by_name["mrc_hit_ratio_1x"]), 0.05);
+    EXPECT_GT(std::stod(by_name["mrc_hit_ratio_2x"]), 0.7);
+    EXPECT_GE(std::stod(by_name["mrc_hit_ratio_4x"]), std::stod(by_name["mrc_hit_ratio_2x"]));
+
+    // Curve isn't reported unless it is estimated
+    SimpleLRU plain(1000);
+    stats.clear();
+    plain.Stats("", stats);
+    for (auto &stat : stats) {
+        EXPECT_NE(0, stat.first.compare(0, 4, "mrc_"));
+    }
+}
+
+// Directory that looks like cgroup v2 to the governor
+class FakeCgroup {
+public:
+    FakeCgroup() {
+        char dir[] = "/tmp/afina-cgroup-XXXXXX";
+        _dir = mkdtemp(dir);
+    }
+    ~FakeCgroup() {
+        for (auto name : {"memory.current", "memory.max", "memory.pressure"}) {
+            std::remove((_dir + "/" + name).c_str());
+        }
+        rmdir(_dir.c_str());
+    }
+
+    void Set(uint64_t current, const std::string &max, double pressure) {
+        std::ofstream(_dir + "/memory.current") << current << "\n";
+        std::ofstream(_dir + "/memory.max") << max << "\n";
+        std::ofstream(_dir + "/memory.pressure") << "some avg10=" << pressure << " avg60=0.00 avg300=0.00 total=1\n"
+                                                 << "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n";
+    }
+
+    const std::string &dir() const { return _dir; }
+
+private:
+    std::string _dir;
+};
+
+TEST(StorageTest, MemoryGovernorSignals) {
+    FakeCgroup cgroup;
+    MemoryGovernor::Signals signals;
+    MemoryGovernor::Read(cgroup.dir(), signals);
+    EXPECT_FALSE(signals.has_usage);
+    EXPECT_FALSE(signals.has_pressure);
+
+    cgroup.Set(300, "1000", 2.5);
+    MemoryGovernor::Read(cgroup.dir(), signals);
+    EXPECT_TRUE(signals.has_usage);
+    EXPECT_EQ(300, signals.current);
+    EXPECT_EQ(1000, signals.max);
+    EXPECT_TRUE(signals.has_pressure);
+    EXPECT_DOUBLE_EQ(2.5, signals.pressure);
+
+    // Cgroup without limit gives pressure only
+    cgroup.Set(300, "max", 0);
+    MemoryGovernor::Read(cgroup.dir(), signals);
+    EXPECT_FALSE(signals.has_usage);
+    EXPECT_TRUE(signals.has_pressure);
+}
+
+TEST(StorageTest, MemoryGovernor) {
+    FakeCgroup cgroup;
+    GovernorConfig config;
+    config.cgroup = cgroup.dir();
+    config.calm_polls = 3;
+    config.shrink_cooldown = 2;
+    auto storage = std::make_shared<ThreadSafeSimplLRU>(100000);
+    MemoryGovernor governor(storage, config);
+    for (int i = 0; i < 1000; i++) {
+        storage->Put("key" + std::to_string(100000 + i), std::string(91, 'v'));
+    }
+
+    // No signals, nothing to do
+    EXPECT_FALSE(governor.Poll());
+    EXPECT_EQ(1, governor.scale());
+
+    // Usage above high threshold: limit shrinks and items above it are evicted right away
+    cgroup.Set(950, "1000", 0);
+    EXPECT_TRUE(governor.Poll());
+    EXPECT_DOUBLE_EQ(0.75, governor.scale());
+    EXPECT_LE(storage->size(), 75000);
+    std::string value;
+    EXPECT_FALSE(storage->Get("key100000", value));
+    EXPECT_TRUE(storage->Get("key100999", value));
+
+    // Pressure alone is enough, limit never gets below the minimum
+    cgroup.Set(0, "max", 50);
+    for (int i = 0; i < 20; i++) {
+        governor.Poll();
+    }
+    EXPECT_DOUBLE_EQ(config.min_scale, governor.scale());
+    EXPECT_LE(storage->size(), 10000);
+    EXPECT_FALSE(storage->Put("large", std::string(20000, 'l')));
+
+    // Between thresholds limit holds, and it grows only after calm polls in a row
+    cgroup.Set(850, "1000", 0);
+    for (int i = 0; i < 10; i++) {
+        EXPECT_FALSE(governor.Poll());
+    }
+    cgroup.Set(500, "1000", 0.5);
+    EXPECT_FALSE(governor.Poll());
+    EXPECT_FALSE(governor.Poll());
+    EXPECT_TRUE(governor.Poll());
+    EXPECT_DOUBLE_EQ(config.min_scale + config.grow_step, governor.scale());
+    EXPECT_TRUE(storage->Put("large", std::string(14000, 'l')));
+
+    // Single spike resets the calm streak
+    EXPECT_FALSE(governor.Poll());
+    cgroup.Set(500, "1000", 5);
+    EXPECT_FALSE(governor.Poll());
+    cgroup.Set(500, "1000", 0);
+    EXPECT_FALSE(governor.Poll());
+    EXPECT_FALSE(governor.Poll());
+    EXPECT_TRUE(governor.Poll());
+
+    // Storage with the fixed limit can't be governed
+    auto fixed = std::make_shared<EpochLRU>(1000);
+    MemoryGovernor nothing(fixed, config);
+    cgroup.Set(950, "1000", 0);
+    EXPECT_FALSE(nothing.Poll());
+    EXPECT_EQ(1, nothing.scale());
+}
+
+TEST(StorageTest, MemoryGovernorCooldown) {
+    FakeCgroup cgroup;
+    GovernorConfig config;
+    config.cgroup = cgroup.dir();
+    config.shrink_cooldown = 3;
+    auto storage = std::make_shared<ThreadSafeSimplLRU>(100000);
+    MemoryGovernor governor(storage, config);
+
+    // Usage that stays high right after the shrink doesn't tell it wasn't enough, limit holds for the cooldown
+    cgroup.Set(950, "1000", 0);
+    EXPECT_TRUE(governor.Poll());
+    EXPECT_FALSE(governor.Poll());
+    EXPECT_FALSE(governor.Poll());
+    EXPECT_DOUBLE_EQ(0.75, governor.scale());
+    EXPECT_TRUE(governor.Poll());
+    EXPECT_DOUBLE_EQ(0.75 * 0.75, governor.scale());
+
+    // Usage that dropped but is still high is the fresh signal, there is no need to wait
+    cgroup.Set(920, "1000", 0);
+    EXPECT_TRUE(governor.Poll());
+    EXPECT_FALSE(governor.Poll());
+
+    // Pressure without usage waits for the cooldown as well
+    cgroup.Set(0, "max", 50);
+    EXPECT_FALSE(governor.Poll());
+    EXPECT_TRUE(governor.Poll());
+}
+
+TEST(StorageTest, MemoryGovernorStriped) {
+    Config config;
+    config.max_stripes = 8;
+    StripedLockLRU storage(4 * 1024 * 1024, 4, config);
+    for (int i = 0; i < 40000; i++) {
+        EXPECT_TRUE(storage.Put("key" + std::to_string(100000 + i), std::string(91, 'v')));
+    }
+    EXPECT_FALSE(storage.SetLimitScale(0));
+    EXPECT_FALSE(storage.SetLimitScale(1.5));
+    ThreadSafeSimplLRU stripe(1024);
+    EXPECT_TRUE(stripe.Put("key", "value"));
+    EXPECT_FALSE(stripe.SetLimitScale(-1));
+    EXPECT_EQ(1, stripe.count());
+    EXPECT_TRUE(storage.SetLimitScale(0.5));
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.Stats("", stats);
+    std::map<std::string, std::string> by_name(stats.begin(), stats.end());
+    EXPECT_EQ(std::to_string(2 * 1024 * 1024), by_name["limit_maxbytes"]);
+    EXPECT_LE(std::stoul(by_name["bytes"]), 2 * 1024 * 1024);
+
+    // Stripes of the resized table get the same scale
+    EXPECT_TRUE(storage.Resize(2));
+    stats.clear();
+    storage.Stats("", stats);
+    by_name = std::map<std::string, std::string>(stats.begin(), stats.end());
+    EXPECT_EQ(std::to_string(2 * 1024 * 1024), by_name["limit_maxbytes"]);
+}
+
+TEST(StorageTest, HeavyHitters) {
+    HeavyHitters hot(3, 1);
+    std::vector<HeavyHitters::Hitter> top;
+    hot.Top(top);
+    EXPECT_TRUE(top.empty());
+
+    // Counter of the rare key is taken over, hot ones keep theirs
+    for (int i = 0; i < 1000; i++) {
+        hot.Add("hot", true);
+        if (i % 2 == 0) {
+            hot.Add("warm", false);
+        }
+        if (i % 4 == 0) {
+            hot.Add("tepid", i % 8 == 0);
+        }
+        hot.Add("cold" + std::to_string(i), true);
+    }
+    hot.Top(top);
+    ASSERT_EQ(3, top.size());
+    EXPECT_EQ("hot", top[0].key);
+    EXPECT_EQ("warm", top[1].key);
+    EXPECT_EQ("tepid", top[2].key);
+    EXPECT_GE(top[0].rate, 1000);
+    EXPECT_EQ(top[0].rate, top[0].get_rate);
+    EXPECT_EQ(0, top[1].get_rate);
+
+    // Summaries of all threads are merged
+    std::thread other([&hot]() {
+        for (int i = 0; i < 3000; i++) {
+            hot.Add("other", false);
+        }
+    });
+    other.join();
+    hot.Top(top);
+    EXPECT_EQ("other", top[0].key);
+    EXPECT_EQ("hot", top[1].key);
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    HeavyHitters::Report(0, top[0], stats);
+    ASSERT_EQ(3, stats.size());
+    EXPECT_EQ("hotkey:0:key", stats[0].first);
+    EXPECT_EQ("other", stats[0].second);
+    EXPECT_EQ("0.00", stats[2].second);
+}
+
+TEST(StorageTest, HeavyHittersSampled) {
+    Config config;
+    config.hot_keys = 2;
+    StripedLockLRU storage(4 * 1024 * 1024, 4, config);
+    std::string value;
+    for (int i = 0; i < 100000; i++) {
+        storage.Get(i % 3 == 0 ? "hot" : "key" + std::to_string(i), value);
+        if (i % 10 == 0) {
+            storage.Put("warm", "value");
+        }
+    }
+
+    // Sampling is random, only key above 1 / (4 * k) of accesses is sure to be counted. Hot one takes 30% of
+    // them, its count is never underestimated, while any other is overestimated by 1 / 8 at most
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.Stats("hotkeys", stats);
+    std::map<std::string, std::string> by_name(stats.begin(), stats.end());
+    EXPECT_EQ(8, stats.size());
+    EXPECT_EQ("hot", by_name["hotkey:0:key"]);
+    EXPECT_LE(0.99, std::stod(by_name["hotkey:0:get_ratio"]));
+    EXPECT_NE("hot", by_name["hotkey:1:key"]);
+    EXPECT_EQ(std::to_string(((HashKey("hot", 3) >> 32) & 0xffff) % 4), by_name["hotkey:0:stripe"]);
+
+    // Storage that doesn't track keys lists none
+    ThreadSafeSimplLRU plain(1024);
+    stats.clear();
+    plain.Stats("hotkeys", stats);
+    EXPECT_TRUE(stats.empty());
+}
+
+TEST(StorageTest, KeyHash) {
+    // Byte by byte hash is the same as of the whole key, for every tail length
+    std::string key;
+    std::set<uint64_t> seen;
+    for (int size = 0; size < 40; size++) {
+        KeyHasher hasher;
+        for (char c : key) {
+            hasher.Update(c);
+        }
+        EXPECT_EQ(HashKey(key.data(), key.size()), hasher.Digest());
+        seen.insert(hasher.Digest());
+        key.push_back(size % 2 == 0 ? 'a' + size : '\0');
+    }
+    EXPECT_EQ(40, seen.size());
+}
+
+TEST(StorageTest, HashedOperations) {
+    Config config;
+    config.filter = true;
+    StripedLockLRU striped(4 * 1024 * 1024, 4, config);
+    ThreadSafeLRU<SpinLock, BasicLRU<HashIndex, Counters>> hashed(1024, config);
+    for (Afina::Storage *storage : std::vector<Afina::Storage *>{&striped, &hashed}) {
+        const std::string key = "key";
+        const uint64_t hash = HashKey(key.data(), key.size());
+
+        // Hashed and plain operations see the same items
+        Value out;
+        EXPECT_FALSE(storage->GetItem(key, hash, out));
+        EXPECT_TRUE(storage->PutValue(key, hash, Value("b")));
+        EXPECT_TRUE(storage->Append(key, hash, Value("c")));
+        EXPECT_TRUE(storage->Prepend(key, hash, Value("a")));
+        std::string value;
+        EXPECT_TRUE(storage->Get(key, value));
+        EXPECT_EQ("abc", value);
+        EXPECT_TRUE(storage->GetItem(key, hash, out));
+        EXPECT_EQ("VALUE key 0 3\r\nabc\r\n", out.str());
+
+        auto store = [](bool found, const Current &current, Value &value) -> Afina::Storage::Action {
+            value = Value(found ? "d" : "e");
+            return Afina::Storage::Action::kStore;
+        };
+        EXPECT_TRUE(storage->Compute(key, hash, store));
+        EXPECT_TRUE(storage->Get(key, value));
+        EXPECT_EQ("d", value);
+        EXPECT_TRUE(storage->Delete(key, hash));
+        EXPECT_FALSE(storage->Delete(key));
+        EXPECT_TRUE(storage->Put(key, "f"));
+        EXPECT_TRUE(storage->Delete(key, hash));
+        EXPECT_FALSE(storage->Get(key, value));
+
+        EXPECT_FALSE(storage->Set(key, hash, "g"));
+        EXPECT_TRUE(storage->PutIfAbsent(key, hash, "g"));
+        EXPECT_FALSE(storage->PutIfAbsent(key, hash, "h"));
+        EXPECT_TRUE(storage->Set(key, hash, "i"));
+        EXPECT_TRUE(storage->Get(key, hash, value));
+        EXPECT_EQ("i", value);
+        EXPECT_TRUE(storage->Put(key, hash, "j"));
+        EXPECT_TRUE(storage->GetValue(key, hash, out));
+        EXPECT_EQ("j", out.str());
+
+        // Tagged item put by hash is invalidated all the same
+        EXPECT_TRUE(storage->PutTagged(key, hash, "k", "tag"));
+        EXPECT_TRUE(storage->Get(key, value));
+        EXPECT_EQ("k", value);
+        EXPECT_TRUE(storage->InvalidateTag("tag"));
+        EXPECT_FALSE(storage->Get(key, hash, value));
+    }
+}
+
+TEST(StorageTest, HashedOperationsReuseHash) {
+    EpochLRU epoch(1024);
+    LogStructuredLRU log(64 * 1024, 4 * 1024);
+    FixedWidthLRU<8> fixed(64 * 1024);
+    for (Afina::Storage *storage : std::vector<Afina::Storage *>{&epoch, &log, &fixed}) {
+        const std::string key = "key";
+        const uint64_t hash = HashKey(key.data(), key.size());
+
+        // Hashed and plain operations see the same items
+        EXPECT_FALSE(storage->Set(key, hash, "aaaaaaaa"));
+        EXPECT_TRUE(storage->PutIfAbsent(key, hash, "aaaaaaaa"));
+        EXPECT_FALSE(storage->PutIfAbsent(key, "bbbbbbbb"));
+        std::string value;
+        EXPECT_TRUE(storage->Get(key, value));
+        EXPECT_EQ("aaaaaaaa", value);
+        EXPECT_TRUE(storage->Set(key, "bbbbbbbb"));
+        EXPECT_TRUE(storage->Get(key, hash, value));
+        EXPECT_EQ("bbbbbbbb", value);
+
+        auto store = [](bool found, const Current &current, Value &value) -> Afina::Storage::Action {
+            value = Value(found ? "cccccccc" : "dddddddd");
+            return Afina::Storage::Action::kStore;
+        };
+        EXPECT_TRUE(storage->Compute(key, hash, store));
+        Value out;
+        EXPECT_TRUE(storage->GetItem(key, hash, out));
+        EXPECT_EQ("VALUE key 0 8\r\ncccccccc\r\n", out.str());
+        EXPECT_TRUE(storage->PutValue(key, hash, Value("eeeeeeee")));
+        EXPECT_TRUE(storage->GetValue(key, out));
+        EXPECT_EQ("eeeeeeee", out.str());
+
+        // Storage looks the key up by the given hash, it doesn't hash the key again
+        EXPECT_FALSE(storage->Get(key, hash + 1, value));
+        EXPECT_FALSE(storage->Delete(key, hash + 1));
+
+        EXPECT_TRUE(storage->Delete(key, hash));
+        EXPECT_FALSE(storage->Delete(key));
+        EXPECT_TRUE(storage->Put(key, hash, "ffffffff"));
+        EXPECT_TRUE(storage->Delete(key));
+        EXPECT_FALSE(storage->Get(key, hash, value));
+    }
+}
+
+TEST(StorageTest, Namespaces) {
+    auto fallback = std::make_shared<ThreadSafeSimplLRU>(1024);
+    auto team = std::make_shared<ThreadSafeSimplLRU>(1024);
+    auto nested = std::make_shared<ThreadSafeSimplLRU>(1024);
+    Namespaces storage(fallback);
+    storage.Add("team", "team:", team);
+    storage.Add("nested", "team:a:", nested);
+    EXPECT_THROW(storage.Add("other", "team:", fallback), std::runtime_error);
+    EXPECT_THROW(storage.Add("team", "other:", fallback), std::runtime_error);
+    EXPECT_EQ(3, storage.size());
+    EXPECT_EQ(nested, storage.Find("nested"));
+    EXPECT_EQ(fallback, storage.Find(Namespaces::kDefault));
+
+    // Key belongs to the longest prefix it starts with, the rest go to the default namespace
+    EXPECT_TRUE(storage.Put("team:1", "v1"));
+    EXPECT_TRUE(storage.PutValue("team:a:1", HashKey("team:a:1", 8), Value("v2")));
+    EXPECT_TRUE(storage.Put("team", "v3"));
+    std::string value;
+    EXPECT_TRUE(team->Get("team:1", value));
+    EXPECT_FALSE(team->Get("team:a:1", value));
+    EXPECT_TRUE(nested->Get("team:a:1", value));
+    EXPECT_TRUE(fallback->Get("team", value));
+
+    // Churn of the default namespace evicts nothing from others
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_TRUE(storage.Put("key" + std::to_string(i), std::string(100, 'x')));
+    }
+    EXPECT_FALSE(storage.Get("team", value));
+    EXPECT_TRUE(storage.Get("team:1", value));
+    EXPECT_EQ("v1", value);
+    Value out;
+    EXPECT_TRUE(storage.GetItem("team:a:1", HashKey("team:a:1", 8), out));
+    EXPECT_EQ("VALUE team:a:1 0 2\r\nv2\r\n", out.str());
+
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.Stats("", stats);
+    std::map<std::string, std::string> by_name(stats.begin(), stats.end());
+    EXPECT_EQ(std::to_string(fallback->count() + 2), by_name["curr_items"]);
+    EXPECT_EQ("3072", by_name["limit_maxbytes"]);
+
+    stats.clear();
+    storage.Stats("namespaces", stats);
+    by_name = std::map<std::string, std::string>(stats.begin(), stats.end());
+    EXPECT_EQ("team:", by_name["namespace:team:prefix"]);
+    EXPECT_EQ("1", by_name["namespace:team:curr_items"]);
+    EXPECT_EQ("1", by_name["namespace:nested:cmd_set"]);
+    EXPECT_EQ("", by_name["namespace:default:prefix"]);
+    EXPECT_EQ(std::to_string(fallback->count()), by_name["namespace:default:curr_items"]);
+
+    // Prefix owned by one namespace reaches nested ones, but not the default one
+    std::size_t deleted;
+    EXPECT_TRUE(storage.DeletePrefix("team:", deleted));
+    EXPECT_EQ(2, deleted);
+    EXPECT_FALSE(storage.Get("team:a:1", value));
+    EXPECT_TRUE(storage.Put("team:2", "v4"));
+    EXPECT_TRUE(storage.DeletePrefix("key99", deleted));
+    EXPECT_LT(0, deleted);
+    EXPECT_FALSE(storage.Get("key999", value));
+    EXPECT_TRUE(storage.Get("team:2", value));
+}
+
+TEST(StorageTest, NamespacesTotals) {
+    auto striped = std::make_shared<StripedLockLRU>(4 * 1024 * 1024, 4);
+    auto log = std::make_shared<LogStructuredLRU>(256 * 1024, 64 * 1024);
+    auto other = std::make_shared<LogStructuredLRU>(256 * 1024, 64 * 1024);
+    Namespaces storage(striped);
+    storage.Add("log", "log:", log);
+    storage.Add("other", "other:", other);
+    EXPECT_TRUE(storage.Put("key", "value"));
+    EXPECT_TRUE(storage.Put("log:key", "value"));
+    EXPECT_TRUE(storage.Put("other:key", "value"));
+
+    // Counters and sizes add up, configuration and ratios are reported per namespace only
+    std::vector<std::pair<std::string, std::string>> stats;
+    storage.Stats("", stats);
+    std::map<std::string, std::string> by_name(stats.begin(), stats.end());
+    EXPECT_EQ("3", by_name["curr_items"]);
+    EXPECT_EQ("3", by_name["cmd_set"]);
+    EXPECT_EQ(std::to_string(4 * 1024 * 1024 + 2 * 256 * 1024), by_name["limit_maxbytes"]);
+    EXPECT_EQ("8", by_name["log_segments"]);
+    EXPECT_EQ(0, by_name.count("stripes"));
+    EXPECT_EQ(0, by_name.count("log_segment_size"));
+    EXPECT_EQ(0, by_name.count("log_utilization"));
+
+    stats.clear();
+    storage.Stats("namespaces", stats);
+    by_name = std::map<std::string, std::string>(stats.begin(), stats.end());
+    EXPECT_EQ("4", by_name["namespace:default:stripes"]);
+    EXPECT_EQ(std::to_string(64 * 1024), by_name["namespace:log:log_segment_size"]);
+}